@@ -0,0 +1,666 @@
+/**
+ * @file main.cpp
+ * @brief Micro-benchmark suite for the echo worker hot paths and the common/ components.
+ *
+ * Every case measures per-operation cycles (`QueryThreadCycleTime`) and
+ * nanoseconds on a pinned thread, after one untimed warm-up run, and reports
+ * the median and spread over `--repeat` runs so results are comparable
+ * across commits. The cases are:
+ *
+ * - `hot_path/`: the worker bookkeeping around a completion batch, comparing
+ *   the previous layout (a fresh `std::vector<OVERLAPPED_ENTRY>` per dequeue
+ *   and sequentially consistent `fetch_add` counters) with the current one (a
+ *   preallocated completion array and `single_writer_counter`s on their own
+ *   cache line), with a concurrent snapshot reader as the RPS thread does.
+ * - `clock/`: `get_timestamp_ns` on QPC and (with an invariant TSC) on the
+ *   TSC, against `std::chrono::steady_clock`.
+ * - `tdigest/`: per-sample `add`, `compress` of one rotation's buffer, merging
+ *   worker digests, and `percentile` on a compressed and an uncompressed digest.
+ * - `pacer/`: the client's per-packet pacer calls (token bucket alone, with
+ *   BBR feedback, open-loop Poisson schedule).
+ * - `cc/`: `on_send`/`on_ack` of the BBR and Reno controllers on a
+ *   synthetic clock.
+ * - `pool/`: building an `io_context_pool` slab and the workers' free-list
+ *   acquire/release of its contexts.
+ * - `loopback/echo`: the server's and the client's worker loops echoing
+ *   over 127.0.0.1 in one process, reporting their cost per echoed packet.
+ *
+ * `--results csv:FILE` or `ndjson:FILE` writes one row per case (through
+ * `stats_stream`) for tracking; `--label` tags the rows, e.g. with a commit id.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/arg_parser.hpp"
+#include "common/arrival_process.hpp"
+#include "client/client_worker.hpp"
+#include "common/bbr.hpp"
+#include "common/counters.hpp"
+#include "common/digest_exchange.hpp"
+#include "common/io_context_pool.hpp"
+#include "common/open_loop_pacer.hpp"
+#include "common/pacer.hpp"
+#include "common/reno.hpp"
+#include "common/socket_utils.hpp"
+#include "common/stats_stream.hpp"
+#include "common/tdigest.hpp"
+#include "common/topology.hpp"
+#include "server/server_worker.hpp"
+
+/// Keeps results observable so the optimiser cannot drop the measured work.
+static volatile uint64_t g_sink = 0;
+
+/**
+ * @brief Worker counters as laid out before: adjacent seq_cst atomics.
+ */
+struct legacy_counters {
+    std::atomic<uint64_t> packets_received{0};
+    std::atomic<uint64_t> packets_sent{0};
+    std::atomic<uint64_t> bytes_received{0};
+    std::atomic<uint64_t> bytes_sent{0};
+
+    void on_echo(uint64_t bytes) {
+        packets_received.fetch_add(1);
+        bytes_received.fetch_add(bytes);
+        packets_sent.fetch_add(1);
+        bytes_sent.fetch_add(bytes);
+    }
+    uint64_t snapshot() const { return packets_received.load(); }
+};
+
+/**
+ * @brief Worker counters as laid out now: single-writer, cache-line aligned.
+ */
+struct alignas(CACHE_LINE_SIZE) worker_counters {
+    single_writer_counter packets_received{0};
+    single_writer_counter packets_sent{0};
+    single_writer_counter bytes_received{0};
+    single_writer_counter bytes_sent{0};
+
+    void on_echo(uint64_t bytes) {
+        packets_received.add(1);
+        bytes_received.add(bytes);
+        packets_sent.add(1);
+        bytes_sent.add(bytes);
+    }
+    uint64_t snapshot() const { return packets_received.load(); }
+};
+
+/// Result of one run of a benchmark case.
+struct bench_result {
+    double cycles_per_op;
+    double ns_per_op;
+    /// Operations the run performed.
+    uint64_t ops;
+};
+
+/**
+ * @brief Cycle and time stamps of the calling thread.
+ */
+struct thread_stamp {
+    ULONG64 cycles{0};
+    uint64_t ns{0};
+
+    static thread_stamp now() {
+        thread_stamp stamp;
+        QueryThreadCycleTime(GetCurrentThread(), &stamp.cycles);
+        stamp.ns = get_timestamp_ns();
+        return stamp;
+    }
+
+    /// Per-operation cost of `ops` operations since `start`.
+    static bench_result since(const thread_stamp& start, uint64_t ops) {
+        const thread_stamp end = now();
+        const double n = static_cast<double>((std::max)(ops, uint64_t{1}));
+        return {static_cast<double>(end.cycles - start.cycles) / n,
+                static_cast<double>(end.ns - start.ns) / n, ops};
+    }
+};
+
+/**
+ * @brief Time `body()`, which performs `ops` operations.
+ */
+template <typename Body>
+bench_result measure(uint64_t ops, Body&& body) {
+    const thread_stamp start = thread_stamp::now();
+    body();
+    return thread_stamp::since(start, ops);
+}
+
+/**
+ * @brief Run `packets` simulated echoes in batches of `batch` completions.
+ *
+ * @tparam Counters `legacy_counters` or `worker_counters`.
+ * @param preallocate Reuse one completion array instead of allocating one per batch.
+ */
+template <typename Counters>
+bench_result run_hot_path(uint64_t packets, size_t batch, bool preallocate) {
+    Counters counters;
+    std::atomic<bool> done{false};
+    // Snapshot reader standing in for the stats/RPS thread.
+    std::thread reader([&]() {
+        uint64_t sink = 0;
+        while (!done.load(std::memory_order_relaxed)) {
+            sink += counters.snapshot();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        static_cast<void>(sink);
+    });
+
+    const size_t max_entries = batch * 2;
+    std::vector<OVERLAPPED_ENTRY> preallocated(max_entries);
+    volatile ULONG_PTR touch = 0;
+
+    const bench_result result = measure(packets, [&]() {
+        for (uint64_t done_packets = 0; done_packets < packets; done_packets += batch) {
+            if (preallocate) {
+                preallocated[0].lpCompletionKey = done_packets;
+                touch = preallocated[0].lpCompletionKey;
+            } else {
+                std::vector<OVERLAPPED_ENTRY> entries(max_entries);
+                entries[0].lpCompletionKey = done_packets;
+                touch = entries[0].lpCompletionKey;
+            }
+            for (size_t i = 0; i < batch; ++i) {
+                counters.on_echo(64 + HEADER_SIZE);
+            }
+        }
+    });
+    done.store(true);
+    reader.join();
+    return result;
+}
+
+/**
+ * @brief Drive a congestion controller as a client worker does, on a synthetic clock.
+ *
+ * Packets go out 1 us apart and each is acknowledged `window` packets later
+ * with a 64 us RTT; the controller is polled every 1024 packets.
+ */
+template <CongestionControllerConcept CongestionController>
+bench_result run_cc(uint64_t packets, uint64_t window) {
+    CongestionController cc;
+    cc.set_initial_rate(1e6);
+    return measure(packets, [&]() {
+        uint64_t now_ns = 1;
+        for (uint64_t seq = 0; seq < packets; ++seq) {
+            now_ns += 1000;
+            cc.on_send(now_ns, seq);
+            if (seq >= window) cc.on_ack(now_ns, seq - window, window * 1000);
+            if ((seq & 1023) == 0) cc.on_poll(now_ns);
+        }
+        g_sink = g_sink + static_cast<uint64_t>(cc.target_rate_pps());
+    });
+}
+
+/**
+ * @brief Per-packet pacer calls of a client worker: check, send, and acknowledge later.
+ *
+ * The rate is high enough that the pacer rarely blocks, so this measures the
+ * pacer's own cost rather than its schedule.
+ */
+bench_result run_pacer(client_send_pacer_base& pacer, uint64_t packets, bool acks) {
+    constexpr uint64_t window = 64;
+    return measure(packets, [&]() {
+        uint64_t allowed = 0;
+        for (uint64_t seq = 0; seq < packets; ++seq) {
+            // One clock read per packet, as the client's send stamp.
+            const uint64_t now_ns = get_timestamp_ns();
+            allowed += pacer.can_send(now_ns) ? 1 : 0;
+            pacer.record_send(now_ns, seq);
+            if (acks && seq >= window) pacer.on_ack(now_ns, seq - window, 64000);
+            if ((seq & 1023) == 0) pacer.poll(now_ns);
+        }
+        g_sink = g_sink + allowed;
+    });
+}
+
+/**
+ * @brief Cycles the thread behind `handle` has run so far.
+ */
+ULONG64 thread_cycles(std::thread::native_handle_type handle) {
+    ULONG64 cycles = 0;
+    QueryThreadCycleTime(reinterpret_cast<HANDLE>(handle), &cycles);
+    return cycles;
+}
+
+/**
+ * @brief Echo over 127.0.0.1 between the real server and client workers, run in-process.
+ *
+ * Starts one IOCP server worker (`server_worker_thread_func`, i.e.
+ * `worker_thread_func<echo_handler>`) and one client worker
+ * (`client_worker_thread_func`) on their own pinned threads, with `depth`
+ * receives posted on each side and the client paced at `rate_pps` (0 =
+ * unlimited). After `duration_ms` both are stopped through their configs'
+ * flags, as the executables' signal handlers stop them. The cost per packet
+ * is both worker threads' cycles over the run divided by the echoes the
+ * client received, and the time per packet is the run's wall time divided
+ * by the same count.
+ */
+bench_result run_loopback(uint32_t duration_ms, size_t depth, size_t payload, uint64_t rate_pps) {
+    // Spread the workers over CPUs other than the benchmark thread's where possible.
+    const uint32_t cpus = get_processor_count();
+    logical_processor server_cpu;
+    server_cpu.index = cpus > 1 ? 1 : 0;
+    logical_processor client_cpu;
+    client_cpu.index = cpus > 2 ? 2 : 0;
+
+    server_config server;
+    server.depth = depth;
+    server.max_datagram = HEADER_SIZE + payload;
+    std::unique_ptr<server_worker_context> server_ctx =
+        create_server_worker(server, server_cpu, AF_INET, 0);
+    sockaddr_in server_addr = {};
+    {
+        auto [name, name_len] = get_socket_name(server_ctx->socket);
+        server_addr = reinterpret_cast<const sockaddr_in&>(name);
+        server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+    server_ctx->worker_thread = std::jthread(server_worker_thread_func, server_ctx.get());
+    while (server.workers_ready.load() == 0 && !server.shutdown.load()) {
+        std::this_thread::yield();
+    }
+    if (server.shutdown.load()) {
+        server_ctx->worker_thread.join();
+        throw std::runtime_error("Loopback server worker failed to start");
+    }
+
+    client_config client;
+    client.depth = depth;
+    auto client_ctx = std::make_unique<client_worker_context>();
+    client_ctx->config = &client;
+    client_ctx->processor_id = client_cpu.index;
+    auto cs = std::make_unique<client_socket>();
+    cs->socket = create_udp_socket(AF_INET);
+    bind_socket(cs->socket, 0, AF_INET);
+    client_ctx->iocp = create_iocp();
+    associate_socket_with_iocp(cs->socket, client_ctx->iocp, reinterpret_cast<ULONG_PTR>(cs.get()));
+    client_ctx->sockets.push_back(std::move(cs));
+    auto target = std::make_unique<worker_target>();
+    std::memcpy(&target->addr, &server_addr, sizeof(server_addr));
+    target->addr_len = sizeof(server_addr);
+    target->rate_pps = static_cast<double>(rate_pps);
+    target->pacer = std::make_unique<client_send_pacer<>>(target->rate_pps);
+    client_ctx->targets.push_back(std::move(target));
+    client_ctx->per_worker_rate = rate_pps;
+    client_ctx->digest_rotate_samples = rate_pps == 0 ? UNLIMITED_RATE_ROTATE_SAMPLES : rate_pps;
+    // Digests are preallocated as the client does, so rotation never allocates.
+    const uint64_t rotate_samples = client_ctx->digest_rotate_samples;
+    auto make_digest = [rotate_samples]() {
+        auto digest = std::make_unique<TDigest>(100.0);
+        digest->reserve(
+            static_cast<size_t>((std::min)(rotate_samples, MAX_DIGEST_RESERVE_SAMPLES)));
+        return digest;
+    };
+    client_ctx->rtt.digests = std::make_unique<digest_exchange<TDigest>>(
+        digest_exchange<TDigest>::DEFAULT_POOL_SIZE, make_digest);
+    client_ctx->pacing.digests = std::make_unique<digest_exchange<TDigest>>(
+        digest_exchange<TDigest>::DEFAULT_POOL_SIZE, make_digest);
+    client_ctx->worker_thread = std::thread(client_worker_thread_func, client_ctx.get(), payload);
+
+    // Merge the handed-over digests about once a second, as the client's merge
+    // thread does, so the worker's rotations find cleared digests.
+    std::atomic<bool> merge_stop{false};
+    std::thread merge_thread([&]() {
+        TDigest rtt_total(100.0);
+        TDigest pacing_total(100.0);
+        auto merge_all = [&]() {
+            client_ctx->rtt.digests->drain([&](TDigest& d) { rtt_total.merge(d); });
+            client_ctx->pacing.digests->drain([&](TDigest& d) { pacing_total.merge(d); });
+        };
+        while (!merge_stop.load()) {
+            for (int i = 0; i < 100 && !merge_stop.load(); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            merge_all();
+        }
+    });
+
+    const auto server_handle = server_ctx->worker_thread.native_handle();
+    const auto client_handle = client_ctx->worker_thread.native_handle();
+    // The worker touches its pacer only once sending starts, so reset it first.
+    client_ctx->targets.front()->pacer->reset_to_now(get_timestamp_ns());
+    client.start_sending.store(true);
+    const ULONG64 start_cycles = thread_cycles(server_handle) + thread_cycles(client_handle);
+    const uint64_t start_echoes = client_ctx->packets_received.load();
+    const uint64_t start_ns = get_timestamp_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+    const ULONG64 end_cycles = thread_cycles(server_handle) + thread_cycles(client_handle);
+    const uint64_t echoes = client_ctx->packets_received.load() - start_echoes;
+    const uint64_t end_ns = get_timestamp_ns();
+
+    // Stop as the executables do: the client stops sending and then exits,
+    // the server drains its in-flight echoes and exits.
+    client.stop_sending.store(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    client.shutdown.store(true);
+    PostQueuedCompletionStatus(client_ctx->iocp.get(), 0, 0, nullptr);
+    client_ctx->worker_thread.join();
+    merge_stop.store(true);
+    merge_thread.join();
+    server.shutdown.store(true);
+    wake_server_worker(*server_ctx);
+    server_ctx->worker_thread.join();
+
+    const double n = static_cast<double>((std::max)(echoes, uint64_t{1}));
+    return {static_cast<double>(end_cycles - start_cycles) / n,
+            static_cast<double>(end_ns - start_ns) / n, echoes};
+}
+
+/**
+ * @brief A named benchmark case.
+ */
+struct bench_case {
+    std::string name;
+    /// What one operation is.
+    const char* unit;
+    std::function<bench_result()> run;
+};
+
+/**
+ * @brief Median and spread of a case's repeated runs.
+ */
+struct bench_summary {
+    bench_result median;
+    double min_ns_per_op;
+    double max_ns_per_op;
+};
+
+/**
+ * @brief Summarize repeated runs by ns/op (cycles and ops are taken from the median run).
+ */
+bench_summary summarize(std::vector<bench_result> runs) {
+    std::sort(runs.begin(), runs.end(),
+              [](const auto& a, const auto& b) { return a.ns_per_op < b.ns_per_op; });
+    return {runs[runs.size() / 2], runs.front().ns_per_op, runs.back().ns_per_op};
+}
+
+/**
+ * @brief Program entry point for the benchmarks.
+ */
+int main(int argc, char* argv[]) try {
+    ArgParser parser;
+    parser.add_option("packets", 'n', "10000000", true,
+                      "Operations per micro-benchmark case (default: 10000000)");
+    parser.add_option("batch", 'b', "16", true, "Completions per dequeue (default: 16)");
+    parser.add_option("repeat", 'r', "5", true,
+                      "Timed runs per case, after one warm-up (default: 5)");
+    parser.add_option("filter", 'f', "", true, "Run only cases whose name contains this text");
+    parser.add_option("loopback-ms", 'l', "2000", true,
+                      "Duration of each loopback run in ms (default: 2000; 0 to skip)");
+    parser.add_option("depth", 'q', "64", true,
+                      "Loopback receives posted per worker, and client sends (default: 64)");
+    parser.add_option("loopback-rate", '\0', "0", true,
+                      "Loopback client rate in packets/s (default: 0 = unlimited)");
+    parser.add_option("payload", 'p', "64", true,
+                      "Loopback payload bytes after the header (default: 64)");
+    parser.add_option("results", 'o', "", true,
+                      "Write one row per case to csv:FILE or ndjson:FILE");
+    parser.add_option("label", '\0', "", true,
+                      "Tag written with each result row (e.g. a commit id)");
+    parser.add_option("help", 'h', "0", false, "Show this help");
+    parser.parse(argc, argv);
+
+    if (parser.is_set("help")) {
+        parser.print_help(argv[0]);
+        return 0;
+    }
+
+    const uint64_t packets = std::strtoull(parser.get("packets").c_str(), nullptr, 10);
+    const size_t batch =
+        static_cast<size_t>(std::strtoul(parser.get("batch").c_str(), nullptr, 10));
+    const size_t repeat =
+        static_cast<size_t>(std::strtoul(parser.get("repeat").c_str(), nullptr, 10));
+    const uint32_t loopback_ms =
+        static_cast<uint32_t>(std::strtoul(parser.get("loopback-ms").c_str(), nullptr, 10));
+    const size_t depth =
+        static_cast<size_t>(std::strtoul(parser.get("depth").c_str(), nullptr, 10));
+    const uint64_t loopback_rate = std::strtoull(parser.get("loopback-rate").c_str(), nullptr, 10);
+    const size_t payload =
+        static_cast<size_t>(std::strtoul(parser.get("payload").c_str(), nullptr, 10));
+    const std::string filter = parser.get("filter");
+    const std::string label = parser.get("label");
+    if (packets == 0 || batch == 0 || repeat == 0) {
+        throw std::invalid_argument("packets, batch and repeat must be positive");
+    }
+    if (depth == 0 || depth > MAX_OUTSTANDING_OPS) {
+        throw std::invalid_argument(
+            std::format("Invalid depth (valid: 1-{})", MAX_OUTSTANDING_OPS));
+    }
+    if (payload > MAX_PAYLOAD_SIZE) {
+        throw std::invalid_argument(std::format("payload must be at most {}", MAX_PAYLOAD_SIZE));
+    }
+
+    initialize_winsock();
+    std::unique_ptr<stats_stream> results;
+    if (const std::string spec = parser.get("results"); !spec.empty()) {
+        results = std::make_unique<stats_stream>(spec);
+    }
+    set_thread_affinity(0);
+
+    // Digest inputs are pregenerated so the RNG is not part of the measurement.
+    constexpr size_t digest_batch = 100000;
+    constexpr size_t digest_workers = 16;
+    std::vector<double> rtts_ms(digest_batch);
+    {
+        std::mt19937_64 rng(42);
+        std::lognormal_distribution<double> rtt_ms(-1.0, 0.5);
+        for (auto& v : rtts_ms) v = rtt_ms(rng);
+    }
+    const uint64_t digest_rounds = (std::max)(uint64_t{1}, packets / digest_batch);
+    // Pools are built far less often than packets are sent.
+    const uint64_t pool_builds = (std::max)(uint64_t{1}, packets / 100000);
+
+    std::vector<bench_case> cases;
+    cases.push_back({"hot_path/vector_seq_cst (before)", "packet",
+                     [&]() { return run_hot_path<legacy_counters>(packets, batch, false); }});
+    cases.push_back({"hot_path/vector_single_writer", "packet",
+                     [&]() { return run_hot_path<worker_counters>(packets, batch, false); }});
+    cases.push_back({"hot_path/preallocated_seq_cst", "packet",
+                     [&]() { return run_hot_path<legacy_counters>(packets, batch, true); }});
+    cases.push_back({"hot_path/preallocated_single_writer (after)", "packet",
+                     [&]() { return run_hot_path<worker_counters>(packets, batch, true); }});
+    cases.push_back({"clock/get_timestamp_ns", "call", [&]() {
+                         return measure(packets, [&]() {
+                             uint64_t sum = 0;
+                             for (uint64_t i = 0; i < packets; ++i) sum += get_timestamp_ns();
+                             g_sink = g_sink + sum;
+                         });
+                     }});
+    if (invariant_tsc_supported()) {
+        cases.push_back({"clock/get_timestamp_ns_tsc", "call", [&]() {
+                             set_timestamp_source(timestamp_source::tsc);
+                             const bench_result r = measure(packets, [&]() {
+                                 uint64_t sum = 0;
+                                 for (uint64_t i = 0; i < packets; ++i) sum += get_timestamp_ns();
+                                 g_sink = g_sink + sum;
+                             });
+                             set_timestamp_source(timestamp_source::qpc);
+                             return r;
+                         }});
+    }
+    cases.push_back({"clock/steady_clock_now", "call", [&]() {
+                         return measure(packets, [&]() {
+                             uint64_t sum = 0;
+                             for (uint64_t i = 0; i < packets; ++i) {
+                                 sum += static_cast<uint64_t>(
+                                     std::chrono::steady_clock::now().time_since_epoch().count());
+                             }
+                             g_sink = g_sink + sum;
+                         });
+                     }});
+    cases.push_back({"tdigest/add", "sample", [&]() {
+                         TDigest digest(100);
+                         digest.reserve(digest_batch);
+                         return measure(digest_rounds * digest_batch, [&]() {
+                             for (uint64_t r = 0; r < digest_rounds; ++r) {
+                                 digest.reset();
+                                 for (double v : rtts_ms) digest.add(v);
+                             }
+                         });
+                     }});
+    cases.push_back({"tdigest/compress", "sample", [&]() {
+                         // Only the compress of each rotation-sized buffer is timed.
+                         TDigest digest(100);
+                         digest.reserve(digest_batch);
+                         ULONG64 cycles = 0;
+                         uint64_t ns = 0;
+                         for (uint64_t r = 0; r < digest_rounds; ++r) {
+                             digest.reset();
+                             for (double v : rtts_ms) digest.add(v);
+                             const thread_stamp start = thread_stamp::now();
+                             digest.compress();
+                             const thread_stamp end = thread_stamp::now();
+                             cycles += end.cycles - start.cycles;
+                             ns += end.ns - start.ns;
+                         }
+                         const double samples = static_cast<double>(digest_rounds * digest_batch);
+                         return bench_result{static_cast<double>(cycles) / samples,
+                                             static_cast<double>(ns) / samples,
+                                             digest_rounds * digest_batch};
+                     }});
+    cases.push_back({"tdigest/merge", "sample", [&]() {
+                         std::vector<std::unique_ptr<TDigest>> worker_digests;
+                         for (size_t w = 0; w < digest_workers; ++w) {
+                             worker_digests.push_back(std::make_unique<TDigest>(100));
+                             for (double v : rtts_ms) worker_digests.back()->add(v);
+                         }
+                         TDigest global(100);
+                         return measure(digest_workers * digest_batch, [&]() {
+                             for (const auto& wd : worker_digests) global.merge(*wd);
+                             global.compress();
+                         });
+                     }});
+    cases.push_back({"tdigest/percentile", "query", [&]() {
+                         TDigest digest(100);
+                         for (double v : rtts_ms) digest.add(v);
+                         digest.compress();
+                         const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+                         const uint64_t queries = (std::max)(uint64_t{1}, packets / 100);
+                         return measure(queries, [&]() {
+                             double sum = 0.0;
+                             for (uint64_t i = 0; i < queries; ++i) {
+                                 sum += digest.percentile(quantiles[i % 4]);
+                             }
+                             g_sink = g_sink + static_cast<uint64_t>(sum);
+                         });
+                     }});
+    cases.push_back({"tdigest/percentile_uncompressed", "query", [&]() {
+                         // A query on a digest still holding buffered samples sorts them first.
+                         TDigest digest(100);
+                         for (double v : rtts_ms) digest.add(v);
+                         const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+                         const uint64_t queries = (std::max)(uint64_t{1}, packets / 100000);
+                         return measure(queries, [&]() {
+                             double sum = 0.0;
+                             for (uint64_t i = 0; i < queries; ++i) {
+                                 sum += digest.percentile(quantiles[i % 4]);
+                             }
+                             g_sink = g_sink + static_cast<uint64_t>(sum);
+                         });
+                     }});
+    cases.push_back({"pacer/token_bucket", "packet", [&]() {
+                         client_send_pacer<> pacer(1e9);
+                         return run_pacer(pacer, packets, false);
+                     }});
+    cases.push_back({"pacer/token_bucket_bbr", "packet", [&]() {
+                         client_send_pacer<bbr_congestion_controller> pacer(1e9);
+                         return run_pacer(pacer, packets, true);
+                     }});
+    cases.push_back({"pacer/open_loop_poisson", "packet", [&]() {
+                         open_loop_pacer<poisson_arrivals> pacer(poisson_arrivals(1e9, 42));
+                         return run_pacer(pacer, packets, false);
+                     }});
+    cases.push_back({"cc/bbr", "packet",
+                     [&]() { return run_cc<bbr_congestion_controller>(packets, 64); }});
+    cases.push_back({"cc/reno", "packet",
+                     [&]() { return run_cc<reno_congestion_controller>(packets, 64); }});
+    cases.push_back({"pool/create_1024x2048", "pool", [&]() {
+                         return measure(pool_builds, [&]() {
+                             for (uint64_t i = 0; i < pool_builds; ++i) {
+                                 io_context_pool pool(1024, 2048);
+                                 g_sink = g_sink + pool.slab_size();
+                             }
+                         });
+                     }});
+    cases.push_back({"pool/acquire_release", "packet", [&]() {
+                         io_context_pool pool(DEFAULT_OUTSTANDING_OPS * 4, 2048);
+                         std::vector<io_context*> available;
+                         for (io_context& ctx : pool) available.push_back(&ctx);
+                         return measure(packets, [&]() {
+                             for (uint64_t i = 0; i < packets; ++i) {
+                                 io_context* ctx = available.back();
+                                 available.pop_back();
+                                 ctx->operation = io_operation_type::send;
+                                 available.push_back(ctx);
+                             }
+                         });
+                     }});
+    if (loopback_ms > 0) {
+        cases.push_back({"loopback/echo", "packet",
+                         [&]() {
+                             return run_loopback(loopback_ms, depth, payload, loopback_rate);
+                         }});
+    }
+
+    std::cout << std::format("echo_bench: {} ops per case, batch {}, {} runs per case\n",
+                             packets, batch, repeat);
+    std::cout << std::format("{:<44} {:>12} {:>14} {:>14} {:>9}\n", "case", "cycles/op",
+                             "ns/op (median)", "ops/s", "spread");
+    const auto timestamp_ms = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count());
+    for (const auto& c : cases) {
+        if (!filter.empty() && c.name.find(filter) == std::string::npos) continue;
+        c.run();  // warm-up
+        std::vector<bench_result> runs;
+        for (size_t r = 0; r < repeat; ++r) runs.push_back(c.run());
+        const bench_summary s = summarize(std::move(runs));
+        const double ops_per_s = s.median.ns_per_op > 0.0 ? 1e9 / s.median.ns_per_op : 0.0;
+        // Spread: (max - min) / median of ns/op, a quick check that the result is repeatable.
+        const double spread =
+            s.median.ns_per_op > 0.0 ? (s.max_ns_per_op - s.min_ns_per_op) / s.median.ns_per_op
+                                     : 0.0;
+        std::cout << std::format("{:<44} {:>12.2f} {:>14.2f} {:>14.0f} {:>8.1f}%\n", c.name,
+                                 s.median.cycles_per_op, s.median.ns_per_op, ops_per_s,
+                                 100.0 * spread);
+        if (results) {
+            stats_row row;
+            row.add("timestamp_ms", timestamp_ms)
+                .add("label", label)
+                .add("case", c.name)
+                .add("unit", c.unit)
+                .add("ops", s.median.ops)
+                .add("runs", static_cast<uint64_t>(repeat))
+                .add("cycles_per_op", s.median.cycles_per_op)
+                .add("ns_per_op", s.median.ns_per_op)
+                .add("ns_per_op_min", s.min_ns_per_op)
+                .add("ns_per_op_max", s.max_ns_per_op)
+                .add("ops_per_s", ops_per_s);
+            results->write(row);
+            results->flush();
+        }
+    }
+
+    cleanup_winsock();
+    return 0;
+} catch (const std::exception& ex) {
+    std::cerr << std::format("Exception in main: {}\n", ex.what());
+    return 1;
+}
@@ -0,0 +1,542 @@
+/**
+ * @file client_worker.cpp
+ * @brief Client worker loop: paced sends, echo accounting and latency sampling.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "client_worker.hpp"
+
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <syncstream>
+
+#include "common/clock_offset.hpp"
+#include "common/io_context_pool.hpp"
+#include "common/iocp_timer.hpp"
+#include "common/timestamp.hpp"
+#include "common/tracing.hpp"
+
+/**
+ * @brief Record a sample (ns) into a per-worker digest and rotate when the threshold is reached.
+ *
+ * If the merge thread has not yet returned a cleared digest the rotation is
+ * deferred and the sample stays in the current digest. While deferred, the
+ * digest folds its buffer into centroids whenever a rotation's worth of
+ * samples is buffered, so the buffer stays within the size it already
+ * reached instead of growing until the merge thread catches up. This never
+ * blocks; it allocates only while the buffers first grow to rotation size.
+ *
+ * @param[in,out] digests The worker's digest exchange.
+ * @param[in] rotate_threshold Samples per digest before it is handed over.
+ * @param[in] sample_ns The sample in nanoseconds (recorded in ms).
+ */
+void post_sample(digest_exchange<TDigest>& digests, uint64_t rotate_threshold,
+                 uint64_t sample_ns) {
+    TDigest& current = digests.current();
+    current.add(static_cast<double>(sample_ns) / 1'000'000.0);  // convert to ms
+
+    if (current.total_weight() >= static_cast<double>(rotate_threshold) && !digests.rotate() &&
+        current.buffered_count() >= rotate_threshold) {
+        current.compress();
+    }
+}
+
+/**
+ * @brief Record a sample (ns) into a per-worker histogram and rotate when the threshold is reached.
+ *
+ * Recording is O(1) into a preallocated bucket array; rotation behaves as for digests.
+ */
+void post_sample(digest_exchange<latency_histogram>& histograms, uint64_t rotate_threshold,
+                 uint64_t sample_ns) {
+    latency_histogram& current = histograms.current();
+    current.record(sample_ns);
+
+    if (current.total_count() >= rotate_threshold) {
+        histograms.rotate();
+    }
+}
+
+/**
+ * @brief Split one stamped echo's RTT into client->server, dwell and server->client.
+ *
+ * The server's timestamps are on its own clock, so the one-way times use the
+ * worker's running offset estimate; the dwell needs no correction. The
+ * offset and the outbound leg use the actual send time rather than the
+ * intended one in `base.timestamp_ns`, so schedule lag is not mistaken for
+ * network latency. Echoes the server did not stamp (older server or another
+ * handler) are skipped.
+ */
+void record_one_way(client_worker_context& ctx, clock_offset_estimator& clock_offset,
+                    const packet_header_ext& ext, uint64_t recv_ns) {
+    if (ext.magic != PACKET_EXT_MAGIC || ext.version != PACKET_EXT_VERSION ||
+        ext.server_recv_ns == 0 || ext.server_send_ns < ext.server_recv_ns) {
+        return;
+    }
+    const uint64_t send_ns = ext.client_send_ns;
+    clock_offset.on_exchange(send_ns, ext.server_recv_ns, ext.server_send_ns, recv_ns);
+    if (!clock_offset.valid()) return;
+
+    const int64_t offset_ns = clock_offset.offset_ns();
+    const int64_t outbound_ns = static_cast<int64_t>(ext.server_recv_ns - send_ns) - offset_ns;
+    const int64_t inbound_ns = static_cast<int64_t>(recv_ns - ext.server_send_ns) + offset_ns;
+    ctx.server_stamped.add();
+    ctx.client_to_server.record(ctx.digest_rotate_samples,
+                                static_cast<uint64_t>((std::max)(outbound_ns, int64_t{0})));
+    ctx.server_dwell.record(ctx.digest_rotate_samples, ext.server_send_ns - ext.server_recv_ns);
+    ctx.server_to_client.record(ctx.digest_rotate_samples,
+                                static_cast<uint64_t>((std::max)(inbound_ns, int64_t{0})));
+}
+
+/**
+ * @brief Pick the target the next send goes to, or null if no target's pacer allows a send.
+ *
+ * Smooth weighted round-robin over the targets whose pacer can send: each
+ * earns its weight in credit, the richest is chosen and pays back the
+ * eligible total. Rate-limited targets are kept to their share by their own
+ * pacers; the weights matter when several could send at once (notably with
+ * an unlimited rate), and interleave the targets instead of sending in runs.
+ */
+worker_target* next_target(const std::vector<std::unique_ptr<worker_target>>& targets,
+                           uint64_t now_ns) {
+    if (targets.size() == 1) {
+        return targets.front()->pacer->can_send(now_ns) ? targets.front().get() : nullptr;
+    }
+    worker_target* chosen = nullptr;
+    int64_t eligible_weight = 0;
+    for (const auto& target : targets) {
+        if (!target->pacer->can_send(now_ns)) continue;
+        target->credit += target->weight;
+        eligible_weight += target->weight;
+        if (chosen == nullptr || target->credit > chosen->credit) chosen = target.get();
+    }
+    if (chosen != nullptr) chosen->credit -= eligible_weight;
+    return chosen;
+}
+
+void client_worker_thread_func(client_worker_context* ctx, size_t payload_size) try {
+    const client_config& config = *ctx->config;
+    // Set thread affinity to match socket affinity
+    set_thread_affinity(ctx->processor_id);
+
+    // Allocate IO contexts from slabs on this worker's NUMA node. Echoes are
+    // never larger than what we send, so buffers are sized to one datagram
+    // (or one USO burst for sends) instead of the maximum UDP payload.
+    const size_t depth = config.depth;
+    const size_t header_size = config.server_timestamps ? EXT_HEADER_SIZE : HEADER_SIZE;
+    const size_t datagram_size = header_size + payload_size;
+    const size_t send_buffer_size =
+        ctx->uso ? (std::min)(MAX_PACKET_SIZE, datagram_size * MAX_USO_SEGMENTS) : datagram_size;
+
+    // Spread `depth` receives over the sockets, but give every socket at least
+    // one so none of them stops receiving when there are more sockets than depth.
+    const size_t socket_count = ctx->sockets.size();
+    const size_t recvs_per_socket =
+        socket_count == 0 ? 0 : (depth + socket_count - 1) / socket_count;
+    io_context_pool recv_contexts(recvs_per_socket * socket_count, datagram_size, ctx->numa_node);
+    io_context_pool send_contexts(depth, send_buffer_size, ctx->numa_node);
+    // Receives stay posted until their socket closes; close the sockets
+    // before the pools backing those receives are released.
+    auto close_sockets = wil::scope_exit([&]() {
+        for (auto& cs : ctx->sockets) cs->socket.reset();
+    });
+
+    std::vector<io_context*> available_send_contexts;
+    for (auto& send_ctx : send_contexts) {
+        available_send_contexts.push_back(&send_ctx);
+    }
+
+    // Hand each socket its slice of the receive pool and post its receives.
+    for (size_t i = 0; i < socket_count; ++i) {
+        client_socket& cs = *ctx->sockets[i];
+        cs.recv_contexts = std::span<io_context>(recv_contexts.get(i * recvs_per_socket),
+                                                 recvs_per_socket);
+        for (auto& recv_ctx : cs.recv_contexts) {
+            if (const int error = post_recv(cs.socket, &recv_ctx); error != 0) {
+                trace_repost_failed(ctx->processor_id, error);
+            }
+        }
+    }
+
+    if (config.verbose)
+        std::osyncstream(std::cout) << std::format("[CPU {}] Worker started\n", ctx->processor_id);
+
+    // Wait for global start signal before sending so measurements align
+    while (!config.start_sending.load() && !config.shutdown.load()) {
+        std::this_thread::yield();
+    }
+
+    // Completion array reused by every dequeue.
+    const ULONG max_entries = static_cast<ULONG>(recv_contexts.size() + send_contexts.size());
+    std::vector<OVERLAPPED_ENTRY> entries(max_entries);
+
+    // Track every sequence sent within (roughly) two loss timeouts at the
+    // configured rate, so sequences normally resolve by echo or timeout before
+    // their slot is reused.
+    constexpr size_t MIN_SEQUENCE_WINDOW = 4096;
+    constexpr size_t MAX_SEQUENCE_WINDOW = size_t{1} << 24;
+    // Each target has its own window, sized for the target's share of the rate.
+    for (auto& target : ctx->targets) {
+        const size_t window_capacity =
+            target->rate_pps == 0.0
+                ? size_t{1} << 20
+                : std::clamp(static_cast<size_t>(target->rate_pps * 2.0 *
+                                                 static_cast<double>(config.loss_timeout_ns) / 1e9),
+                             MIN_SEQUENCE_WINDOW, MAX_SEQUENCE_WINDOW);
+        target->window = std::make_unique<sequence_window>(window_capacity, config.loss_timeout_ns);
+    }
+    // Losses count towards both the target and the worker's aggregate.
+    auto count_dropped = [ctx](worker_target& target, uint64_t dropped) {
+        target.packets_dropped.add(dropped);
+        ctx->packets_dropped.add(dropped);
+    };
+    auto pacer_target_rate_pps = [ctx]() {
+        double rate = 0.0;
+        for (const auto& target : ctx->targets) rate += target->pacer->get_target_rate_pps();
+        return rate;
+    };
+    clock_offset_estimator clock_offset;
+
+    // With `--pacing-wait timer` send deadlines arrive as completions on this
+    // worker's port, so one dequeue waits for both I/O and the pacer.
+    std::optional<iocp_timer> pacing_timer;
+    if (config.pacing == pacing_wait::timer) {
+        try {
+            pacing_timer.emplace(ctx->iocp.get(), reinterpret_cast<ULONG_PTR>(&pacing_timer));
+        } catch (const socket_exception& ex) {
+            std::osyncstream(std::cerr) << std::format(
+                "[Worker {}] {}; using hybrid pacing waits\n", ctx->processor_id, ex.what());
+        }
+    }
+
+    while (!config.shutdown.load()) {
+        // Declare sequences past their loss timeout lost as the run progresses.
+        const uint64_t pass_ns = get_timestamp_ns();
+        for (auto& target : ctx->targets) count_dropped(*target, target->window->expire(pass_ns));
+
+        uint64_t sent_so_far = ctx->packets_sent.load();
+        // Stop initiating new sends when ordered to stop, but keep processing
+        // completions so in-flight replies are counted instead of dropped.
+        const bool stop_sending = config.stop_sending.load();
+
+        const uint64_t sent_at_pass_start = sent_so_far;
+        // Latest clock reading of this pass: the pacers reuse each packet's send
+        // stamp instead of reading the clock again themselves.
+        uint64_t send_ns = pass_ns;
+        while (!stop_sending && !available_send_contexts.empty()) {
+            worker_target* target = next_target(ctx->targets, send_ns);
+            if (target == nullptr) break;
+            auto* send_ctx = available_send_contexts.back();
+            available_send_contexts.pop_back();
+
+            size_t total_size = datagram_size;
+
+            // With USO keep packing datagrams for this target into the context for
+            // as long as its token bucket allows a burst; otherwise send one per context.
+            const size_t max_segments =
+                ctx->uso ? (std::min)(MAX_USO_SEGMENTS, send_ctx->buffer.size() / total_size) : 1;
+            size_t segments = 0;
+            do {
+                // Build packet
+                packet_header* header = reinterpret_cast<packet_header*>(
+                    send_ctx->buffer.data() + segments * total_size);
+                const uint64_t target_sequence = target->next_sequence++;
+                header->sequence_number = target->sequence_tag | target_sequence;
+                // Stamp the intended send time, so RTT includes any time the open-loop
+                // schedule has fallen behind (the token bucket never lags).
+                const uint64_t now_ns = get_timestamp_ns();
+                send_ns = now_ns;
+                const uint64_t lag_ns = target->pacer->schedule_lag_ns(now_ns);
+                header->timestamp_ns = now_ns - lag_ns;
+                if (config.arrival != arrival_mode::constant) {
+                    ctx->schedule_lag.record(ctx->digest_rotate_samples, lag_ns);
+                    ctx->max_schedule_lag_ns.update_max(lag_ns);
+                }
+                if (config.server_timestamps) {
+                    auto* ext = reinterpret_cast<packet_header_ext*>(header);
+                    ext->magic = PACKET_EXT_MAGIC;
+                    ext->version = PACKET_EXT_VERSION;
+                    ext->flags = 0;
+                    ext->server_recv_ns = 0;
+                    ext->server_send_ns = 0;
+                    ext->client_send_ns = now_ns;
+                }
+
+                // Compute inter-packet pacing interval based on last send timestamp
+                if (ctx->last_send_timestamp_ns != 0) {
+                    uint64_t pacing_ns = now_ns - ctx->last_send_timestamp_ns;
+                    // Rotate approximately once a second based on per-worker rate
+                    ctx->pacing.record(ctx->digest_rotate_samples, pacing_ns);
+                }
+                ctx->last_send_timestamp_ns = now_ns;
+
+                count_dropped(*target, target->window->on_send(target_sequence, now_ns));
+                ++segments;
+
+                // Tell pacer the actual sequence number so congestion controllers
+                // that index by sequence (e.g., bandwidth estimators) can match
+                // sends to ACKs.
+                target->pacer->record_send(now_ns, header->sequence_number);
+            } while (segments < max_segments && target->pacer->can_send(send_ns));
+
+            // Round-robin pick a socket from this worker's sockets
+            client_socket& cs = *ctx->sockets[ctx->next_socket_index++ % ctx->sockets.size()];
+            const unique_socket& sock = cs.socket;
+            if (segments == 1) {
+                post_send_in_place(sock, send_ctx, total_size,
+                                   reinterpret_cast<sockaddr*>(&target->addr), target->addr_len);
+            } else {
+                post_send_segmented(sock, send_ctx, segments * total_size,
+                                    static_cast<DWORD>(total_size),
+                                    reinterpret_cast<sockaddr*>(&target->addr), target->addr_len);
+            }
+
+            target->packets_sent.add(segments);
+            ctx->packets_sent.add(segments);
+            cs.packets_sent.add(segments);
+            ctx->bytes_sent.add(segments * total_size);
+            ctx->send_calls.add(1);
+            sent_so_far += segments;
+        }
+
+        // Check for completions (use GetQueuedCompletionStatusEx to batch completions)
+        ULONG num_removed = 0;
+
+        // Wait for whichever target's pacer allows the next send first.
+        uint64_t wait_ns = UINT64_MAX;
+        for (const auto& target : ctx->targets) {
+            wait_ns = (std::min)(wait_ns, target->pacer->get_next_send_time_ns(send_ns));
+        }
+        // Once sending has stopped, just wait for echoes.
+        if (stop_sending) wait_ns = IOCP_TIMEOUT_MS * 1'000'000ULL;
+        // Summing the targets' rates costs a virtual call each; skip it unless traced.
+        if (trace_enabled(trace_keyword::PACER)) {
+            trace_pacer_decision(ctx->processor_id, sent_so_far - sent_at_pass_start, wait_ns,
+                                 pacer_target_rate_pps(), available_send_contexts.size());
+        }
+        // With a pacing timer, any wait above TIMER_SPIN_NS blocks in one dequeue
+        // until I/O completes or the timer's expiry is queued. Otherwise, the
+        // hybrid waiting strategy:
+        // - If wait > BUSY_SPIN_NS, block in kernel with GetQueuedCompletionStatusEx
+        //   using a timeout slightly smaller than the requested wait to avoid
+        //   oversleep due to scheduler granularity.
+        // - If wait <= BUSY_SPIN_NS, poll GQCSEx non-blocking and busy-wait (yield)
+        //   until the next send time to achieve sub-ms spacing.
+        // thresholds
+        constexpr uint64_t TIGHT_SPIN_NS = 200'000ULL;     // 200 us
+        constexpr uint64_t SHORT_SLEEP_NS = 2'000'000ULL;  // 2 ms
+        // Below this a timer round trip costs more than it saves; spin instead.
+        constexpr uint64_t TIMER_SPIN_NS = 50'000ULL;  // 50 us
+        DWORD timeout = 0;
+        BOOL ex_result = FALSE;
+
+        if (pacing_timer && wait_ns > TIMER_SPIN_NS && !stop_sending) {
+            // arm() returns false if the deadline already passed: just poll.
+            timeout = pacing_timer->arm(wait_ns) ? IOCP_TIMEOUT_MS : 0;
+            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
+                                                    &num_removed, timeout, FALSE);
+        } else if (wait_ns == 0) {
+            // can send now: non-blocking poll
+            timeout = 0;
+            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
+                                                    &num_removed, timeout, FALSE);
+        } else if (wait_ns > SHORT_SLEEP_NS) {
+            // longer waits: block in kernel for up to IOCP_TIMEOUT_MS
+            uint64_t wait_ms = (wait_ns + 999999ULL) / 1000000ULL;
+            timeout =
+                static_cast<DWORD>((std::min)(static_cast<uint64_t>(IOCP_TIMEOUT_MS), wait_ms));
+            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
+                                                    &num_removed, timeout, FALSE);
+        } else if (wait_ns > TIGHT_SPIN_NS) {
+            // moderate short wait: do a quick non-blocking poll then Sleep(0) until target
+            timeout = 0;
+            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
+                                                    &num_removed, timeout, FALSE);
+            if (num_removed == 0) {
+                // The pacer's wait runs from the pass's last clock reading.
+                const uint64_t deadline_ns = send_ns + wait_ns;
+                while (!config.shutdown.load() && get_timestamp_ns() < deadline_ns) {
+                    Sleep(0);
+                }
+            }
+        } else {
+            // very short wait: non-blocking poll and tight yield-based spin
+            timeout = 0;
+            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
+                                                    &num_removed, timeout, FALSE);
+            if (num_removed == 0) {
+                // The pacer's wait runs from the pass's last clock reading.
+                const uint64_t deadline_ns = send_ns + wait_ns;
+                while (!config.shutdown.load() && get_timestamp_ns() < deadline_ns) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        if (!ex_result) {
+            DWORD error = GetLastError();
+            if (error == WAIT_TIMEOUT) {
+                continue;
+            }
+            if (error == ERROR_INVALID_HANDLE || error == ERROR_ABANDONED_WAIT_0) {
+                // IOCP was closed, time to exit
+                continue;
+            }
+
+            std::osyncstream(std::cerr)
+                << std::format("[Worker {}] GetQueuedCompletionStatusEx failed with error: {}\n",
+                               ctx->processor_id, error);
+            // On other errors just continue the loop
+            continue;
+        }
+        const uint64_t poll_ns = get_timestamp_ns();
+        for (const auto& target : ctx->targets) target->pacer->poll(poll_ns);
+        ctx->target_rate_pps.store(pacer_target_rate_pps(), std::memory_order_relaxed);
+
+        if (num_removed == 0) {
+            continue;
+        }
+
+        uint32_t recv_completions = 0;
+        // Echoes in one batch were all dequeued at once; with --batch-timestamps
+        // their RTTs share this receive time (later echoes in the batch still wait
+        // for the earlier ones to be processed, which per-echo stamps would include).
+        const uint64_t batch_ns = config.batch_timestamps ? get_timestamp_ns() : 0;
+        for (ULONG ei = 0; ei < num_removed; ++ei) {
+            const OVERLAPPED_ENTRY& entry = entries[ei];
+            DWORD bytes_transferred = entry.dwNumberOfBytesTransferred;
+            ULONG_PTR completion_key = entry.lpCompletionKey;
+            LPOVERLAPPED overlapped = entry.lpOverlapped;
+            if (overlapped == nullptr) {
+                // The pacing timer expired; the next pass sends.
+                if (pacing_timer && completion_key == pacing_timer->key()) {
+                    pacing_timer->on_completion();
+                }
+                continue;
+            }
+
+            auto* io_ctx = static_cast<io_context*>(overlapped);
+            // Every socket is associated with its descriptor as the completion key.
+            auto* cs = reinterpret_cast<client_socket*>(completion_key);
+
+            if (io_ctx->operation == io_operation_type::recv) {
+                // Received echo response
+                ++recv_completions;
+                ctx->packets_received.add(1);
+                cs->packets_received.add(1);
+                ctx->bytes_received.add(bytes_transferred);
+
+                if (bytes_transferred >= HEADER_SIZE) {
+                    packet_header* header = reinterpret_cast<packet_header*>(io_ctx->buffer.data());
+                    // The top bits name the target; anything out of range is not ours.
+                    const uint64_t target_index = header->sequence_number >> TARGET_SEQUENCE_BITS;
+                    worker_target* target = target_index < ctx->targets.size()
+                                                ? ctx->targets[target_index].get()
+                                                : nullptr;
+                    const uint64_t sequence = header->sequence_number & TARGET_SEQUENCE_MASK;
+                    const echo_kind kind = target != nullptr ? target->window->on_echo(sequence)
+                                                             : echo_kind::unknown;
+                    if (target != nullptr) target->packets_received.add(1);
+                    switch (kind) {
+                        case echo_kind::reordered:
+                            ctx->packets_reordered.add(1);
+                            target->packets_reordered.add(1);
+                            break;
+                        case echo_kind::late:
+                            ctx->packets_late.add(1);
+                            target->packets_late.add(1);
+                            break;
+                        case echo_kind::duplicate:
+                            ctx->packets_duplicate.add(1);
+                            target->packets_duplicate.add(1);
+                            break;
+                        default:
+                            break;
+                    }
+
+                    // Duplicates and unknown sequences carry no new RTT information.
+                    if (kind != echo_kind::duplicate && kind != echo_kind::unknown) {
+                        uint64_t recv_time =
+                            config.batch_timestamps ? batch_ns : get_timestamp_ns();
+                        uint64_t rtt = recv_time - header->timestamp_ns;
+
+                        ctx->total_rtt_ns.add(rtt);
+                        ctx->min_rtt_ns.update_min(rtt);
+                        ctx->max_rtt_ns.update_max(rtt);
+                        target->total_rtt_ns.add(rtt);
+                        target->min_rtt_ns.update_min(rtt);
+                        target->max_rtt_ns.update_max(rtt);
+                        // Rotate approximately once a second based on rate.
+                        ctx->rtt.record(ctx->digest_rotate_samples, rtt);
+                        if (target->rtt.enabled()) {
+                            target->rtt.record(target->rtt_rotate_samples, rtt);
+                        }
+                        if (config.server_timestamps && bytes_transferred >= EXT_HEADER_SIZE) {
+                            record_one_way(*ctx, clock_offset,
+                                           *reinterpret_cast<const packet_header_ext*>(header),
+                                           recv_time);
+                        }
+                        // Feed acknowledgement into pacer congestion controller so it can
+                        // update bandwidth/RTT estimates. Provide sequence number from header.
+                        target->pacer->on_ack(recv_time, header->sequence_number, rtt);
+                    }
+                }
+
+                // Re-post receive on the socket that completed
+                if (const int error = post_recv(cs->socket, io_ctx); error != 0) {
+                    trace_repost_failed(ctx->processor_id, error);
+                }
+            } else {
+                // Send completed
+                available_send_contexts.push_back(io_ctx);
+            }
+        }
+        trace_completion_batch(ctx->processor_id, num_removed, recv_completions);
+    }
+
+    // Count remaining outstanding as dropped (add to any already tracked as dropped)
+    for (auto& target : ctx->targets) count_dropped(*target, target->window->expire_all());
+
+    // Hand the partially filled digests over for the final merge.
+    ctx->rtt.close();
+    for (auto& target : ctx->targets) {
+        if (target->rtt.enabled()) target->rtt.close();
+    }
+    ctx->pacing.close();
+    if (config.arrival != arrival_mode::constant) ctx->schedule_lag.close();
+    if (config.server_timestamps) {
+        ctx->client_to_server.close();
+        ctx->server_dwell.close();
+        ctx->server_to_client.close();
+    }
+
+    if (config.verbose) {
+        // Spread of echoes across sockets shows how evenly the source ports hash.
+        uint64_t min_socket_recv = UINT64_MAX, max_socket_recv = 0;
+        for (const auto& cs : ctx->sockets) {
+            min_socket_recv = (std::min)(min_socket_recv, cs->packets_received.load());
+            max_socket_recv = (std::max)(max_socket_recv, cs->packets_received.load());
+        }
+        std::osyncstream(std::cout) << std::format(
+            "[CPU {}] Worker shutting down. Stats: sent={}, recv={}, "
+            "dropped={}, per-socket recv min={} max={} ({} sockets), "
+            "deferred digest rotations rtt={} pacing={}\n",
+            ctx->processor_id, ctx->packets_sent.load(), ctx->packets_received.load(),
+            ctx->packets_dropped.load(), socket_count == 0 ? 0 : min_socket_recv, max_socket_recv,
+            socket_count, ctx->rtt.deferred_rotations(), ctx->pacing.deferred_rotations());
+    }
+} catch (const std::exception& ex) {
+    std::osyncstream(std::cerr) << std::format("[CPU {}] Worker thread exception: {}\n",
+                                               ctx->processor_id, ex.what());
+    // Shutdown on unhandled exception
+    ctx->config->shutdown.store(true);
+} catch (...) {
+    std::osyncstream(std::cerr) << std::format("[CPU {}] Worker thread unknown exception\n",
+                                               ctx->processor_id);
+    // Shutdown on unhandled exception
+    ctx->config->shutdown.store(true);
+}
+
@@ -0,0 +1,259 @@
+/**
+ * @file client_worker.hpp
+ * @brief Client worker contexts and the worker's send/receive completion loop.
+ *
+ * The workers read their settings and stop flags from a `client_config`
+ * shared by every worker of a run, so the client executable and the
+ * in-process loopback benchmark drive the same loop.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "common/counters.hpp"
+#include "common/digest_exchange.hpp"
+#include "common/latency_histogram.hpp"
+#include "common/pacer.hpp"
+#include "common/sequence_window.hpp"
+#include "common/socket_utils.hpp"
+#include "common/tdigest.hpp"
+
+// Send schedule (`--arrival`): the token bucket, or an open-loop arrival process.
+enum class arrival_mode { constant, poisson, on_off, trace };
+
+// How a worker waits for its next send (`--pacing-wait`): timed dequeues and
+// spinning, or a high-resolution timer that completes to the worker's IOCP.
+enum class pacing_wait { hybrid, timer };
+
+/**
+ * @brief Settings shared by the workers of one run, and the run's control flags.
+ *
+ * Set up before the workers start and read-only afterwards, except for the
+ * atomics.
+ */
+struct client_config {
+    /// If true, additional runtime information is logged.
+    bool verbose{false};
+    /// Receives kept posted (and send contexts available) per worker (`--depth`).
+    size_t depth{DEFAULT_OUTSTANDING_OPS};
+    arrival_mode arrival{arrival_mode::constant};
+    pacing_wait pacing{pacing_wait::hybrid};
+    /// Time after which an unechoed sequence is declared lost (`--loss-timeout-ms`).
+    uint64_t loss_timeout_ns{1'000'000'000ULL};
+    /// If true, send extended headers and decompose RTT using server timestamps.
+    bool server_timestamps{false};
+    /// If true, one timestamp taken after each completion dequeue serves as the receive
+    /// time of every echo in the batch instead of one per echo (`--batch-timestamps`).
+    bool batch_timestamps{false};
+    /// Set to true to request orderly termination of the workers.
+    std::atomic<bool> shutdown{false};
+    /// Start signal to synchronize when workers begin sending.
+    std::atomic<bool> start_sending{false};
+    /// Signal to stop sending but allow processing of outstanding replies.
+    std::atomic<bool> stop_sending{false};
+};
+
+/**
+ * @brief Per-socket descriptor; its address is the socket's IOCP completion key.
+ *
+ * Completions carry a pointer straight to the descriptor, so reposting a
+ * receive needs no lookup however many sockets a worker owns.
+ */
+struct client_socket {
+    /// The UDP socket, bound to its own ephemeral source port.
+    unique_socket socket;
+    /// This socket's slice of the worker's receive contexts (one or more).
+    std::span<io_context> recv_contexts;
+    /// Per-socket counters (worker thread only).
+    single_writer_counter packets_sent{0};
+    single_writer_counter packets_received{0};
+};
+
+/// Record a sample (ns) into a per-worker digest (in ms) or histogram, rotating it
+/// to the merge thread after `rotate_threshold` samples; see client_worker.cpp.
+void post_sample(digest_exchange<TDigest>& digests, uint64_t rotate_threshold,
+                 uint64_t sample_ns);
+void post_sample(digest_exchange<latency_histogram>& histograms, uint64_t rotate_threshold,
+                 uint64_t sample_ns);
+
+/**
+ * @brief One worker's samples of one latency metric.
+ *
+ * Samples go to the estimator selected by `--latency-estimator`: t-digests
+ * (in ms) or HDR histograms (in ns). Exactly one of the exchanges is allocated.
+ */
+struct worker_latency_series {
+    std::unique_ptr<digest_exchange<TDigest>> digests;
+    std::unique_ptr<digest_exchange<latency_histogram>> histograms;
+
+    /// Record a sample (ns), handing the estimator over after `rotate_threshold` samples.
+    void record(uint64_t rotate_threshold, uint64_t sample_ns) {
+        if (histograms) {
+            post_sample(*histograms, rotate_threshold, sample_ns);
+        } else {
+            post_sample(*digests, rotate_threshold, sample_ns);
+        }
+    }
+
+    /// Hand the partially filled estimator over for the final merge (worker exit).
+    void close() {
+        if (histograms) {
+            histograms->close();
+        } else {
+            digests->close();
+        }
+    }
+
+    /// Rotations deferred because the merge thread had not returned an estimator.
+    uint64_t deferred_rotations() const {
+        return histograms ? histograms->deferred_rotations() : digests->deferred_rotations();
+    }
+
+    /// Whether an estimator was allocated for this metric.
+    bool enabled() const { return histograms || digests; }
+};
+
+// The header sequence number carries a per-target sequence in its low
+// TARGET_SEQUENCE_BITS and the target's index above them.
+constexpr unsigned TARGET_SEQUENCE_BITS = 48;
+constexpr uint64_t TARGET_SEQUENCE_MASK = (uint64_t{1} << TARGET_SEQUENCE_BITS) - 1;
+/**
+ * @brief A worker's state for one target: pacer, sequence space and statistics.
+ *
+ * Every target has a sequence space of its own, so its sequence window and
+ * congestion controller see consecutive sequences and loss, reordering and
+ * RTT are attributed to the target the echo came back for.
+ */
+struct worker_target {
+    /// Destination address (copied from the target list).
+    sockaddr_storage addr{};
+    int addr_len{0};
+    /// Target index, already shifted above TARGET_SEQUENCE_BITS.
+    uint64_t sequence_tag{0};
+    /// Relative share of the worker's sends, and this target's rate (0 = unlimited).
+    uint32_t weight{1};
+    double rate_pps{0.0};
+    /// Smooth weighted round-robin credit (worker thread only).
+    int64_t credit{0};
+    /// Next per-target sequence number.
+    uint64_t next_sequence{0};
+    /// Paces this target's share of the worker's rate.
+    std::unique_ptr<client_send_pacer_base> pacer;
+    /// Outstanding sequences; created by the worker thread.
+    std::unique_ptr<sequence_window> window;
+    /// Per-target counters (worker thread only), mirroring the worker's aggregates.
+    alignas(CACHE_LINE_SIZE) single_writer_counter packets_sent{0};
+    single_writer_counter packets_received{0};
+    single_writer_counter packets_dropped{0};
+    single_writer_counter packets_reordered{0};
+    single_writer_counter packets_duplicate{0};
+    single_writer_counter packets_late{0};
+    single_writer_counter total_rtt_ns{0};
+    single_writer_counter min_rtt_ns{UINT64_MAX};
+    single_writer_counter max_rtt_ns{0};
+    /// RTT samples of this target; allocated only when there is more than one target.
+    worker_latency_series rtt;
+    uint64_t rtt_rotate_samples{0};
+};
+
+/**
+ * @brief Per-worker context holding sockets, IOCP and statistics.
+ *
+ * Each worker owns one IOCP and one or more UDP sockets affinitized to the
+ * worker's processor. The struct tracks per-worker counters for sent/recv
+ * packets, outstanding sequence numbers, and RTT aggregates.
+ */
+struct client_worker_context {
+    /// Settings and stop flags of the run this worker belongs to.
+    client_config* config{nullptr};
+    /// Logical processor this worker is affinitized to (global index).
+    uint32_t processor_id;
+    /// NUMA node of that processor; the worker's pools are allocated there.
+    uint32_t numa_node{0};
+    /// UDP socket descriptors owned by this worker (stable addresses).
+    std::vector<std::unique_ptr<client_socket>> sockets;
+    /// IO Completion Port used by this worker.
+    unique_iocp iocp;
+    /// Worker thread instance.
+    std::thread worker_thread;
+    /// Counters for packets sent/received/dropped. Written only by the worker
+    /// thread and kept on their own cache line(s) so the main thread's
+    /// snapshots do not contend with the worker's other state.
+    alignas(CACHE_LINE_SIZE) single_writer_counter packets_sent{0};
+    single_writer_counter packets_received{0};
+    /// Sequences declared lost: not echoed within the loss timeout, pushed out
+    /// of the sequence window, or still outstanding at shutdown.
+    single_writer_counter packets_dropped{0};
+    /// Echoes classified by the sequence window.
+    single_writer_counter packets_reordered{0};
+    single_writer_counter packets_duplicate{0};
+    single_writer_counter packets_late{0};
+    /// Counters for bytes sent/received and RTT aggregations.
+    single_writer_counter bytes_sent{0};
+    single_writer_counter bytes_received{0};
+    /// Number of send calls issued (less than `packets_sent` when USO batches datagrams).
+    single_writer_counter send_calls{0};
+    single_writer_counter total_rtt_ns{0};
+    single_writer_counter min_rtt_ns{UINT64_MAX};
+    single_writer_counter max_rtt_ns{0};
+
+    /// Servers this worker sends to, indexed like the target list.
+    alignas(CACHE_LINE_SIZE) std::vector<std::unique_ptr<worker_target>> targets;
+    /// Per-worker packet rate (packets per second) assigned from global total.
+    uint64_t per_worker_rate{0};
+    /// Index used to round-robin across multiple sockets.
+    size_t next_socket_index{0};
+    /// Pack pacer bursts into USO sends (set only when the stack supports it).
+    bool uso{false};
+
+    /// RTT and inter-packet pacing samples, handed to the merge thread without locking.
+    worker_latency_series rtt;
+    worker_latency_series pacing;
+    /// With `--server-timestamps`: client->server, server dwell and
+    /// server->client times of echoes the server stamped.
+    worker_latency_series client_to_server;
+    worker_latency_series server_dwell;
+    worker_latency_series server_to_client;
+    /// Echoes that carried server timestamps.
+    single_writer_counter server_stamped{0};
+    /// With an open-loop `--arrival`, how late each packet left relative to its intended time.
+    worker_latency_series schedule_lag;
+    single_writer_counter max_schedule_lag_ns{0};
+    /// Samples recorded into a digest before it is rotated to the merge thread.
+    uint64_t digest_rotate_samples{0};
+    /// Pacer target rate, published by the worker after each poll for `--stats-stream`.
+    std::atomic<double> target_rate_pps{0.0};
+    /// RTT percentiles of the most recently merged digest (about the last second),
+    /// published by the merge thread when `--stats-stream` is enabled.
+    std::atomic<double> window_rtt_p50_ms{std::numeric_limits<double>::quiet_NaN()};
+    std::atomic<double> window_rtt_p99_ms{std::numeric_limits<double>::quiet_NaN()};
+    // Last send timestamp (ns) used to compute inter-packet interval
+    uint64_t last_send_timestamp_ns{0};
+};
+
+// Digest rotation period in samples when the rate is unlimited (otherwise one
+// second's worth of the per-worker rate).
+constexpr uint64_t UNLIMITED_RATE_ROTATE_SAMPLES = 100'000;
+// Upper bound on the samples preallocated per recycled digest.
+constexpr uint64_t MAX_DIGEST_RESERVE_SAMPLES = 1 << 18;
+
+/**
+ * @brief Worker thread entrypoint.
+ *
+ * Each worker affinitizes the thread, posts a pool of receive operations,
+ * sends packets according to the per-worker rate quota, and processes IOCP
+ * completions for sends and receives until `config->shutdown` is set.
+ *
+ * @param ctx Pointer to the worker context owned by the caller.
+ * @param payload_size Size in bytes of the application payload (not including header).
+ */
+void client_worker_thread_func(client_worker_context* ctx, size_t payload_size);
@@ -24,461 +24,438 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iomanip>
-#include <mutex>
+#include <limits>
+#include <optional>
+#include <sstream>
 #include <syncstream>
-#include <unordered_set>
 
 #include "common/arg_parser.hpp"
 #include "common/bbr.hpp"
+#include "common/counters.hpp"
+#include "common/digest_exchange.hpp"
+#include "common/latency_histogram.hpp"
 #include "common/null_cc.hpp"
+#include "common/open_loop_pacer.hpp"
 #include "common/pacer.hpp"
 #include "common/reno.hpp"
+#include "common/rss_hash.hpp"
+#include "common/shared_congestion.hpp"
 #include "common/socket_utils.hpp"
+#include "common/stats_stream.hpp"
 #include "common/tdigest.hpp"
-
-// Global flag for shutdown; set to true to request orderly termination.
-std::atomic<bool> g_shutdown{false};
-// Global verbose flag; when true, additional runtime information is logged.
-std::atomic<bool> g_verbose{false};
-// Start signal to synchronize when workers begin sending
-std::atomic<bool> g_start_sending{false};
-// Signal to stop sending but allow processing of outstanding replies
-std::atomic<bool> g_stop_sending{false};
+#include "common/topology.hpp"
+#include "common/tracing.hpp"
+#include "client_worker.hpp"
+#include "sweep.hpp"
+
+#if ECHO_ETW_TRACING
+// ETW provider "WinUDPShardedEcho.Client"; the GUID is the ETW hash of that name,
+// so sessions can also enable it as *WinUDPShardedEcho.Client.
+TRACELOGGING_DEFINE_PROVIDER(g_trace_provider, "WinUDPShardedEcho.Client",
+                             (0x28c2dc29, 0xbf74, 0x579f, 0x60, 0x5a, 0x0e, 0x89, 0x94, 0x4b,
+                              0x83, 0x18));
+#endif
+
+// Settings and control flags shared by every worker of this run.
+client_config g_config;
 
 /**
  * @brief Signal handler that requests shutdown.
  *
- * Sets `g_shutdown` to true so worker threads can exit cleanly.
+ * Sets `g_config.shutdown` to true so worker threads can exit cleanly.
  */
 void signal_handler(int) {
-    g_shutdown.store(true);
+    g_config.shutdown.store(true);
 }
 
+// Most `--targets` one client accepts; picking a target is linear in the count.
+constexpr size_t MAX_TARGETS = 1024;
+
 /**
- * @brief Per-worker context holding sockets, IOCP and statistics.
- *
- * Each worker owns one IOCP and one or more UDP sockets affinitized to the
- * worker's processor. The struct tracks per-worker counters for sent/recv
- * packets, outstanding sequence numbers, and RTT aggregates.
+ * @brief One server endpoint the client sends to (`--server`/`--port`, or one of `--targets`).
  */
-struct client_worker_context {
-    /// Logical processor this worker is affinitized to.
-    uint32_t processor_id;
-    /// UDP sockets owned by this worker.
-    std::vector<unique_socket> sockets;
-    /// IO Completion Port used by this worker.
-    unique_iocp iocp;
-    /// Worker thread instance.
-    std::thread worker_thread;
-    /// Next sequence number to use for outgoing packets.
-    std::atomic<uint64_t> next_sequence{0};
-    /// Counters for packets sent/received/dropped.
-    std::atomic<uint64_t> packets_sent{0};
-    std::atomic<uint64_t> packets_received{0};
-    std::atomic<uint64_t> packets_dropped{0};
-    /// Counters for bytes sent/received and RTT aggregations.
-    std::atomic<uint64_t> bytes_sent{0};
-    std::atomic<uint64_t> bytes_received{0};
-    std::atomic<uint64_t> total_rtt_ns{0};
-    std::atomic<uint64_t> min_rtt_ns{UINT64_MAX};
-    std::atomic<uint64_t> max_rtt_ns{0};
-
-    /// Outstanding sequence numbers awaiting echo responses.
-    std::unordered_set<uint64_t> outstanding_sequences;
-
-    /// Target server address to send packets to.
-    sockaddr_storage server_addr;
-    /// Length of `server_addr`.
-    int server_addr_len;
-    /// Per-worker packet rate (packets per second) assigned from global total.
-    uint64_t per_worker_rate{0};
-    /// Index used to round-robin across multiple sockets.
-    std::atomic<size_t> next_socket_index{0};
-
-    std::unique_ptr<TDigest> curren_rtt_tdigest;
-    // Per-worker TDigest to collect inter-packet pacing (ms)
-    std::unique_ptr<TDigest> current_pacing_tdigest;
-    // Last send timestamp (ns) used to compute inter-packet interval
-    uint64_t last_send_timestamp_ns{0};
-    std::unique_ptr<client_send_pacer_base> pacer;
+struct client_target {
+    /// Endpoint as given on the command line (`host:port`).
+    std::string name;
+    /// Resolved address and its length.
+    sockaddr_storage addr{};
+    int addr_len{0};
+    /// Relative share of the sends.
+    uint32_t weight{1};
 };
 
-std::mutex g_worker_contexts_mutex;
-std::vector<std::unique_ptr<TDigest>>
-    g_worker_rtt_tdigests;  ///< Digest posted by each worker for merging.
-// Separate list for per-worker pacing TDigests
-std::vector<std::unique_ptr<TDigest>> g_worker_pacing_tdigests;
-
 // Packet rate limit total across all workers (packets per second, 0 = unlimited)
 // Each worker will be assigned an equal share (plus remainder distribution).
 uint64_t g_rate_limit = 10000;  // default total
 
-TDigest g_overall_rtt_tdigest(100.0);     ///< Global RTT TDigest for percentile estimation
-TDigest g_overall_pacing_tdigest(100.0);  ///< Global pacing TDigest (ms)
+// On/off burst pattern periods (`--on-ms` / `--off-ms`).
+uint64_t g_on_ns = 10'000'000ULL;
+uint64_t g_off_ns = 90'000'000ULL;
+// Recorded inter-arrival gaps for `--arrival trace` (`--arrival-trace`).
+std::shared_ptr<const std::vector<uint64_t>> g_arrival_trace;
+
+// Per-second, per-worker time-series export (`--stats-stream`); null when disabled.
+std::unique_ptr<stats_stream> g_stats_stream;
+
+// RTT/pacing percentile estimator (`--latency-estimator`): t-digest or HDR histogram.
+enum class latency_estimator { tdigest, hdr };
+latency_estimator g_latency_estimator = latency_estimator::tdigest;
+
+// With `--cc-shared`, the total rate re-split across workers by how well each keeps up.
+std::unique_ptr<shared_rate_state> g_shared_rate;
 
 /**
- * @brief Atomically update a target to the minimum of its current value and `value`.
+ * @brief Run-wide aggregate of one latency metric for the selected estimator.
  */
-void update_min(std::atomic<uint64_t>& target, uint64_t value) {
-    uint64_t current = target.load();
-    while (value < current && !target.compare_exchange_weak(current, value)) {
-        // current is updated by compare_exchange_weak
+struct latency_totals {
+    TDigest tdigest{100.0};       ///< In ms, `tdigest` estimator.
+    latency_histogram histogram;  ///< In ns, `hdr` estimator.
+
+    /// Percentile q in milliseconds from the selected estimator.
+    double percentile_ms(double q) const {
+        if (g_latency_estimator == latency_estimator::hdr) {
+            return histogram.percentile(q) / 1'000'000.0;
+        }
+        return tdigest.percentile(q);
     }
-}
+};
+
+latency_totals g_overall_rtt;     ///< Global RTT percentiles
+latency_totals g_overall_pacing;  ///< Global inter-packet pacing percentiles
+latency_totals g_overall_schedule_lag;  ///< Global open-loop schedule lag
+/// Global one-way decomposition (`--server-timestamps`).
+latency_totals g_overall_client_to_server;
+latency_totals g_overall_server_dwell;
+latency_totals g_overall_server_to_client;
+/// Per-target RTT, indexed like the target list (only with more than one target).
+std::vector<latency_totals> g_target_rtt;
 
 /**
- * @brief Atomically update a target to the maximum of its current value and `value`.
+ * @brief Merge everything `series` has handed over into `totals`.
+ *
+ * If `p50`/`p99` are given, each drained estimator's median and p99 (in ms)
+ * are published there, so they reflect roughly the last rotation period.
  */
-void update_max(std::atomic<uint64_t>& target, uint64_t value) {
-    uint64_t current = target.load();
-    while (value > current && !target.compare_exchange_weak(current, value)) {
-        // current is updated by compare_exchange_weak
+void drain_latency(worker_latency_series& series, latency_totals& totals,
+                   std::atomic<double>* p50 = nullptr, std::atomic<double>* p99 = nullptr) {
+    if (series.histograms) {
+        series.histograms->drain([&](const latency_histogram& h) {
+            if (p50 != nullptr) {
+                p50->store(h.percentile(0.5) / 1'000'000.0);
+                p99->store(h.percentile(0.99) / 1'000'000.0);
+            }
+            totals.histogram.merge(h);
+        });
+    } else if (series.digests) {
+        series.digests->drain([&](TDigest& d) {
+            if (p50 != nullptr) {
+                // Compressing first keeps the two percentile queries cheap.
+                d.compress();
+                p50->store(d.percentile(0.5));
+                p99->store(d.percentile(0.99));
+            }
+            totals.tdigest.merge(d);
+        });
     }
 }
+
 /**
- * @brief Merge per-worker RTT TDigests into the global RTT TDigest.
+ * @brief Merge the digests (or histograms) each worker has handed over into the global ones.
+ *
+ * Runs on the merge thread while workers are active, and once more on the
+ * main thread after the merge thread and the workers have been joined.
  */
-void merge_tdigest() {
-    std::lock_guard<std::mutex> lock(g_worker_contexts_mutex);
-    for (auto& worker_tdigest : g_worker_rtt_tdigests) {
-        if (worker_tdigest) {
-            g_overall_rtt_tdigest.merge(*worker_tdigest);
+void merge_latency(const std::vector<std::unique_ptr<client_worker_context>>& workers) {
+    const bool publish_window = g_stats_stream != nullptr;
+    for (const auto& ctx : workers) {
+        drain_latency(ctx->rtt, g_overall_rtt, publish_window ? &ctx->window_rtt_p50_ms : nullptr,
+                      publish_window ? &ctx->window_rtt_p99_ms : nullptr);
+        drain_latency(ctx->pacing, g_overall_pacing);
+        drain_latency(ctx->client_to_server, g_overall_client_to_server);
+        drain_latency(ctx->server_dwell, g_overall_server_dwell);
+        drain_latency(ctx->server_to_client, g_overall_server_to_client);
+        drain_latency(ctx->schedule_lag, g_overall_schedule_lag);
+        for (size_t t = 0; t < g_target_rtt.size() && t < ctx->targets.size(); ++t) {
+            drain_latency(ctx->targets[t]->rtt, g_target_rtt[t]);
         }
     }
-    g_worker_rtt_tdigests.resize(0);
-    g_overall_rtt_tdigest.compress();
-
-    // Merge pacing digests as well
-    for (auto& worker_p : g_worker_pacing_tdigests) {
-        if (worker_p) {
-            g_overall_pacing_tdigest.merge(*worker_p);
+    if (g_latency_estimator == latency_estimator::tdigest) {
+        for (latency_totals* totals : {&g_overall_rtt, &g_overall_pacing,
+                                       &g_overall_client_to_server, &g_overall_server_dwell,
+                                       &g_overall_server_to_client, &g_overall_schedule_lag}) {
+            totals->tdigest.compress();
         }
+        for (auto& totals : g_target_rtt) totals.tdigest.compress();
     }
-    g_worker_pacing_tdigests.resize(0);
-    g_overall_pacing_tdigest.compress();
 }
 
 /**
- * @brief Thread function that periodically merges per-worker RTT TDigests into the global digest.
+ * @brief Thread function that periodically merges per-worker estimators into the global ones.
  */
-void tdigest_merge_thread() {
-    while (!g_shutdown.load()) {
+void latency_merge_thread(const std::vector<std::unique_ptr<client_worker_context>>& workers) {
+    while (!g_config.shutdown.load()) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
 
-        // Merge per-worker RTT TDigests into global
-        merge_tdigest();
+        merge_latency(workers);
     }
 }
 
 /**
- * @brief Helper function to post RTT sample to per-worker TDigest and handle digest rotation.
+ * @brief Per-worker counter snapshot taken at the previous `--stats-stream` sample.
+ */
+struct worker_stats_snapshot {
+    uint64_t packets_sent{0};
+    uint64_t packets_received{0};
+    uint64_t packets_dropped{0};
+    uint64_t bytes_sent{0};
+    uint64_t bytes_received{0};
+};
+
+/**
+ * @brief Write one time-series row per worker to `g_stats_stream`.
  *
- * @param[in,out] current_digest The current per-worker TDigest.
- * @param[in] rtt_ns The RTT sample in nanoseconds.
+ * Runs on the main (progress) thread and only reads counters that workers
+ * publish with relaxed stores, so it never stalls a worker.
+ *
+ * @param previous Snapshots from the previous call; updated in place.
+ * @param elapsed_s Seconds since sending started.
+ * @param interval_s Seconds covered by this sample (rates are per second).
  */
-void post_rtt(std::unique_ptr<TDigest>& current_digest, uint64_t rotate_threshold,
-              uint64_t rtt_ns) {
-    if (!current_digest) {
-        current_digest = std::make_unique<TDigest>(100.0);
+void export_worker_stats(const std::vector<std::unique_ptr<client_worker_context>>& workers,
+                         std::vector<worker_stats_snapshot>& previous, double elapsed_s,
+                         double interval_s, const std::string& cc_choice) {
+    const uint64_t timestamp_ms = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count());
+    previous.resize(workers.size());
+    for (size_t i = 0; i < workers.size(); ++i) {
+        const auto& ctx = workers[i];
+        worker_stats_snapshot now;
+        now.packets_sent = ctx->packets_sent.load();
+        now.packets_received = ctx->packets_received.load();
+        now.packets_dropped = ctx->packets_dropped.load();
+        now.bytes_sent = ctx->bytes_sent.load();
+        now.bytes_received = ctx->bytes_received.load();
+        const worker_stats_snapshot& prev = previous[i];
+        auto rate = [interval_s](uint64_t cur, uint64_t old) {
+            return static_cast<double>(cur - old) / interval_s;
+        };
+
+        stats_row row;
+        row.add("timestamp_ms", timestamp_ms)
+            .add("elapsed_s", elapsed_s)
+            .add("role", "client")
+            .add("worker", static_cast<uint64_t>(ctx->processor_id))
+            .add("sent_pps", rate(now.packets_sent, prev.packets_sent))
+            .add("recv_pps", rate(now.packets_received, prev.packets_received))
+            .add("sent_bps", 8.0 * rate(now.bytes_sent, prev.bytes_sent))
+            .add("recv_bps", 8.0 * rate(now.bytes_received, prev.bytes_received))
+            .add("lost", now.packets_dropped - prev.packets_dropped)
+            .add("in_flight", now.packets_sent - (std::min)(now.packets_sent, now.packets_received))
+            .add("rtt_p50_ms", ctx->window_rtt_p50_ms.load())
+            .add("rtt_p99_ms", ctx->window_rtt_p99_ms.load())
+            .add("pacer_target_pps", ctx->target_rate_pps.load(std::memory_order_relaxed))
+            .add("cc", cc_choice);
+        g_stats_stream->write(row);
+        previous[i] = now;
     }
-    current_digest->add(static_cast<double>(rtt_ns) / 1'000'000.0);  // convert to ms
+    g_stats_stream->flush();
+}
 
-    if (current_digest->total_weight() >= static_cast<double>(rotate_threshold)) {
-        // Post to global for merging
-        {
-            std::lock_guard<std::mutex> lock(g_worker_contexts_mutex);
-            g_worker_rtt_tdigests.push_back(std::move(current_digest));
-        }
-        current_digest = nullptr;
+/**
+ * @brief Build a worker's token-bucket pacer, sharing congestion state through `shared` if set.
+ *
+ * @param rate The worker's initial rate in packets per second.
+ * @param shared The run's shared rate state, or null for an independent controller.
+ * @param worker_index The worker's slot in `shared`.
+ */
+template <class CongestionController>
+std::unique_ptr<client_send_pacer_base> make_token_bucket_pacer(double rate,
+                                                                shared_rate_state* shared,
+                                                                size_t worker_index) {
+    if (shared != nullptr) {
+        return std::make_unique<
+            client_send_pacer<shared_congestion_controller<CongestionController>>>(
+            rate, std::in_place, *shared, worker_index);
     }
+    return std::make_unique<client_send_pacer<CongestionController>>(rate);
 }
 
 /**
- * @brief Post a pacing sample (ns) to a per-worker TDigest and rotate when threshold reached.
+ * @brief One `--targets` entry before name resolution.
  */
-void post_pacing(std::unique_ptr<TDigest>& current_digest, uint64_t rotate_threshold,
-                 uint64_t pacing_ns) {
-    if (!current_digest) {
-        current_digest = std::make_unique<TDigest>(100.0);
+struct target_spec {
+    std::string host;
+    int port{0};
+    uint32_t weight{1};
+
+    /// `host:port`, with IPv6 literals in brackets.
+    std::string name() const {
+        return host.find(':') != std::string::npos ? std::format("[{}]:{}", host, port)
+                                                   : std::format("{}:{}", host, port);
     }
-    current_digest->add(static_cast<double>(pacing_ns) / 1'000'000.0);  // convert to ms
+};
 
-    if (current_digest->total_weight() >= static_cast<double>(rotate_threshold)) {
-        std::lock_guard<std::mutex> lock(g_worker_contexts_mutex);
-        g_worker_pacing_tdigests.push_back(std::move(current_digest));
-        current_digest = nullptr;
+/**
+ * @brief Parse `--targets`: comma-separated `HOST[:PORT][@WEIGHT]` entries.
+ *
+ * IPv6 literals that carry a port are written in brackets (`[::1]:7`).
+ * Entries without a port use `default_port`; weights default to 1.
+ *
+ * @throws std::invalid_argument on a malformed entry, port or weight, or too many entries.
+ */
+std::vector<target_spec> parse_target_list(const std::string& text, int default_port) {
+    constexpr unsigned long MAX_TARGET_WEIGHT = 1'000'000;
+    auto parse_number = [](const std::string& item, const std::string& value, const char* what,
+                           unsigned long max) {
+        char* end = nullptr;
+        const unsigned long number = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || number == 0 || number > max) {
+            throw std::invalid_argument(
+                std::format("Invalid {} in target '{}' (valid: 1-{})", what, item, max));
+        }
+        return number;
+    };
+
+    std::vector<target_spec> targets;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        target_spec spec;
+        spec.port = default_port;
+        std::string endpoint = item;
+        if (const size_t at = item.rfind('@'); at != std::string::npos) {
+            spec.weight = static_cast<uint32_t>(
+                parse_number(item, item.substr(at + 1), "weight", MAX_TARGET_WEIGHT));
+            endpoint = item.substr(0, at);
+        }
+        std::optional<std::string> port;
+        if (!endpoint.empty() && endpoint.front() == '[') {
+            const size_t close = endpoint.find(']');
+            if (close == std::string::npos ||
+                (close + 1 < endpoint.size() && endpoint[close + 1] != ':')) {
+                throw std::invalid_argument(std::format("Invalid target '{}'", item));
+            }
+            spec.host = endpoint.substr(1, close - 1);
+            if (close + 1 < endpoint.size()) port = endpoint.substr(close + 2);
+        } else if (std::count(endpoint.begin(), endpoint.end(), ':') == 1) {
+            const size_t colon = endpoint.find(':');
+            spec.host = endpoint.substr(0, colon);
+            port = endpoint.substr(colon + 1);
+        } else {
+            // A name, an IPv4 literal or a bare IPv6 literal.
+            spec.host = endpoint;
+        }
+        if (port) spec.port = static_cast<int>(parse_number(item, *port, "port", 65535));
+        if (spec.host.empty()) {
+            throw std::invalid_argument(std::format("Missing host in target '{}'", item));
+        }
+        targets.push_back(spec);
+    }
+    if (targets.empty()) throw std::invalid_argument("Empty --targets list");
+    if (targets.size() > MAX_TARGETS) {
+        throw std::invalid_argument(std::format("At most {} targets are supported", MAX_TARGETS));
     }
+    return targets;
 }
 
 /**
- * @brief Worker thread entrypoint.
+ * @brief Resolve a server name (hostname or IP literal), preferring IPv6, then IPv4.
  *
- * Each worker affinitizes the thread, posts a pool of receive operations,
- * sends packets according to the per-worker rate quota, and processes IOCP
- * completions for sends and receives.
- *
- * @param ctx Pointer to the worker context owned by the main thread.
- * @param payload_size Size in bytes of the application payload (not including header).
+ * @throws std::runtime_error if the name does not resolve.
  */
-void worker_thread_func(client_worker_context* ctx, size_t payload_size) try {
-    // Set thread affinity to match socket affinity
-    set_thread_affinity(ctx->processor_id);
-
-    // Allocate IO contexts
-    std::vector<std::unique_ptr<io_context>> contexts;
-    for (size_t i = 0; i < OUTSTANDING_OPS * 2; ++i) {
-        contexts.push_back(std::make_unique<io_context>());
-    }
+std::pair<sockaddr_storage, int> resolve_server(const std::string& host, int port) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
 
-    // Split into send and receive pools
-    std::vector<io_context*> available_recv_contexts;
-    std::vector<io_context*> available_send_contexts;
-    for (size_t i = 0; i < OUTSTANDING_OPS; ++i) {
-        available_recv_contexts.push_back(contexts[i].get());
-    }
-    for (size_t i = OUTSTANDING_OPS; i < contexts.size(); ++i) {
-        available_send_contexts.push_back(contexts[i].get());
+    addrinfo* res = nullptr;
+    std::string service_str = std::to_string(port);
+    using unique_addrinfo = std::unique_ptr<addrinfo, decltype(&freeaddrinfo)>;
+    int gai_err = getaddrinfo(host.c_str(), service_str.c_str(), &hints, &res);
+    if (gai_err != 0 || res == nullptr) {
+        throw std::runtime_error(std::format("getaddrinfo failed for {}:{} with error: {}", host,
+                                             port, gai_strerror(gai_err)));
     }
+    unique_addrinfo res_guard(res, freeaddrinfo);
 
-    // Post initial receive operations across this worker's sockets (round-robin)
-    if (!ctx->sockets.empty()) {
-        size_t sock_idx = 0;
-        while (!available_recv_contexts.empty()) {
-            auto* recv_ctx = available_recv_contexts.back();
-            available_recv_contexts.pop_back();
-            post_recv(ctx->sockets[sock_idx % ctx->sockets.size()], recv_ctx);
-            ++sock_idx;
+    // Prefer IPv6 result when available, otherwise prefer IPv4, otherwise take first result
+    addrinfo* chosen = nullptr;
+    // First pass: look for IPv6
+    for (addrinfo* ai = res; ai != nullptr; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET6) {
+            chosen = ai;
+            break;
         }
+        if (chosen == nullptr) chosen = ai;
     }
-
-    if (g_verbose.load())
-        std::osyncstream(std::cout) << std::format("[CPU {}] Worker started\n", ctx->processor_id);
-
-    // Wait for global start signal before sending so measurements align
-    while (!g_start_sending.load() && !g_shutdown.load()) {
-        std::this_thread::yield();
-    }
-
-    while (!g_shutdown.load()) {
-        uint64_t sent_so_far = ctx->packets_sent.load();
-        // Stop initiating new sends when ordered to stop; this allows in-flight
-        // replies to be processed and not counted as dropped.
-        if (g_stop_sending.load()) break;
-
-        while (!available_send_contexts.empty() && ctx->pacer->can_send()) {
-            auto* send_ctx = available_send_contexts.back();
-            available_send_contexts.pop_back();
-
-            // Build packet
-            packet_header* header = reinterpret_cast<packet_header*>(send_ctx->buffer.data());
-            header->sequence_number = ctx->next_sequence.fetch_add(1);
-            header->timestamp_ns = get_timestamp_ns();
-
-            // Compute inter-packet pacing interval based on last send timestamp
-            uint64_t now_ns = header->timestamp_ns;
-            if (ctx->last_send_timestamp_ns != 0) {
-                uint64_t pacing_ns = now_ns - ctx->last_send_timestamp_ns;
-                // Rotate approximately once a second based on per-worker rate
-                post_pacing(ctx->current_pacing_tdigest, ctx->per_worker_rate, pacing_ns);
-            }
-            ctx->last_send_timestamp_ns = now_ns;
-
-            size_t total_size = HEADER_SIZE + payload_size;
-
-            ctx->outstanding_sequences.insert(header->sequence_number);
-
-            // Round-robin pick a socket from this worker's sockets
-
-            post_send(ctx->sockets[ctx->next_socket_index.fetch_add(1) % ctx->sockets.size()],
-                      send_ctx, send_ctx->buffer.data(), total_size,
-                      reinterpret_cast<sockaddr*>(&ctx->server_addr), ctx->server_addr_len);
-
-            ctx->packets_sent.fetch_add(1);
-            ctx->bytes_sent.fetch_add(total_size);
-            sent_so_far++;
-
-            // Tell pacer the actual sequence number so congestion controllers
-            // that index by sequence (e.g., bandwidth estimators) can match
-            // sends to ACKs.
-            if (ctx->pacer) ctx->pacer->record_send(header->sequence_number);
-        }
-
-        // Check for completions (use GetQueuedCompletionStatusEx to batch completions)
-        const ULONG max_entries = static_cast<ULONG>(OUTSTANDING_OPS * 2);
-        std::vector<OVERLAPPED_ENTRY> entries(max_entries);
-        ULONG num_removed = 0;
-
-        uint64_t wait_ns = ctx->pacer->get_next_send_time_ns();
-        // Hybrid waiting strategy:
-        // - If wait > BUSY_SPIN_NS, block in kernel with GetQueuedCompletionStatusEx
-        //   using a timeout slightly smaller than the requested wait to avoid
-        //   oversleep due to scheduler granularity.
-        // - If wait <= BUSY_SPIN_NS, poll GQCSEx non-blocking and busy-wait (yield)
-        //   until the next send time to achieve sub-ms spacing.
-        // thresholds
-        constexpr uint64_t TIGHT_SPIN_NS = 200'000ULL;     // 200 us
-        constexpr uint64_t SHORT_SLEEP_NS = 2'000'000ULL;  // 2 ms
-        DWORD timeout = 0;
-        BOOL ex_result = FALSE;
-
-        if (wait_ns == 0) {
-            // can send now: non-blocking poll
-            timeout = 0;
-            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
-                                                    &num_removed, timeout, FALSE);
-        } else if (wait_ns > SHORT_SLEEP_NS) {
-            // longer waits: block in kernel for up to IOCP_TIMEOUT_MS
-            uint64_t wait_ms = (wait_ns + 999999ULL) / 1000000ULL;
-            timeout =
-                static_cast<DWORD>((std::min)(static_cast<uint64_t>(IOCP_TIMEOUT_MS), wait_ms));
-            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
-                                                    &num_removed, timeout, FALSE);
-        } else if (wait_ns > TIGHT_SPIN_NS) {
-            // moderate short wait: do a quick non-blocking poll then Sleep(0) until target
-            timeout = 0;
-            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
-                                                    &num_removed, timeout, FALSE);
-            if (num_removed == 0) {
-                uint64_t now =
-                    static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
-                                              std::chrono::steady_clock::now().time_since_epoch())
-                                              .count());
-                uint64_t target = now + wait_ns;
-                while (!g_shutdown.load()) {
-                    now = static_cast<uint64_t>(
-                        std::chrono::duration_cast<std::chrono::nanoseconds>(
-                            std::chrono::steady_clock::now().time_since_epoch())
-                            .count());
-                    if (now >= target) break;
-                    Sleep(0);
-                }
-            }
-        } else {
-            // very short wait: non-blocking poll and tight yield-based spin
-            timeout = 0;
-            ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
-                                                    &num_removed, timeout, FALSE);
-            if (num_removed == 0) {
-                uint64_t now =
-                    static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
-                                              std::chrono::steady_clock::now().time_since_epoch())
-                                              .count());
-                uint64_t target = now + wait_ns;
-                while (!g_shutdown.load()) {
-                    now = static_cast<uint64_t>(
-                        std::chrono::duration_cast<std::chrono::nanoseconds>(
-                            std::chrono::steady_clock::now().time_since_epoch())
-                            .count());
-                    if (now >= target) break;
-                    std::this_thread::yield();
-                }
+    // If no IPv6, try to find IPv4 explicitly (chosen may already be set to first result)
+    if (chosen == nullptr || chosen->ai_family != AF_INET6) {
+        for (addrinfo* ai = res; ai != nullptr; ai = ai->ai_next) {
+            if (ai->ai_family == AF_INET) {
+                chosen = ai;
+                break;
             }
         }
+    }
 
-        if (!ex_result) {
-            DWORD error = GetLastError();
-            if (error == WAIT_TIMEOUT) {
-                continue;
-            }
-            if (error == ERROR_INVALID_HANDLE || error == ERROR_ABANDONED_WAIT_0) {
-                // IOCP was closed, time to exit
-                continue;
-            }
+    if (chosen == nullptr) {
+        throw std::runtime_error(std::format("No suitable address found for {}:{}", host, port));
+    }
 
-            std::osyncstream(std::cerr)
-                << std::format("[Worker {}] GetQueuedCompletionStatusEx failed with error: {}\n",
-                               ctx->processor_id, error);
-            // On other errors just continue the loop
-            continue;
-        }
-        ctx->pacer->poll();
-
-        if (num_removed == 0) {
-            continue;
-        }
-
-        for (ULONG ei = 0; ei < num_removed; ++ei) {
-            const OVERLAPPED_ENTRY& entry = entries[ei];
-            DWORD bytes_transferred = entry.dwNumberOfBytesTransferred;
-            ULONG_PTR completion_key = entry.lpCompletionKey;
-            LPOVERLAPPED overlapped = entry.lpOverlapped;
-            if (overlapped == nullptr) continue;
-
-            auto* io_ctx = static_cast<io_context*>(overlapped);
-
-            if (io_ctx->operation == io_operation_type::recv) {
-                // Received echo response
-                ctx->packets_received.fetch_add(1);
-                ctx->bytes_received.fetch_add(bytes_transferred);
-
-                if (bytes_transferred >= HEADER_SIZE) {
-                    packet_header* header = reinterpret_cast<packet_header*>(io_ctx->buffer.data());
-                    uint64_t recv_time = get_timestamp_ns();
-                    uint64_t rtt = recv_time - header->timestamp_ns;
-
-                    ctx->total_rtt_ns.fetch_add(rtt);
-                    update_min(ctx->min_rtt_ns, rtt);
-                    update_max(ctx->max_rtt_ns, rtt);
-                    // Rotate approximately once a second based on rate.
-                    post_rtt(ctx->curren_rtt_tdigest, ctx->per_worker_rate, rtt);
-                    ctx->outstanding_sequences.erase(header->sequence_number);
-                    // Feed acknowledgement into pacer congestion controller so it can
-                    // update bandwidth/RTT estimates. Provide sequence number from header.
-                    if (ctx->pacer) ctx->pacer->on_ack(recv_time, header->sequence_number, rtt);
-                }
+    // Copy resolved sockaddr into storage and set length
+    sockaddr_storage addr = {};
+    std::memcpy(&addr, chosen->ai_addr, chosen->ai_addrlen);
+    return {addr, static_cast<int>(chosen->ai_addrlen)};
+}
 
-                // Re-post receive on the socket that completed
-                SOCKET s = static_cast<SOCKET>(completion_key);
-                // Find the unique_socket corresponding to this SOCKET
-                auto it = std::find_if(ctx->sockets.begin(), ctx->sockets.end(),
-                                       [s](const unique_socket& us) { return us.get() == s; });
-                if (it != ctx->sockets.end()) {
-                    post_recv(*it, io_ctx);
-                } else if (!ctx->sockets.empty()) {
-                    throw std::runtime_error(
-                        std::format("Worker {}: Received completion for unknown socket {}",
-                                    ctx->processor_id, s));
-                }
-            } else {
-                // Send completed
-                available_send_contexts.push_back(io_ctx);
+/**
+ * @brief Wait until the server at `addr` echoes a probe datagram (`--wait-ready`).
+ *
+ * Sends a probe from a temporary socket every 100 ms until one comes back or
+ * `timeout_ms` passes. A server that is not listening yet shows up as a
+ * receive timeout or an ICMP port unreachable (WSAECONNRESET); both just
+ * mean "try again". An answer means the shard the probe hashed to is
+ * receiving; the server starts all its shards together, in parallel. Needs
+ * a server handler that replies (echo or timestamp).
+ *
+ * @return true once the server answered, false on timeout or shutdown.
+ */
+bool wait_for_server_ready(const sockaddr_storage& addr, int addr_len, uint32_t timeout_ms) {
+    constexpr DWORD PROBE_INTERVAL_MS = 100;
+    unique_socket sock = create_udp_socket(addr.ss_family);
+    set_socket_option(sock, SOL_SOCKET, SO_RCVTIMEO,
+                      reinterpret_cast<const char*>(&PROBE_INTERVAL_MS),
+                      sizeof(PROBE_INTERVAL_MS));
+
+    // The probe's sequence number can never be one of a run's.
+    packet_header probe = {};
+    probe.sequence_number = UINT64_MAX;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!g_config.shutdown.load() && std::chrono::steady_clock::now() < deadline) {
+        const auto probe_time = std::chrono::steady_clock::now();
+        try {
+            send_sync(sock, reinterpret_cast<const char*>(&probe), sizeof(probe),
+                      reinterpret_cast<const sockaddr*>(&addr), addr_len);
+            packet_header reply = {};
+            const int received =
+                recvfrom(sock.get(), reinterpret_cast<char*>(&reply), sizeof(reply), 0, nullptr,
+                         nullptr);
+            if (received == static_cast<int>(sizeof(reply)) &&
+                reply.sequence_number == probe.sequence_number) {
+                return true;
             }
+        } catch (const socket_exception&) {
+            // No route yet (e.g. an interface still coming up); retry.
         }
+        // A port-unreachable error returns at once; keep to the probe interval.
+        std::this_thread::sleep_until(probe_time + std::chrono::milliseconds(PROBE_INTERVAL_MS));
     }
-
-    // Count remaining outstanding as dropped (add to any already tracked as dropped)
-    ctx->packets_dropped.fetch_add(ctx->outstanding_sequences.size());
-
-    // Post to global for merging
-    {
-        std::lock_guard<std::mutex> lock(g_worker_contexts_mutex);
-        g_worker_rtt_tdigests.push_back(std::move(ctx->curren_rtt_tdigest));
-    }
-    ctx->curren_rtt_tdigest = nullptr;
-    // Also post pacing digest
-    {
-        std::lock_guard<std::mutex> lock(g_worker_contexts_mutex);
-        g_worker_pacing_tdigests.push_back(std::move(ctx->current_pacing_tdigest));
-    }
-    ctx->current_pacing_tdigest = nullptr;
-
-    if (g_verbose.load())
-        std::osyncstream(std::cout) << std::format(
-            "[CPU {}] Worker shutting down. Stats: sent={}, recv={}, "
-            "dropped={}\n",
-            ctx->processor_id, ctx->packets_sent.load(), ctx->packets_received.load(),
-            ctx->packets_dropped.load());
-} catch (const std::exception& ex) {
-    std::osyncstream(std::cerr) << std::format("[CPU {}] Worker thread exception: {}\n",
-                                               ctx->processor_id, ex.what());
-    // Shutdown on unhandled exception
-    g_shutdown.store(true);
-} catch (...) {
-    std::osyncstream(std::cerr) << std::format("[CPU {}] Worker thread unknown exception\n",
-                                               ctx->processor_id);
-    // Shutdown on unhandled exception
-    g_shutdown.store(true);
+    return false;
 }
 
 /**
@@ -494,9 +471,17 @@ int main(int argc, char* argv[]) try {
     parser.add_option("verbose", 'v', "0", false, "Enable verbose logging");
     parser.add_option("server", 's', "", true, "Server IP address or hostname");
     parser.add_option("port", 'p', "7", true, "Server UDP port (default: 7)");
+    parser.add_option("targets", '\0', "", true,
+                      "Send to several servers instead of --server: HOST[:PORT][@WEIGHT],...");
     parser.add_option("payload", 'l', "64", true, "Payload size in bytes (default: 64)");
     parser.add_option("cores", 'c', "0", true, "Number of CPU cores to use (default: all)");
+    parser.add_option("placement", '\0', "compact", true,
+                      "Worker placement: compact|spread|nic-local (default: compact)");
+    parser.add_option("cpus", '\0', "", true,
+                      "Explicit worker CPUs, e.g. 0-3,8 (overrides --cores and --placement)");
     parser.add_option("duration", 'd', "10", true, "Test duration in seconds (default: 10)");
+    parser.add_option("wait-ready", '\0', "0", true,
+                      "Wait up to N ms for every server to echo a probe before starting");
     parser.add_option("rate", 'r', "10000", true,
                       "Total packet rate limit (packets/sec, 0=unlimited)");
     parser.add_option("cc", 'C', "null", true,
@@ -505,6 +490,57 @@ int main(int argc, char* argv[]) try {
                       "Socket receive buffer size in bytes (default: 4194304)");
     parser.add_option("sockets", 'k', "16", true, "Number of sockets per worker (default: 16)");
     parser.add_option("stats-file", 'o', "", true, "Output statistics to specified file");
+    parser.add_option("stats-stream", '\0', "", true,
+                      "Per-second per-worker samples to "
+                      "csv:FILE|ndjson:FILE|udp:HOST:PORT|pipe:NAME");
+    parser.add_option("uso", 'g', "0", false,
+                      "Send pacer bursts with UDP send segmentation offload (USO)");
+    parser.add_option("loss-timeout-ms", '\0', "1000", true,
+                      "Declare a packet lost if not echoed within N ms (default: 1000)");
+    parser.add_option("depth", 'q', std::to_string(DEFAULT_OUTSTANDING_OPS), true,
+                      "Receives posted and sends in flight per worker (default: 16)");
+    parser.add_option("pacing-wait", '\0', "hybrid", true,
+                      "Wait for the next send: hybrid|timer (default: hybrid)");
+    parser.add_option("clock", '\0', "qpc", true,
+                      "Timestamp counter: qpc|tsc (tsc needs an invariant TSC; default: qpc)");
+    parser.add_option("batch-timestamps", '\0', "0", false,
+                      "Take one receive timestamp per completion batch instead of per echo");
+    parser.add_option("latency-estimator", '\0', "tdigest", true,
+                      "RTT/pacing percentile estimator: tdigest|hdr (default: tdigest)");
+    parser.add_option("cc-shared", '\0', "0", false,
+                      "Re-split --rate across workers toward those whose echoes keep up");
+    parser.add_option("rss-queues", '\0', "0", true,
+                      "Pick source ports that spread sockets evenly over N server RSS queues");
+    parser.add_option("rss-table", '\0', "", true,
+                      "Server RSS indirection table as comma-separated queues (implies RSS ports)");
+    parser.add_option("rss-key", '\0', "", true,
+                      "Server RSS Toeplitz key in hex (default: the Microsoft default key)");
+    parser.add_option("arrival", 'A', "constant", true,
+                      "Send schedule: constant|poisson|onoff|trace (default: constant)");
+    parser.add_option("on-ms", '\0', "10", true,
+                      "--arrival onoff: burst length in ms (default: 10)");
+    parser.add_option("off-ms", '\0', "90", true,
+                      "--arrival onoff: silence between bursts in ms (default: 90)");
+    parser.add_option("arrival-trace", '\0', "", true,
+                      "--arrival trace: file of inter-arrival times in us, one per line");
+    parser.add_option("server-timestamps", 'T', "0", false,
+                      "Send extended headers and report one-way latency from server timestamps");
+    parser.add_option("sweep", '\0', "", true,
+                      "Find the max sustainable --rate per configuration: step|binary");
+    parser.add_option("sweep-rates", '\0', "10000:1000000:10000", true,
+                      "--sweep: MIN:MAX:STEP total rates (binary: STEP is the resolution)");
+    parser.add_option("sweep-cores", '\0', "", true,
+                      "--sweep: comma-separated --cores values (default: --cores)");
+    parser.add_option("sweep-sockets", '\0', "", true,
+                      "--sweep: comma-separated --sockets values (default: --sockets)");
+    parser.add_option("sweep-payloads", '\0', "", true,
+                      "--sweep: comma-separated --payload values (default: --payload)");
+    parser.add_option("max-loss-pct", '\0', "1.0", true,
+                      "--sweep: highest sustainable loss percentage (default: 1.0)");
+    parser.add_option("max-p99-ms", '\0', "0", true,
+                      "--sweep: highest sustainable p99 RTT in ms (default: 0 = no limit)");
+    parser.add_option("sweep-report", '\0', "sweep.json", true,
+                      "--sweep: JSON report of every configuration's curve");
     parser.add_option("help", 'h', "0", false, "Show this help message");
 
     parser.parse(argc, argv);
@@ -524,33 +560,109 @@ int main(int argc, char* argv[]) try {
     const std::string sockets_str = parser.get("sockets");
     const std::string cc_choice = parser.get("cc");
     const std::string stats_file = parser.get("stats-file");
+    const std::string stats_stream_spec = parser.get("stats-stream");
     const std::string verbose_str = parser.get("verbose");
+    const std::string depth_str = parser.get("depth");
+    const std::string loss_timeout_str = parser.get("loss-timeout-ms");
+    const std::string estimator_str = parser.get("latency-estimator");
+    const std::string arrival_str = parser.get("arrival");
+    bool uso = parser.is_set("uso");
+    g_config.server_timestamps = parser.is_set("server-timestamps");
     size_t payload_size = 0;
     int duration_sec = 0;
     if (!verbose_str.empty() && verbose_str != "0") {
-        g_verbose.store(true);
+        g_config.verbose = true;
     }
 
-    if (server_str.empty() || port_arg.empty()) {
+    const std::string targets_str = parser.get("targets");
+    if ((server_str.empty() && targets_str.empty()) || port_arg.empty()) {
         std::cerr << "Server and port are required\n";
         parser.print_help(argv[0]);
         return 1;
     }
+    if (!server_str.empty() && !targets_str.empty()) {
+        throw std::invalid_argument("--server and --targets are mutually exclusive");
+    }
 
-    const char* server_ip = server_str.c_str();
     char* endptr = nullptr;
     long port_l = std::strtol(port_arg.c_str(), &endptr, 10);
     if (endptr == port_arg.c_str() || port_l <= 0 || port_l > 65535) {
         throw std::invalid_argument("Invalid port number");
     }
     int port = static_cast<int>(port_l);
+    // --port is the default for --targets entries that do not name one.
+    const std::vector<target_spec> target_specs =
+        targets_str.empty() ? std::vector<target_spec>{{server_str, port, 1}}
+                            : parse_target_list(targets_str, port);
 
     payload_size = static_cast<size_t>(std::strtoul(payload_str.c_str(), nullptr, 10));
-    if (payload_size == 0 || payload_size > MAX_PAYLOAD_SIZE) {
+    const size_t max_payload =
+        g_config.server_timestamps ? MAX_PACKET_SIZE - EXT_HEADER_SIZE : MAX_PAYLOAD_SIZE;
+    if (payload_size == 0 || payload_size > max_payload) {
         throw std::invalid_argument("Invalid payload size");
     }
 
-    uint32_t num_processors = get_processor_count();
+    long depth_l = std::strtol(depth_str.c_str(), &endptr, 10);
+    if (endptr == depth_str.c_str() || depth_l <= 0 ||
+        static_cast<size_t>(depth_l) > MAX_OUTSTANDING_OPS) {
+        throw std::invalid_argument(
+            std::format("Invalid depth (valid: 1-{})", MAX_OUTSTANDING_OPS));
+    }
+    g_config.depth = static_cast<size_t>(depth_l);
+
+    long long loss_timeout_ms = std::strtoll(loss_timeout_str.c_str(), &endptr, 10);
+    if (endptr == loss_timeout_str.c_str() || loss_timeout_ms <= 0) {
+        throw std::invalid_argument("Invalid loss timeout");
+    }
+    g_config.loss_timeout_ns = static_cast<uint64_t>(loss_timeout_ms) * 1'000'000ULL;
+
+    if (estimator_str == "hdr") {
+        g_latency_estimator = latency_estimator::hdr;
+    } else if (estimator_str != "tdigest") {
+        std::cerr << std::format("Unknown latency estimator: {}\n", estimator_str);
+        std::cerr << "Valid options: tdigest|hdr\n";
+        return 1;
+    }
+
+    const std::string pacing_wait_str = parser.get("pacing-wait");
+    if (pacing_wait_str == "timer") {
+        g_config.pacing = pacing_wait::timer;
+    } else if (pacing_wait_str != "hybrid") {
+        throw std::invalid_argument(
+            std::format("Unknown pacing wait: {} (valid: hybrid|timer)", pacing_wait_str));
+    }
+    const timestamp_source requested_clock = parse_timestamp_source(parser.get("clock"));
+    g_config.batch_timestamps = parser.is_set("batch-timestamps");
+    const std::string wait_ready_str = parser.get("wait-ready");
+    const long long wait_ready_ms = std::strtoll(wait_ready_str.c_str(), &endptr, 10);
+    if (endptr == wait_ready_str.c_str() || *endptr != '\0' || wait_ready_ms < 0) {
+        throw std::invalid_argument("Invalid --wait-ready (need N >= 0 ms)");
+    }
+
+    if (arrival_str == "poisson") {
+        g_config.arrival = arrival_mode::poisson;
+    } else if (arrival_str == "onoff") {
+        g_config.arrival = arrival_mode::on_off;
+        const long long on_ms = std::strtoll(parser.get("on-ms").c_str(), nullptr, 10);
+        const long long off_ms = std::strtoll(parser.get("off-ms").c_str(), nullptr, 10);
+        if (on_ms <= 0 || off_ms < 0) {
+            throw std::invalid_argument("Invalid on/off periods (need --on-ms > 0, --off-ms >= 0)");
+        }
+        g_on_ns = static_cast<uint64_t>(on_ms) * 1'000'000ULL;
+        g_off_ns = static_cast<uint64_t>(off_ms) * 1'000'000ULL;
+    } else if (arrival_str == "trace") {
+        g_config.arrival = arrival_mode::trace;
+        if (parser.get("arrival-trace").empty()) {
+            throw std::invalid_argument("--arrival trace requires --arrival-trace <file>");
+        }
+        g_arrival_trace = trace_arrivals::load(parser.get("arrival-trace"));
+    } else if (arrival_str != "constant") {
+        throw std::invalid_argument(std::format(
+            "Unknown arrival process: {} (valid: constant|poisson|onoff|trace)", arrival_str));
+    }
+
+    const processor_topology topology = processor_topology::discover();
+    uint32_t num_processors = static_cast<uint32_t>(topology.processors.size());
     uint32_t num_workers = num_processors;
     duration_sec = static_cast<int>(std::strtol(duration_str.c_str(), nullptr, 10));
     if (!cores_str.empty()) {
@@ -559,28 +671,163 @@ int main(int argc, char* argv[]) try {
             num_workers = static_cast<uint32_t>(requested);
         }
     }
+    const placement_policy placement = parse_placement_policy(parser.get("placement"));
+    const std::vector<uint32_t> cpu_list =
+        parser.is_set("cpus") ? parse_cpu_list(parser.get("cpus")) : std::vector<uint32_t>{};
+    if (!cpu_list.empty()) num_workers = static_cast<uint32_t>(cpu_list.size());
 
     g_rate_limit = static_cast<uint64_t>(std::strtoull(rate_str.c_str(), nullptr, 10));
+    if (g_rate_limit == 0 &&
+        (g_config.arrival == arrival_mode::poisson || g_config.arrival == arrival_mode::on_off)) {
+        throw std::invalid_argument("--arrival poisson|onoff needs a non-zero --rate");
+    }
+    if (g_config.arrival != arrival_mode::constant && !cc_choice.empty() && cc_choice != "null") {
+        std::cerr << "--cc is ignored with an open-loop --arrival\n";
+    }
+    const bool cc_shared = parser.is_set("cc-shared") && g_config.arrival == arrival_mode::constant;
+    if (parser.is_set("cc-shared") && !cc_shared) {
+        std::cerr << "--cc-shared is ignored with an open-loop --arrival\n";
+    }
+    if (cc_shared && g_rate_limit == 0) {
+        throw std::invalid_argument("--cc-shared needs a non-zero --rate to split");
+    }
     int sockets_per_worker = static_cast<int>(std::strtol(sockets_str.c_str(), nullptr, 10));
     if (sockets_per_worker <= 0) sockets_per_worker = 1;
 
+    // RSS-aware source ports: model the server NIC's hash and bind each
+    // socket to a port that lands on the queue it is assigned.
+    std::optional<rss_model> rss;
+    const uint32_t rss_queues =
+        static_cast<uint32_t>(std::strtoul(parser.get("rss-queues").c_str(), nullptr, 10));
+    if (rss_queues > 0 || parser.is_set("rss-table")) {
+        rss.emplace();
+        rss->indirection_table = parser.is_set("rss-table")
+                                     ? parse_rss_table(parser.get("rss-table"))
+                                     : rss_model::round_robin_table(rss_queues);
+        if (parser.is_set("rss-key")) rss->key = parse_rss_key(parser.get("rss-key"));
+        if (rss_queues > 0 && rss_queues != rss->queue_count()) {
+            throw std::invalid_argument(
+                std::format("--rss-queues {} does not match the {} queue(s) in --rss-table",
+                            rss_queues, rss->queue_count()));
+        }
+    }
+
     // Parse receive buffer size for sockets (default 4MB)
     int recvbuf = 4194304;
     if (!recvbuf_str.empty()) {
         long v = std::strtol(recvbuf_str.c_str(), nullptr, 10);
         if (v > 0) recvbuf = static_cast<int>(v);
     }
+    // With --sweep this process only drives the search: each point is a child client run.
+    const std::string sweep_str = parser.get("sweep");
+    if (!sweep_str.empty()) {
+        sweep_config sweep;
+        if (sweep_str == "binary") {
+            sweep.mode = sweep_config::search::binary;
+        } else if (sweep_str != "step") {
+            throw std::invalid_argument(
+                std::format("Unknown sweep mode: {} (valid: step|binary)", sweep_str));
+        }
+        if (g_config.arrival == arrival_mode::trace) {
+            throw std::invalid_argument("--sweep cannot vary the rate of --arrival trace");
+        }
+        const std::string rates_str = parser.get("sweep-rates");
+        const char* cursor = rates_str.c_str();
+        for (uint64_t* field : {&sweep.rate_min, &sweep.rate_max, &sweep.rate_step}) {
+            *field = std::strtoull(cursor, &endptr, 10);
+            cursor = *endptr == ':' ? endptr + 1 : endptr;
+        }
+        if (*endptr != '\0' || sweep.rate_min == 0 || sweep.rate_max < sweep.rate_min ||
+            sweep.rate_step == 0) {
+            throw std::invalid_argument(
+                "Invalid --sweep-rates (need MIN:MAX:STEP with 0 < MIN <= MAX and STEP > 0)");
+        }
+        auto list_or = [&](const char* name, uint32_t fallback) {
+            const std::string list = parser.get(name);
+            return list.empty() ? std::vector<uint32_t>{fallback} : parse_sweep_list(list);
+        };
+        sweep.cores = list_or("sweep-cores", num_workers);
+        sweep.sockets = list_or("sweep-sockets", static_cast<uint32_t>(sockets_per_worker));
+        sweep.payloads = list_or("sweep-payloads", static_cast<uint32_t>(payload_size));
+        for (uint32_t payload : sweep.payloads) {
+            if (payload == 0 || payload > max_payload) {
+                throw std::invalid_argument(std::format("Invalid sweep payload size {}", payload));
+            }
+        }
+        sweep.max_loss_pct = std::strtod(parser.get("max-loss-pct").c_str(), nullptr);
+        sweep.max_p99_ms = std::strtod(parser.get("max-p99-ms").c_str(), nullptr);
+        sweep.duration_sec = duration_sec;
+        if (!stats_file.empty() || !stats_stream_spec.empty()) {
+            std::cerr << "--stats-file/--stats-stream are not passed to sweep runs\n";
+        }
+
+        std::string executable(MAX_PATH, '\0');
+        DWORD length = 0;
+        while ((length = GetModuleFileNameA(nullptr, executable.data(),
+                                            static_cast<DWORD>(executable.size()))) ==
+               executable.size()) {
+            executable.resize(executable.size() * 2);
+        }
+        if (length == 0) {
+            throw std::runtime_error(
+                std::format("GetModuleFileName failed: {}", GetLastError()));
+        }
+        executable.resize(length);
+
+        const std::vector<std::string> base_args = parser.set_arguments(
+            {"sweep", "sweep-rates", "sweep-cores", "sweep-sockets", "sweep-payloads",
+             "max-loss-pct", "max-p99-ms", "sweep-report", "cores", "cpus", "sockets", "payload",
+             "rate", "stats-file", "stats-stream"});
+
+        std::signal(SIGINT, signal_handler);
+        std::signal(SIGTERM, signal_handler);
+
+        const auto results =
+            run_sweep(sweep, make_child_process_runner(executable, base_args), g_config.shutdown);
+        const std::string report = parser.get("sweep-report");
+        write_sweep_report(report, sweep, results);
+
+        std::cout << "\n===== Sweep Results =====\n";
+        for (const auto& result : results) {
+            std::cout << std::format(
+                "cores={} sockets={} payload={}: max sustainable {} pps (limit: {})\n",
+                result.cores, result.sockets, result.payload, result.max_sustainable_rate,
+                result.limit);
+        }
+        std::cout << std::format("Wrote sweep report to {}\n", report);
+        return 0;
+    }
+
     uint64_t per_worker_display = g_rate_limit == 0 ? 0 : (g_rate_limit / num_workers);
 
     std::cout << std::format("Scalable UDP Echo Client\n");
-    std::cout << std::format("Server: {}:{}\n", server_ip, port);
+    if (target_specs.size() == 1) {
+        std::cout << std::format("Server: {}\n", target_specs.front().name());
+    } else {
+        std::cout << std::format("Targets: {}\n", target_specs.size());
+        for (const auto& spec : target_specs) {
+            std::cout << std::format("  {} (weight {})\n", spec.name(), spec.weight);
+        }
+    }
     std::cout << std::format("Payload size: {} bytes\n", payload_size);
+    std::cout << std::format("Depth: {}\n", g_config.depth);
     std::cout << std::format("Available processors: {}\n", num_processors);
     std::cout << std::format("Using {} worker(s)\n", num_workers);
     std::cout << std::format("Duration: {} seconds\n", duration_sec);
     std::cout << std::format("Rate limit: {} packets/sec total ({} per worker)\n", g_rate_limit,
                              per_worker_display);
     std::cout << std::format("Congestion controller: {}\n", cc_choice.empty() ? "null" : cc_choice);
+    std::cout << std::format("Arrival process: {}\n", arrival_str);
+    // Select the clock before any worker takes a timestamp.
+    const timestamp_source clock = set_timestamp_source(requested_clock);
+    std::cout << std::format("Clock: {} ({:.3f} MHz){}{}\n", timestamp_source_name(clock),
+                             static_cast<double>(timestamp_frequency_hz()) / 1e6,
+                             clock != requested_clock ? ", no invariant TSC" : "",
+                             g_config.batch_timestamps ? ", receive timestamps per batch" : "");
+    if (rss) {
+        std::cout << std::format("RSS source ports: {} queue(s), {}-entry indirection table\n",
+                                 rss->queue_count(), rss->indirection_table.size());
+    }
 
     // Validate congestion controller choice
     const std::vector<std::string> valid_cc = {"null", "bbr", "reno"};
@@ -600,110 +847,181 @@ int main(int argc, char* argv[]) try {
     // Initialize Winsock
     initialize_winsock();
 
-    // Resolve server name (supports hostnames and IP literals)
-    sockaddr_storage server_addr_storage = {};
-    int server_addr_len = 0;
+    // Make the ETW provider visible to trace sessions for the rest of the run.
+    trace_provider_registration trace_registration;
 
-    addrinfo hints = {};
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_DGRAM;
-
-    addrinfo* res = nullptr;
-    std::string service_str = std::to_string(port);
-    using unique_addrinfo = std::unique_ptr<addrinfo, decltype(&freeaddrinfo)>;
-    int gai_err = getaddrinfo(server_ip, service_str.c_str(), &hints, &res);
-    if (gai_err != 0 || res == nullptr) {
-        throw std::runtime_error(std::format("getaddrinfo failed for {}:{} with error: {}",
-                                             server_ip, port, gai_strerror(gai_err)));
+    // Open the time-series destination before any thread can sample into it.
+    if (!stats_stream_spec.empty()) {
+        g_stats_stream = std::make_unique<stats_stream>(stats_stream_spec);
     }
-    unique_addrinfo res_guard(res, freeaddrinfo);
 
-    // Prefer IPv6 result when available, otherwise prefer IPv4, otherwise take first result
-    addrinfo* chosen = nullptr;
-    // First pass: look for IPv6
-    for (addrinfo* ai = res; ai != nullptr; ai = ai->ai_next) {
-        if (ai->ai_family == AF_INET6) {
-            chosen = ai;
-            break;
+    // Resolve every target (hostnames or IP literals). Every socket sends to
+    // all of them, so they must share one address family.
+    std::vector<client_target> targets;
+    for (const auto& spec : target_specs) {
+        client_target target;
+        target.name = spec.name();
+        target.weight = spec.weight;
+        std::tie(target.addr, target.addr_len) = resolve_server(spec.host, spec.port);
+        if (!targets.empty() && target.addr.ss_family != targets.front().addr.ss_family) {
+            throw std::invalid_argument(
+                std::format("Target {} resolves to a different address family than {}",
+                            target.name, targets.front().name));
         }
-        if (chosen == nullptr) chosen = ai;
+        targets.push_back(std::move(target));
     }
-    // If no IPv6, try to find IPv4 explicitly (chosen may already be set to first result)
-    if (chosen == nullptr || chosen->ai_family != AF_INET6) {
-        for (addrinfo* ai = res; ai != nullptr; ai = ai->ai_next) {
-            if (ai->ai_family == AF_INET) {
-                chosen = ai;
-                break;
+    if (wait_ready_ms > 0) {
+        for (const auto& target : targets) {
+            if (!wait_for_server_ready(target.addr, target.addr_len,
+                                       static_cast<uint32_t>(wait_ready_ms))) {
+                std::cerr << std::format("Server {} did not answer within {} ms\n", target.name,
+                                         wait_ready_ms);
+                return 1;
             }
         }
+        std::cout << std::format("{} ready\n", targets.size() == 1 ? "Server" : "All servers");
     }
-
-    if (chosen == nullptr) {
-        throw std::runtime_error(
-            std::format("No suitable address found for {}:{}", server_ip, port));
+    // Placement and RSS source ports are worked out against the first target.
+    const sockaddr_storage& server_addr_storage = targets.front().addr;
+    const int server_addr_len = targets.front().addr_len;
+    const int server_family = server_addr_storage.ss_family;
+
+    // Place the workers. nic-local uses the RSS processors of the interface
+    // the route to the server leaves through.
+    std::vector<uint32_t> rss_processors;
+    if (placement == placement_policy::nic_local && cpu_list.empty()) {
+        rss_processors = query_interface_rss_processors(
+            reinterpret_cast<const sockaddr*>(&server_addr_storage), server_addr_len, false,
+            topology);
+        if (rss_processors.empty()) {
+            std::cerr << "No RSS processors reported for the route to the server; using compact\n";
+        }
+    }
+    const std::vector<logical_processor> worker_cpus =
+        select_worker_processors(topology, placement, num_workers, rss_processors, cpu_list);
+    std::cout << std::format("Placement: {} over {} NUMA node(s) in {} processor group(s)\n",
+                             cpu_list.empty() ? placement_policy_name(placement) : "cpu list",
+                             topology.numa_node_count, topology.group_count);
+    if (g_config.verbose) {
+        for (const auto& cpu : worker_cpus) {
+            std::cout << std::format("  CPU {} (group {}, number {}, node {}){}\n", cpu.index,
+                                     cpu.group, cpu.number, cpu.numa_node,
+                                     std::find(rss_processors.begin(), rss_processors.end(),
+                                               cpu.index) != rss_processors.end()
+                                         ? " RSS"
+                                         : "");
+        }
     }
-
-    // Copy resolved sockaddr into storage and set length
-    std::memcpy(&server_addr_storage, chosen->ai_addr, chosen->ai_addrlen);
-    server_addr_len = static_cast<int>(chosen->ai_addrlen);
-    int server_family = chosen->ai_family;
 
     // Set up signal handler
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
 
-    // Start TDigest merge thread
-    std::thread tdigest_thread(tdigest_merge_thread);
+    // The source address the route to the server uses, for the RSS hash.
+    std::optional<rss_port_selector> rss_ports;
+    if (rss) {
+        unique_socket probe = create_udp_socket(server_family);
+        if (connect(probe.get(), reinterpret_cast<const sockaddr*>(&server_addr_storage),
+                    server_addr_len) == SOCKET_ERROR) {
+            throw socket_exception(std::format("connect (RSS source address probe) failed: {}",
+                                               get_last_error_message()));
+        }
+        rss_ports.emplace(*rss, get_socket_name(probe).first, server_addr_storage);
+    }
 
     // Create worker contexts
     std::vector<std::unique_ptr<client_worker_context>> workers;
 
-    for (uint32_t i = 0; i < num_workers; ++i) {
+    for (const auto& cpu : worker_cpus) {
         auto ctx = std::make_unique<client_worker_context>();
-        ctx->processor_id = i;
-
-        // Copy resolved server address into worker context
-        std::memcpy(&ctx->server_addr, &server_addr_storage, static_cast<size_t>(server_addr_len));
-        ctx->server_addr_len = server_addr_len;
+        ctx->config = &g_config;
+        ctx->processor_id = cpu.index;
+        ctx->numa_node = cpu.numa_node;
+
+        // One table entry per target: its own sequence space, window, pacer and counters.
+        for (size_t t = 0; t < targets.size(); ++t) {
+            auto target = std::make_unique<worker_target>();
+            std::memcpy(&target->addr, &targets[t].addr, static_cast<size_t>(targets[t].addr_len));
+            target->addr_len = targets[t].addr_len;
+            target->sequence_tag = static_cast<uint64_t>(t) << TARGET_SEQUENCE_BITS;
+            target->weight = targets[t].weight;
+            ctx->targets.push_back(std::move(target));
+        }
 
         // Create multiple UDP sockets for this worker, each bound to its own ephemeral port
         for (int sidx = 0; sidx < sockets_per_worker; ++sidx) {
-            auto sock = create_udp_socket(server_family);
+            auto cs = std::make_unique<client_socket>();
+            cs->socket = create_udp_socket(server_family);
 
             // Set socket CPU affinity
-            set_socket_cpu_affinity(sock, static_cast<uint16_t>(i));
+            set_socket_cpu_affinity(cs->socket, static_cast<uint16_t>(cpu.index));
 
-            ctx->sockets.emplace_back(std::move(sock));
+            ctx->sockets.push_back(std::move(cs));
         }
 
-        // Increase socket buffer sizes and bind each socket to an ephemeral port
-        for (auto& sock : ctx->sockets) {
+        // Fall back to one datagram per send when the stack lacks USO.
+        if (uso && !is_udp_send_segmentation_supported(ctx->sockets.front()->socket)) {
+            std::cerr << "UDP send segmentation not supported, sending one datagram per send\n";
+            uso = false;
+        }
+        ctx->uso = uso;
+
+        // Increase socket buffer sizes and bind each socket to an ephemeral port,
+        // or with RSS ports to one whose tuple lands on the socket's queue.
+        // Queues are dealt round-robin over all sockets, worker by worker, so
+        // every queue gets the same number of sockets (to within one) and each
+        // worker always maps onto the same shards.
+        const size_t worker_index = workers.size();
+        for (size_t sidx = 0; sidx < ctx->sockets.size(); ++sidx) {
+            const unique_socket& sock = ctx->sockets[sidx]->socket;
             set_socket_option(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&recvbuf),
                               sizeof(recvbuf));
             int sndbuf = recvbuf;
             set_socket_option(sock, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&sndbuf),
                               sizeof(sndbuf));
 
-            bind_socket(sock, 0, server_family);
+            if (!rss_ports) {
+                bind_socket(sock, 0, server_family);
+                continue;
+            }
+            const uint32_t queue = static_cast<uint32_t>(
+                (worker_index + sidx * worker_cpus.size()) % rss->queue_count());
+            for (;;) {
+                const uint16_t candidate = rss_ports->next(queue);
+                if (candidate == 0) {
+                    throw std::runtime_error(
+                        std::format("No free source port maps to RSS queue {}", queue));
+                }
+                try {
+                    bind_socket(sock, candidate, server_family);
+                    break;
+                } catch (const socket_exception&) {
+                    // In use or excluded; try the next port for this queue.
+                }
+            }
+            if (g_config.verbose) {
+                std::cout << std::format("[CPU {}] Socket {} -> RSS queue {}\n", cpu.index,
+                                         sidx, queue);
+            }
         }
 
-        if (g_verbose.load()) {
-            for (const auto& sock : ctx->sockets) {
-                auto [addr, len] = get_socket_name(sock);
+        if (g_config.verbose) {
+            for (const auto& cs : ctx->sockets) {
+                auto [addr, len] = get_socket_name(cs->socket);
                 if (addr.ss_family == AF_INET) {
                     sockaddr_in* in_addr = reinterpret_cast<sockaddr_in*>(&addr);
                     char ip_str[INET_ADDRSTRLEN] = {};
                     InetNtopA(AF_INET, &in_addr->sin_addr, ip_str,
                               static_cast<ULONG>(sizeof(ip_str)));
-                    std::cout << std::format("Socket on CPU {} bound to {}:{}\n", i, ip_str,
+                    std::cout << std::format("Socket on CPU {} bound to {}:{}\n", cpu.index, ip_str,
                                              ntohs(in_addr->sin_port));
                 } else if (addr.ss_family == AF_INET6) {
                     sockaddr_in6* in6_addr = reinterpret_cast<sockaddr_in6*>(&addr);
                     char ip_str[INET6_ADDRSTRLEN] = {};
                     InetNtopA(AF_INET6, &in6_addr->sin6_addr, ip_str,
                               static_cast<ULONG>(sizeof(ip_str)));
-                    std::cout << std::format("Socket on CPU {} bound to [{}]:{}\n", i, ip_str,
-                                             ntohs(in6_addr->sin6_port));
+                    std::cout << std::format("Socket on CPU {} bound to [{}]:{}\n", cpu.index,
+                                             ip_str, ntohs(in6_addr->sin6_port));
                 }
             }
         }
@@ -711,11 +1029,15 @@ int main(int argc, char* argv[]) try {
         // Create IOCP for the worker and associate each socket with it
         ctx->iocp = create_iocp();
 
-        for (auto& s : ctx->sockets) {
-            associate_socket_with_iocp(s, ctx->iocp, static_cast<ULONG_PTR>(s.get()));
+        // The completion key is the socket's descriptor.
+        for (auto& cs : ctx->sockets) {
+            associate_socket_with_iocp(cs->socket, ctx->iocp,
+                                       reinterpret_cast<ULONG_PTR>(cs.get()));
         }
 
-        if (g_verbose.load()) std::cout << std::format("Created socket and IOCP for CPU {}\n", i);
+        if (g_config.verbose) {
+            std::cout << std::format("Created socket and IOCP for CPU {}\n", cpu.index);
+        }
         workers.push_back(std::move(ctx));
     }
 
@@ -732,68 +1054,178 @@ int main(int argc, char* argv[]) try {
     } else {
         per_worker_rate = g_rate_limit / static_cast<uint64_t>(workers.size());
     }
+    if (g_config.arrival == arrival_mode::trace) {
+        // A replayed trace sets its own rate; size rotation and windows from it.
+        const trace_arrivals trace(g_arrival_trace, 0, workers.size());
+        per_worker_rate = (std::max)(uint64_t{1}, static_cast<uint64_t>(trace.mean_rate_pps()));
+    }
+    // Rotate digests about once a second's worth of samples. Each worker's
+    // digests are allocated and preallocated here so rotation never allocates.
+    const uint64_t rotate_samples =
+        per_worker_rate == 0 ? UNLIMITED_RATE_ROTATE_SAMPLES : per_worker_rate;
+    auto make_digest = [rotate_samples]() {
+        auto digest = std::make_unique<TDigest>(100.0);
+        digest->reserve(
+            static_cast<size_t>((std::min)(rotate_samples, MAX_DIGEST_RESERVE_SAMPLES)));
+        return digest;
+    };
+    // Each worker's rate is split over the targets by weight. A replayed
+    // trace and --cc-shared split evenly, so the weights do not apply there.
+    const bool even_target_split = g_config.arrival == arrival_mode::trace || cc_shared;
+    uint64_t total_weight = 0;
+    for (const auto& target : targets) total_weight += target.weight;
+    if (even_target_split && std::any_of(targets.begin(), targets.end(), [&](const auto& target) {
+            return target.weight != targets.front().weight;
+        })) {
+        std::cerr << "Target weights are ignored with --arrival trace and --cc-shared\n";
+    }
     for (const auto& ctx : workers) {
         ctx->per_worker_rate = per_worker_rate;
+        ctx->digest_rotate_samples = rotate_samples;
+        auto allocate = [&](worker_latency_series& series) {
+            if (g_latency_estimator == latency_estimator::hdr) {
+                series.histograms = std::make_unique<digest_exchange<latency_histogram>>(
+                    digest_exchange<latency_histogram>::DEFAULT_POOL_SIZE,
+                    []() { return std::make_unique<latency_histogram>(); });
+            } else {
+                series.digests = std::make_unique<digest_exchange<TDigest>>(
+                    digest_exchange<TDigest>::DEFAULT_POOL_SIZE, make_digest);
+            }
+        };
+        allocate(ctx->rtt);
+        allocate(ctx->pacing);
+        for (auto& target : ctx->targets) {
+            const double share = even_target_split ? 1.0 / static_cast<double>(targets.size())
+                                                   : static_cast<double>(target->weight) /
+                                                         static_cast<double>(total_weight);
+            target->rate_pps = static_cast<double>(per_worker_rate) * share;
+            target->rtt_rotate_samples = (std::max)(
+                uint64_t{1}, static_cast<uint64_t>(static_cast<double>(rotate_samples) * share));
+            // With a single target its RTT is the worker's.
+            if (targets.size() > 1) allocate(target->rtt);
+        }
+        if (g_config.arrival != arrival_mode::constant) allocate(ctx->schedule_lag);
+        if (g_config.server_timestamps) {
+            allocate(ctx->client_to_server);
+            allocate(ctx->server_dwell);
+            allocate(ctx->server_to_client);
+        }
+    }
+
+    if (targets.size() > 1) g_target_rtt = std::vector<latency_totals>(targets.size());
+
+    // With --cc-shared every (worker, target) flow has a slot of its own.
+    if (cc_shared) {
+        g_shared_rate = std::make_unique<shared_rate_state>(static_cast<double>(g_rate_limit),
+                                                            workers.size() * targets.size());
     }
 
+    // Start TDigest merge thread
+    std::thread tdigest_thread(latency_merge_thread, std::cref(workers));
+
     // Start worker threads
     for (auto& ctx : workers) {
-        // create per-worker pacer now so it doesn't accumulate tokens before start
-        if (cc_choice == "bbr") {
-            ctx->pacer = std::make_unique<client_send_pacer<bbr_congestion_controller>>(
-                static_cast<double>(ctx->per_worker_rate));
-        } else if (cc_choice == "reno") {
-            ctx->pacer = std::make_unique<client_send_pacer<reno_congestion_controller>>(
-                static_cast<double>(ctx->per_worker_rate));
-        } else {
-            // default: null controller (allow requested rate)
-            ctx->pacer =
-                std::make_unique<client_send_pacer<>>(static_cast<double>(ctx->per_worker_rate));
+        const size_t worker_index = static_cast<size_t>(&ctx - workers.data());
+        for (size_t t = 0; t < ctx->targets.size(); ++t) {
+            worker_target& target = *ctx->targets[t];
+            // create per-target pacers now so they don't accumulate tokens before start
+            const double rate = target.rate_pps;
+            // Flows are numbered worker by worker, then target by target.
+            const size_t flow = worker_index * targets.size() + t;
+            if (g_config.arrival == arrival_mode::poisson) {
+                target.pacer = std::make_unique<open_loop_pacer<poisson_arrivals>>(poisson_arrivals(
+                    rate, 0x9E3779B97F4A7C15ULL *
+                              (static_cast<uint64_t>(ctx->processor_id) * targets.size() + t + 1)));
+            } else if (g_config.arrival == arrival_mode::on_off) {
+                target.pacer = std::make_unique<open_loop_pacer<on_off_arrivals>>(
+                    on_off_arrivals(rate, g_on_ns, g_off_ns));
+            } else if (g_config.arrival == arrival_mode::trace) {
+                target.pacer = std::make_unique<open_loop_pacer<trace_arrivals>>(
+                    trace_arrivals(g_arrival_trace, flow, workers.size() * targets.size()));
+            } else if (cc_choice == "bbr") {
+                target.pacer = make_token_bucket_pacer<bbr_congestion_controller>(
+                    rate, g_shared_rate.get(), flow);
+            } else if (cc_choice == "reno") {
+                target.pacer = make_token_bucket_pacer<reno_congestion_controller>(
+                    rate, g_shared_rate.get(), flow);
+            } else {
+                // default: null controller (allow requested rate)
+                target.pacer = make_token_bucket_pacer<null_congestion_controller>(
+                    rate, g_shared_rate.get(), flow);
+            }
         }
-        ctx->worker_thread = std::thread(worker_thread_func, ctx.get(), payload_size);
+        ctx->worker_thread = std::thread(client_worker_thread_func, ctx.get(), payload_size);
     }
 
-    // All workers are started; signal them to begin sending
-    g_start_sending.store(true);
-    // Reset pacers so they start refilling at the same epoch (align measurement)
+    // Reset pacers so they start refilling at the same epoch (align measurement).
+    // Workers do not touch their pacers until sending starts, so this must
+    // happen before the start signal.
+    const uint64_t pacer_epoch_ns = get_timestamp_ns();
     for (const auto& ctx : workers) {
-        if (ctx->pacer) ctx->pacer->reset_to_now();
+        for (const auto& target : ctx->targets) target->pacer->reset_to_now(pacer_epoch_ns);
     }
-    // Now mark the measurement start time
+    // All workers are started; signal them to begin sending
+    g_config.start_sending.store(true);
 
-    if (g_verbose.load())
+    if (g_config.verbose)
         std::cout << std::format("\nClient running for {} seconds. Press Ctrl+C to stop early.\n\n",
                                  duration_sec);
 
     // Run for specified duration
     auto start_time = std::chrono::steady_clock::now();
     std::chrono::steady_clock::time_point end_time;
-    while (!g_shutdown.load()) {
+    // Sequences declared lost during each one-second progress window.
+    std::vector<uint64_t> loss_per_window;
+    uint64_t prev_window_sent = 0, prev_window_dropped = 0;
+    std::vector<worker_stats_snapshot> stats_snapshots;
+    auto prev_sample_time = start_time;
+    auto prev_rebalance_time = start_time;
+    while (!g_config.shutdown.load()) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
 
-        auto elapsed = std::chrono::steady_clock::now() - start_time;
+        const auto sample_time = std::chrono::steady_clock::now();
+        auto elapsed = sample_time - start_time;
+        if (g_shared_rate) {
+            g_shared_rate->rebalance(
+                std::chrono::duration<double>(sample_time - prev_rebalance_time).count());
+            prev_rebalance_time = sample_time;
+        }
+        if (g_stats_stream) {
+            export_worker_stats(
+                workers, stats_snapshots, std::chrono::duration<double>(elapsed).count(),
+                std::chrono::duration<double>(sample_time - prev_sample_time).count(), cc_choice);
+            prev_sample_time = sample_time;
+        }
         if (std::chrono::duration_cast<std::chrono::seconds>(elapsed).count() >= duration_sec) {
             end_time = std::chrono::steady_clock::now();
             break;
         }
 
         // Print interim stats
-        uint64_t total_sent = 0, total_recv = 0;
+        uint64_t total_sent = 0, total_recv = 0, total_dropped = 0;
         for (const auto& ctx : workers) {
             total_sent += ctx->packets_sent.load();
             total_recv += ctx->packets_received.load();
+            total_dropped += ctx->packets_dropped.load();
         }
-        std::cout << std::format("Progress: sent={}, recv={}, in-flight={}\n", total_sent,
-                                 total_recv, total_sent - total_recv);
+        const uint64_t window_sent = total_sent - prev_window_sent;
+        const uint64_t window_lost = total_dropped - prev_window_dropped;
+        prev_window_sent = total_sent;
+        prev_window_dropped = total_dropped;
+        loss_per_window.push_back(window_lost);
+        std::cout << std::format(
+            "Progress: sent={}, recv={}, in-flight={}, lost this window={} ({:.2f}%)\n",
+            total_sent, total_recv, total_sent - total_recv, window_lost,
+            window_sent > 0 ? 100.0 * window_lost / window_sent : 0.0);
     }
 
     // Signal workers to stop sending new packets, allow in-flight replies to arrive
-    g_stop_sending.store(true);
+    g_config.stop_sending.store(true);
     // Wait 1 second for in-flight replies to be processed
     std::this_thread::sleep_for(std::chrono::seconds(1));
 
     // Now request shutdown to terminate worker loops
-    g_shutdown.store(true);
+    g_config.shutdown.store(true);
     std::cout << "\nStopping workers...\n";
 
     // Close IOCPs to wake up worker threads
@@ -817,11 +1249,18 @@ int main(int argc, char* argv[]) try {
 
     tdigest_thread.join();
 
-    merge_tdigest();
+    merge_latency(workers);
+
+    if (g_stats_stream && g_stats_stream->dropped() > 0) {
+        std::cerr << std::format("Stats stream dropped {} samples\n",
+                                 g_stats_stream->dropped());
+    }
 
     // Calculate and print final stats
     uint64_t total_sent = 0, total_recv = 0, total_dropped = 0;
+    uint64_t total_reordered = 0, total_duplicate = 0, total_late = 0;
     uint64_t total_bytes_sent = 0, total_bytes_recv = 0;
+    uint64_t total_send_calls = 0;
     uint64_t total_rtt = 0;
     uint64_t min_rtt = UINT64_MAX, max_rtt = 0;
 
@@ -829,8 +1268,12 @@ int main(int argc, char* argv[]) try {
         total_sent += ctx->packets_sent.load();
         total_recv += ctx->packets_received.load();
         total_dropped += ctx->packets_dropped.load();
+        total_reordered += ctx->packets_reordered.load();
+        total_duplicate += ctx->packets_duplicate.load();
+        total_late += ctx->packets_late.load();
         total_bytes_sent += ctx->bytes_sent.load();
         total_bytes_recv += ctx->bytes_received.load();
+        total_send_calls += ctx->send_calls.load();
         total_rtt += ctx->total_rtt_ns.load();
 
         uint64_t worker_min = ctx->min_rtt_ns.load();
@@ -861,29 +1304,130 @@ int main(int argc, char* argv[]) try {
     std::cout << std::format("Packets received: {} ({:.0f} pps)\n", total_recv, pps_recv);
     std::cout << std::format("Packets dropped: {} ({:.2f}%)\n", total_dropped,
                              total_sent > 0 ? (100.0 * total_dropped / total_sent) : 0.0);
+    std::cout << std::format("Echoes reordered/duplicate/late: {}/{}/{}\n", total_reordered,
+                             total_duplicate, total_late);
     std::cout << std::format("Bytes sent: {} ({:.2f} Mbps)\n", total_bytes_sent, mbps_sent);
     std::cout << std::format("Bytes received: {} ({:.2f} Mbps)\n", total_bytes_recv, mbps_recv);
+    double segments_per_send =
+        total_send_calls > 0 ? static_cast<double>(total_sent) / total_send_calls : 0.0;
+    std::cout << std::format("Segments per send: {:.2f} ({} sends)\n", segments_per_send,
+                             total_send_calls);
     std::cout << std::format("RTT (min/avg/max): {:.2f}/{:.2f}/{:.2f} ms\n", min_rtt_ms, avg_rtt_ms,
                              max_rtt_ms);
+    if (g_shared_rate) {
+        std::cout << "Shared rate split (pps):";
+        for (size_t w = 0; w < workers.size(); ++w) {
+            double allotted_pps = 0.0;
+            for (size_t t = 0; t < targets.size(); ++t) {
+                allotted_pps += g_shared_rate->allotted_pps(w * targets.size() + t);
+            }
+            std::cout << std::format(" {}={:.0f}", workers[w]->processor_id, allotted_pps);
+        }
+        std::cout << "\n";
+    }
 
-    // TDigest stores RTT and pacing samples in milliseconds.
+    // Percentiles are reported in milliseconds from the selected estimator.
     // Print RTT percentiles every 10% and the high percentiles
     std::cout << "RTT Percentiles (ms): ";
     for (int p = 10; p <= 90; p += 10) {
         double q = static_cast<double>(p) / 100.0;
-        std::cout << std::format("p{}={:.2f} ", p, g_overall_rtt_tdigest.percentile(q));
+        std::cout << std::format("p{}={:.2f} ", p, g_overall_rtt.percentile_ms(q));
     }
-    std::cout << std::format("p99={:.2f} p99.9={:.2f}\n", g_overall_rtt_tdigest.percentile(0.99),
-                             g_overall_rtt_tdigest.percentile(0.999));
+    std::cout << std::format("p99={:.2f} p99.9={:.2f}\n", g_overall_rtt.percentile_ms(0.99),
+                             g_overall_rtt.percentile_ms(0.999));
 
     // Print Pacing percentiles every 10% and the high percentiles
     std::cout << "Pacing Percentiles (ms): ";
     for (int p = 10; p <= 90; p += 10) {
         double q = static_cast<double>(p) / 100.0;
-        std::cout << std::format("p{}={:.3f} ", p, g_overall_pacing_tdigest.percentile(q));
+        std::cout << std::format("p{}={:.3f} ", p, g_overall_pacing.percentile_ms(q));
+    }
+    std::cout << std::format("p99={:.3f} p99.9={:.3f}\n", g_overall_pacing.percentile_ms(0.99),
+                             g_overall_pacing.percentile_ms(0.999));
+
+    // Open-loop schedule lag: how late packets left relative to their intended send times.
+    const bool open_loop = g_config.arrival != arrival_mode::constant;
+    uint64_t max_schedule_lag_ns = 0;
+    for (const auto& ctx : workers) {
+        max_schedule_lag_ns = (std::max)(max_schedule_lag_ns, ctx->max_schedule_lag_ns.load());
+    }
+    if (open_loop) {
+        std::cout << std::format(
+            "Schedule lag (ms): p50={:.3f} p99={:.3f} p99.9={:.3f} max={:.3f}\n",
+            g_overall_schedule_lag.percentile_ms(0.5), g_overall_schedule_lag.percentile_ms(0.99),
+            g_overall_schedule_lag.percentile_ms(0.999), max_schedule_lag_ns / 1'000'000.0);
+    }
+
+    // One-way decomposition of echoes the server stamped (--server-timestamps).
+    uint64_t total_server_stamped = 0;
+    for (const auto& ctx : workers) total_server_stamped += ctx->server_stamped.load();
+    const bool report_one_way = g_config.server_timestamps && total_server_stamped > 0;
+    if (g_config.server_timestamps && !report_one_way) {
+        std::cout << "No echoes carried server timestamps (run echo_server --handler timestamp)\n";
+    }
+    const std::pair<const char*, const latency_totals*> one_way_metrics[] = {
+        {"client_to_server", &g_overall_client_to_server},
+        {"server_dwell", &g_overall_server_dwell},
+        {"server_to_client", &g_overall_server_to_client}};
+    if (report_one_way) {
+        std::cout << std::format("One-way latency (ms, {} stamped echoes):\n",
+                                 total_server_stamped);
+        for (const auto& [name, totals] : one_way_metrics) {
+            std::cout << std::format("  {:<16} p50={:.3f} p90={:.3f} p99={:.3f} p99.9={:.3f}\n",
+                                     name, totals->percentile_ms(0.5), totals->percentile_ms(0.9),
+                                     totals->percentile_ms(0.99), totals->percentile_ms(0.999));
+        }
+    }
+
+    // Per-target totals across workers.
+    struct target_totals {
+        uint64_t sent{0}, received{0}, dropped{0};
+        uint64_t reordered{0}, duplicate{0}, late{0};
+        uint64_t total_rtt_ns{0}, min_rtt_ns{UINT64_MAX}, max_rtt_ns{0};
+    };
+    std::vector<target_totals> per_target(targets.size());
+    for (const auto& ctx : workers) {
+        for (size_t t = 0; t < ctx->targets.size(); ++t) {
+            const worker_target& target = *ctx->targets[t];
+            target_totals& totals = per_target[t];
+            totals.sent += target.packets_sent.load();
+            totals.received += target.packets_received.load();
+            totals.dropped += target.packets_dropped.load();
+            totals.reordered += target.packets_reordered.load();
+            totals.duplicate += target.packets_duplicate.load();
+            totals.late += target.packets_late.load();
+            totals.total_rtt_ns += target.total_rtt_ns.load();
+            totals.min_rtt_ns = (std::min)(totals.min_rtt_ns, target.min_rtt_ns.load());
+            totals.max_rtt_ns = (std::max)(totals.max_rtt_ns, target.max_rtt_ns.load());
+        }
+    }
+    auto target_rtt = [&](size_t t) -> const latency_totals& {
+        return g_target_rtt.empty() ? g_overall_rtt : g_target_rtt[t];
+    };
+    auto target_drop_pct = [&](size_t t) {
+        return per_target[t].sent > 0 ? 100.0 * per_target[t].dropped / per_target[t].sent : 0.0;
+    };
+    auto target_avg_rtt_ms = [&](size_t t) {
+        return per_target[t].received > 0 ? static_cast<double>(per_target[t].total_rtt_ns) /
+                                                per_target[t].received / 1'000'000.0
+                                          : 0.0;
+    };
+    if (targets.size() > 1) {
+        std::cout << "Per-target statistics:\n";
+        for (size_t t = 0; t < targets.size(); ++t) {
+            const target_totals& totals = per_target[t];
+            std::cout << std::format(
+                "  {} (weight {}): sent={} ({:.0f} pps) recv={} dropped={} ({:.2f}%) "
+                "reordered/duplicate/late={}/{}/{}\n",
+                targets[t].name, targets[t].weight, totals.sent, totals.sent / duration_s,
+                totals.received, totals.dropped, target_drop_pct(t), totals.reordered,
+                totals.duplicate, totals.late);
+            std::cout << std::format(
+                "    RTT (ms): avg={:.2f} p50={:.2f} p99={:.2f} p99.9={:.2f}\n",
+                target_avg_rtt_ms(t), target_rtt(t).percentile_ms(0.5),
+                target_rtt(t).percentile_ms(0.99), target_rtt(t).percentile_ms(0.999));
+        }
     }
-    std::cout << std::format("p99={:.3f} p99.9={:.3f}\n", g_overall_pacing_tdigest.percentile(0.99),
-                             g_overall_pacing_tdigest.percentile(0.999));
 
     // Optionally write final statistics to a file as JSON if requested
     if (!stats_file.empty()) {
@@ -900,39 +1444,92 @@ int main(int argc, char* argv[]) try {
             ofs << std::format("  \"packets_received\": {},\n", total_recv);
             ofs << std::format("  \"packets_dropped\": {},\n", total_dropped);
             ofs << std::format("  \"packets_dropped_pct\": {:.2f},\n", drop_pct);
+            ofs << std::format("  \"packets_reordered\": {},\n", total_reordered);
+            ofs << std::format("  \"packets_duplicate\": {},\n", total_duplicate);
+            ofs << std::format("  \"packets_late\": {},\n", total_late);
+            ofs << "  \"loss_per_window\": [";
+            for (size_t w = 0; w < loss_per_window.size(); ++w) {
+                ofs << std::format("{}{}", w == 0 ? "" : ", ", loss_per_window[w]);
+            }
+            ofs << "],\n";
             ofs << std::format("  \"pps_sent\": {:.2f},\n", pps_sent);
             ofs << std::format("  \"pps_recv\": {:.2f},\n", pps_recv);
             ofs << std::format("  \"bytes_sent\": {},\n", total_bytes_sent);
             ofs << std::format("  \"bytes_received\": {},\n", total_bytes_recv);
             ofs << std::format("  \"mbps_sent\": {:.2f},\n", mbps_sent);
             ofs << std::format("  \"mbps_recv\": {:.2f},\n", mbps_recv);
+            ofs << std::format("  \"send_calls\": {},\n", total_send_calls);
+            ofs << std::format("  \"segments_per_send\": {:.2f},\n", segments_per_send);
             ofs << std::format("  \"rtt_min_ms\": {:.2f},\n", min_rtt_ms);
             ofs << std::format("  \"rtt_avg_ms\": {:.2f},\n", avg_rtt_ms);
             ofs << std::format("  \"rtt_max_ms\": {:.2f},\n", max_rtt_ms);
+            ofs << std::format("  \"latency_estimator\": \"{}\",\n", estimator_str);
+            ofs << std::format("  \"arrival\": \"{}\",\n", arrival_str);
+            ofs << std::format("  \"clock\": \"{}\",\n",
+                               timestamp_source_name(get_timestamp_source()));
+            if (open_loop) {
+                ofs << std::format(
+                    "  \"schedule_lag_ms\": {{\"p50\": {:.3f}, \"p99\": {:.3f}, "
+                    "\"p999\": {:.3f}, \"max\": {:.3f}}},\n",
+                    g_overall_schedule_lag.percentile_ms(0.5),
+                    g_overall_schedule_lag.percentile_ms(0.99),
+                    g_overall_schedule_lag.percentile_ms(0.999), max_schedule_lag_ns / 1'000'000.0);
+            }
             // Emit RTT percentiles every 10%
             for (int p = 10; p <= 90; p += 10) {
                 double q = static_cast<double>(p) / 100.0;
                 ofs << std::format("  \"rtt_p{}_ms\": {:.2f},\n", p,
-                                   g_overall_rtt_tdigest.percentile(q));
+                                   g_overall_rtt.percentile_ms(q));
             }
             ofs << std::format("  \"rtt_p99_ms\": {:.2f},\n",
-                               g_overall_rtt_tdigest.percentile(0.99));
+                               g_overall_rtt.percentile_ms(0.99));
             ofs << std::format("  \"rtt_p999_ms\": {:.2f},\n",
-                               g_overall_rtt_tdigest.percentile(0.999));
+                               g_overall_rtt.percentile_ms(0.999));
 
             // Emit pacing percentiles every 10%
             for (int p = 10; p <= 90; p += 10) {
                 double q = static_cast<double>(p) / 100.0;
                 ofs << std::format("  \"pacing_p{}_ms\": {:.3f},\n", p,
-                                   g_overall_pacing_tdigest.percentile(q));
+                                   g_overall_pacing.percentile_ms(q));
             }
             ofs << std::format("  \"pacing_p99_ms\": {:.3f},\n",
-                               g_overall_pacing_tdigest.percentile(0.99));
-            ofs << std::format("  \"pacing_p999_ms\": {:.3f}\n",
-                               g_overall_pacing_tdigest.percentile(0.999));
+                               g_overall_pacing.percentile_ms(0.99));
+            ofs << std::format("  \"pacing_p999_ms\": {:.3f},\n",
+                               g_overall_pacing.percentile_ms(0.999));
+            if (report_one_way) {
+                ofs << std::format("  \"server_stamped\": {},\n", total_server_stamped);
+                for (size_t m = 0; m < std::size(one_way_metrics); ++m) {
+                    const auto& [name, totals] = one_way_metrics[m];
+                    ofs << std::format(
+                        "  \"{}_ms\": {{\"p50\": {:.3f}, \"p90\": {:.3f}, \"p99\": {:.3f}, "
+                        "\"p999\": {:.3f}}},\n",
+                        name, totals->percentile_ms(0.5), totals->percentile_ms(0.9),
+                        totals->percentile_ms(0.99), totals->percentile_ms(0.999));
+                }
+            }
+            // Per-target statistics, last so the top-level fields come first.
+            ofs << "  \"targets\": [\n";
+            for (size_t t = 0; t < targets.size(); ++t) {
+                const target_totals& totals = per_target[t];
+                ofs << std::format(
+                    "    {{\"target\": \"{}\", \"weight\": {}, \"packets_sent\": {}, "
+                    "\"packets_received\": {}, \"packets_dropped\": {}, "
+                    "\"packets_dropped_pct\": {:.2f}, \"packets_reordered\": {}, "
+                    "\"packets_duplicate\": {}, \"packets_late\": {}, \"rtt_min_ms\": {:.2f}, "
+                    "\"rtt_avg_ms\": {:.2f}, \"rtt_max_ms\": {:.2f}, \"rtt_p50_ms\": {:.2f}, "
+                    "\"rtt_p99_ms\": {:.2f}, \"rtt_p999_ms\": {:.2f}}}{}\n",
+                    targets[t].name, targets[t].weight, totals.sent, totals.received,
+                    totals.dropped, target_drop_pct(t), totals.reordered, totals.duplicate,
+                    totals.late,
+                    totals.min_rtt_ns != UINT64_MAX ? totals.min_rtt_ns / 1'000'000.0 : 0.0,
+                    target_avg_rtt_ms(t), totals.max_rtt_ns / 1'000'000.0,
+                    target_rtt(t).percentile_ms(0.5), target_rtt(t).percentile_ms(0.99),
+                    target_rtt(t).percentile_ms(0.999), t + 1 < targets.size() ? "," : "");
+            }
+            ofs << "  ]\n";
             ofs << "}\n";
             ofs.close();
-            if (g_verbose.load()) std::cout << std::format("Wrote JSON stats to {}\n", stats_file);
+            if (g_config.verbose) std::cout << std::format("Wrote JSON stats to {}\n", stats_file);
         }
     }
 
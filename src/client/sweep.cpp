@@ -0,0 +1,251 @@
+/**
+ * @file sweep.cpp
+ * @brief Saturation sweep search, child-process runner and JSON report.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "sweep.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <syncstream>
+
+#include "common/socket_utils.hpp"
+
+namespace {
+
+/// Below this fraction of the offered rate actually sent, the client, not the path, is the limit.
+constexpr double MIN_SEND_FRACTION = 0.95;
+
+/// Why `p` is not sustainable under `config`, or empty if it is.
+std::string point_limit(const sweep_point& p, const sweep_config& config) {
+    if (p.pps_sent < MIN_SEND_FRACTION * static_cast<double>(p.rate)) return "send_rate";
+    if (p.loss_pct > config.max_loss_pct) return "loss";
+    if (config.max_p99_ms > 0.0 && p.rtt_p99_ms > config.max_p99_ms) return "p99";
+    return {};
+}
+
+/// Search one configuration's rate range.
+sweep_result sweep_configuration(const sweep_config& config, const sweep_runner& run,
+                                 const std::atomic<bool>& stop, uint32_t cores, uint32_t sockets,
+                                 uint32_t payload) {
+    sweep_result result{cores, sockets, payload, {}, 0, "rate_max"};
+
+    // Run one point and report whether it was sustainable.
+    auto measure = [&](uint64_t rate) {
+        sweep_point p = run(cores, sockets, payload, rate);
+        p.rate = rate;
+        p.limit = point_limit(p, config);
+        std::osyncstream(std::cout) << std::format(
+            "Sweep cores={} sockets={} payload={} rate={}: recv={:.0f} pps loss={:.2f}% "
+            "p99={:.3f} ms -> {}\n",
+            cores, sockets, payload, rate, p.pps_recv, p.loss_pct, p.rtt_p99_ms,
+            p.limit.empty() ? "ok" : p.limit);
+        result.points.push_back(p);
+        if (!p.limit.empty()) result.limit = p.limit;
+        return p.limit.empty();
+    };
+
+    if (config.mode == sweep_config::search::step) {
+        for (uint64_t rate = config.rate_min; rate <= config.rate_max && !stop.load();
+             rate += config.rate_step) {
+            if (!measure(rate)) break;
+            result.max_sustainable_rate = rate;
+        }
+        return result;
+    }
+
+    // Binary search: keep lo sustainable and hi not, until they are one step apart.
+    if (!measure(config.rate_min)) return result;
+    result.max_sustainable_rate = config.rate_min;
+    if (stop.load()) return result;
+    if (measure(config.rate_max)) {
+        result.max_sustainable_rate = config.rate_max;
+        return result;
+    }
+    // measure() leaves result.limit at the latest failure, which is always `hi`.
+    uint64_t lo = config.rate_min;
+    uint64_t hi = config.rate_max;
+    while (hi - lo > config.rate_step && !stop.load()) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        if (measure(mid)) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    result.max_sustainable_rate = lo;
+    return result;
+}
+
+/// Quote one argument for a Windows command line (CommandLineToArgvW rules).
+std::string quote_argument(const std::string& arg) {
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) return arg;
+    std::string quoted = "\"";
+    size_t backslashes = 0;
+    for (char c : arg) {
+        if (c == '\\') {
+            ++backslashes;
+            continue;
+        }
+        // Backslashes are literal unless they precede a quote.
+        quoted.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+        backslashes = 0;
+        quoted.push_back(c);
+    }
+    quoted.append(backslashes * 2, '\\');
+    quoted.push_back('"');
+    return quoted;
+}
+
+/// The number following `"key":` in the client's flat stats JSON.
+double json_number(const std::string& json, const std::string& key) {
+    const std::string needle = "\"" + key + "\":";
+    const size_t pos = json.find(needle);
+    if (pos == std::string::npos) {
+        throw std::runtime_error(std::format("Sweep run stats are missing \"{}\"", key));
+    }
+    return std::strtod(json.c_str() + pos + needle.size(), nullptr);
+}
+
+/// Run a child to completion and return its exit code.
+DWORD run_child(const std::string& executable, const std::vector<std::string>& args) {
+    std::string command_line = quote_argument(executable);
+    for (const auto& arg : args) command_line += " " + quote_argument(arg);
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    wil::unique_process_information process;
+    if (!CreateProcessA(executable.c_str(), command_line.data(), nullptr, nullptr, FALSE, 0,
+                        nullptr, nullptr, &startup, &process)) {
+        throw std::runtime_error(
+            std::format("Failed to start sweep run '{}': {}", command_line, GetLastError()));
+    }
+    WaitForSingleObject(process.hProcess, INFINITE);
+    DWORD exit_code = 0;
+    GetExitCodeProcess(process.hProcess, &exit_code);
+    return exit_code;
+}
+
+}  // namespace
+
+std::vector<sweep_result> run_sweep(const sweep_config& config, const sweep_runner& run,
+                                    const std::atomic<bool>& stop) {
+    std::vector<sweep_result> results;
+    for (uint32_t cores : config.cores) {
+        for (uint32_t sockets : config.sockets) {
+            for (uint32_t payload : config.payloads) {
+                if (stop.load()) return results;
+                results.push_back(
+                    sweep_configuration(config, run, stop, cores, sockets, payload));
+            }
+        }
+    }
+    return results;
+}
+
+sweep_runner make_child_process_runner(std::string executable, std::vector<std::string> base_args) {
+    return [executable = std::move(executable), base_args = std::move(base_args)](
+               uint32_t cores, uint32_t sockets, uint32_t payload, uint64_t rate) {
+        const std::filesystem::path stats_path =
+            std::filesystem::temp_directory_path() /
+            std::format("echo_client_sweep_{}.json", GetCurrentProcessId());
+        std::vector<std::string> args = base_args;
+        args.insert(args.end(), {"--cores", std::to_string(cores), "--sockets",
+                                 std::to_string(sockets), "--payload", std::to_string(payload),
+                                 "--rate", std::to_string(rate), "--stats-file",
+                                 stats_path.string()});
+        std::filesystem::remove(stats_path);
+        const DWORD exit_code = run_child(executable, args);
+        if (exit_code != 0) {
+            throw std::runtime_error(std::format("Sweep run at rate {} exited with code {}", rate,
+                                                 static_cast<unsigned long>(exit_code)));
+        }
+
+        std::ifstream in(stats_path);
+        if (!in) {
+            throw std::runtime_error(
+                std::format("Sweep run at rate {} wrote no stats file", rate));
+        }
+        std::stringstream json;
+        json << in.rdbuf();
+        in.close();
+        std::filesystem::remove(stats_path);
+
+        const std::string text = json.str();
+        sweep_point p;
+        p.pps_sent = json_number(text, "pps_sent");
+        p.pps_recv = json_number(text, "pps_recv");
+        p.loss_pct = json_number(text, "packets_dropped_pct");
+        p.mbps_recv = json_number(text, "mbps_recv");
+        p.rtt_p50_ms = json_number(text, "rtt_p50_ms");
+        p.rtt_p99_ms = json_number(text, "rtt_p99_ms");
+        p.rtt_p999_ms = json_number(text, "rtt_p999_ms");
+        return p;
+    };
+}
+
+void write_sweep_report(const std::string& path, const sweep_config& config,
+                        const std::vector<sweep_result>& results) {
+    std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+    if (!ofs) throw std::runtime_error(std::format("Failed to open sweep report '{}'", path));
+
+    ofs << "{\n";
+    ofs << std::format("  \"mode\": \"{}\",\n",
+                       config.mode == sweep_config::search::binary ? "binary" : "step");
+    ofs << std::format("  \"duration_s\": {},\n", config.duration_sec);
+    ofs << std::format(
+        "  \"rate\": {{\"min\": {}, \"max\": {}, \"step\": {}}},\n", config.rate_min,
+        config.rate_max, config.rate_step);
+    ofs << std::format("  \"max_loss_pct\": {:.2f},\n", config.max_loss_pct);
+    ofs << std::format("  \"max_p99_ms\": {:.3f},\n", config.max_p99_ms);
+    ofs << "  \"configurations\": [\n";
+    for (size_t r = 0; r < results.size(); ++r) {
+        const sweep_result& result = results[r];
+        ofs << "    {\n";
+        ofs << std::format("      \"cores\": {},\n", result.cores);
+        ofs << std::format("      \"sockets\": {},\n", result.sockets);
+        ofs << std::format("      \"payload\": {},\n", result.payload);
+        ofs << std::format("      \"max_sustainable_pps\": {},\n", result.max_sustainable_rate);
+        ofs << std::format("      \"limit\": \"{}\",\n", result.limit);
+        ofs << "      \"points\": [\n";
+        for (size_t i = 0; i < result.points.size(); ++i) {
+            const sweep_point& p = result.points[i];
+            ofs << std::format(
+                "        {{\"rate\": {}, \"pps_sent\": {:.2f}, \"pps_recv\": {:.2f}, "
+                "\"loss_pct\": {:.2f}, \"mbps_recv\": {:.2f}, \"rtt_p50_ms\": {:.3f}, "
+                "\"rtt_p99_ms\": {:.3f}, \"rtt_p999_ms\": {:.3f}, \"sustainable\": {}}}{}\n",
+                p.rate, p.pps_sent, p.pps_recv, p.loss_pct, p.mbps_recv, p.rtt_p50_ms,
+                p.rtt_p99_ms, p.rtt_p999_ms, p.limit.empty(),
+                i + 1 < result.points.size() ? "," : "");
+        }
+        ofs << "      ]\n";
+        ofs << std::format("    }}{}\n", r + 1 < results.size() ? "," : "");
+    }
+    ofs << "  ]\n";
+    ofs << "}\n";
+    if (!ofs) throw std::runtime_error(std::format("Failed to write sweep report '{}'", path));
+}
+
+std::vector<uint32_t> parse_sweep_list(const std::string& text) {
+    std::vector<uint32_t> values;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end = nullptr;
+        const unsigned long value = std::strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0') {
+            throw std::invalid_argument(std::format("Invalid sweep list entry '{}'", item));
+        }
+        values.push_back(static_cast<uint32_t>(value));
+    }
+    if (values.empty()) throw std::invalid_argument("Empty sweep list");
+    return values;
+}
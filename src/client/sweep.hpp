@@ -0,0 +1,120 @@
+/**
+ * @file sweep.hpp
+ * @brief Saturation sweep: find the highest sustainable rate per configuration.
+ *
+ * A sweep measures a grid of `--cores` x `--sockets` x `--payload`
+ * configurations. For each one it ramps the total `--rate` (in fixed steps,
+ * or by binary search between a minimum and maximum) until a run exceeds the
+ * loss or p99 RTT threshold, and records every run as one point of that
+ * configuration's throughput/latency curve. Each point is a complete, fresh
+ * client run in a child process, so no socket, pacer or estimator state
+ * carries over from one rate to the next.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief What to sweep and when a run counts as sustainable.
+ */
+struct sweep_config {
+    enum class search { step, binary };
+
+    /// `step` tries min, min+step, ... ; `binary` bisects [min, max] down to `rate_step`.
+    search mode{search::step};
+    /// Configurations: every combination of these is swept.
+    std::vector<uint32_t> cores;
+    std::vector<uint32_t> sockets;
+    std::vector<uint32_t> payloads;
+    /// Total offered rate range in packets per second.
+    uint64_t rate_min{0};
+    uint64_t rate_max{0};
+    uint64_t rate_step{0};
+    /// A run is unsustainable above this loss percentage.
+    double max_loss_pct{1.0};
+    /// A run is unsustainable above this p99 RTT (0 = no latency limit).
+    double max_p99_ms{0.0};
+    /// Duration of each run, for the report.
+    int duration_sec{0};
+};
+
+/**
+ * @brief One run of the sweep.
+ */
+struct sweep_point {
+    uint64_t rate{0};  ///< Offered total rate (`--rate`).
+    double pps_sent{0.0};
+    double pps_recv{0.0};
+    double loss_pct{0.0};
+    double mbps_recv{0.0};
+    double rtt_p50_ms{0.0};
+    double rtt_p99_ms{0.0};
+    double rtt_p999_ms{0.0};
+    /// Why the run is not sustainable ("loss", "p99", "send_rate"), or empty if it is.
+    std::string limit;
+};
+
+/**
+ * @brief The curve measured for one configuration and the rate found.
+ */
+struct sweep_result {
+    uint32_t cores{0};
+    uint32_t sockets{0};
+    uint32_t payload{0};
+    /// Points in the order they were run.
+    std::vector<sweep_point> points;
+    /// Highest sustainable offered rate (0 if even `rate_min` was not).
+    uint64_t max_sustainable_rate{0};
+    /// What stopped the search: a point limit, or "rate_max" if the range never saturated.
+    std::string limit;
+};
+
+/// Runs one client measurement at (cores, sockets, payload, total rate).
+using sweep_runner = std::function<sweep_point(uint32_t, uint32_t, uint32_t, uint64_t)>;
+
+/**
+ * @brief Sweep every configuration in `config`.
+ *
+ * @param config What to sweep.
+ * @param run Measures one point.
+ * @param stop Checked between runs; when set the sweep returns what it has.
+ * @return One result per configuration swept.
+ */
+std::vector<sweep_result> run_sweep(const sweep_config& config, const sweep_runner& run,
+                                    const std::atomic<bool>& stop);
+
+/**
+ * @brief A runner that launches this client as a child process per point.
+ *
+ * The child gets `base_args` plus the point's `--cores`, `--sockets`,
+ * `--payload` and `--rate`, writes its `--stats-file` to a temporary file and
+ * the runner reads the point back from it.
+ *
+ * @param executable Path of the client executable.
+ * @param base_args Arguments shared by all points (server, port, duration, ...).
+ * @throws std::runtime_error from the runner if a child cannot be started or fails.
+ */
+sweep_runner make_child_process_runner(std::string executable, std::vector<std::string> base_args);
+
+/**
+ * @brief Write the sweep's curves as a single JSON report.
+ *
+ * @throws std::runtime_error if the file cannot be written.
+ */
+void write_sweep_report(const std::string& path, const sweep_config& config,
+                        const std::vector<sweep_result>& results);
+
+/**
+ * @brief Parse a comma-separated list of unsigned integers, e.g. "1,2,4".
+ *
+ * @throws std::invalid_argument on an empty list or a malformed entry.
+ */
+std::vector<uint32_t> parse_sweep_list(const std::string& text);
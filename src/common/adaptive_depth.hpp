@@ -0,0 +1,104 @@
+/**
+ * @file adaptive_depth.hpp
+ * @brief Controller that sizes a worker's outstanding I/O depth from observed load.
+ *
+ * The controller watches two signals over short time windows: how many
+ * receive completions each `GetQueuedCompletionStatusEx` call returns
+ * relative to the current depth, and how often the send pool runs dry. It
+ * doubles the depth when the posted receives are repeatedly drained in a
+ * single dequeue or the send pool empties, and halves it when the busiest
+ * dequeue of a window used less than a quarter of the depth. The depth
+ * always stays within `[min_depth, max_depth]`.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Grow/shrink policy for a worker's outstanding depth.
+ * @note Not thread-safe; owned and driven by a single worker thread.
+ */
+class adaptive_depth {
+   public:
+    /// Length of one evaluation window in nanoseconds.
+    static constexpr uint64_t WINDOW_NS = 100'000'000;  // 100 ms
+    /// Fraction of dequeues that drained the whole depth before the depth grows.
+    static constexpr double SATURATED_FRACTION = 0.1;
+
+    /**
+     * @brief Construct a controller.
+     *
+     * @param initial Starting depth (clamped to the bounds).
+     * @param min_depth Smallest depth the controller may choose.
+     * @param max_depth Largest depth the controller may choose.
+     * @param enabled If false the depth stays at `initial` and `update()` is a no-op.
+     */
+    adaptive_depth(size_t initial, size_t min_depth, size_t max_depth, bool enabled)
+        : min_depth_(min_depth),
+          max_depth_((std::max)(min_depth, max_depth)),
+          depth_(enabled ? std::clamp(initial, min_depth_, max_depth_) : initial),
+          enabled_(enabled) {}
+
+    /// Current target depth.
+    size_t depth() const { return depth_; }
+    /// Largest depth this controller may ever return.
+    size_t max_depth() const { return enabled_ ? max_depth_ : depth_; }
+    /// True if the depth adapts to load.
+    bool enabled() const { return enabled_; }
+
+    /**
+     * @brief Record one dequeue that returned `recv_completions` receive completions.
+     */
+    void on_dequeue(size_t recv_completions) {
+        ++dequeues_;
+        if (recv_completions >= depth_) ++saturated_;
+        peak_ = (std::max)(peak_, recv_completions);
+    }
+
+    /// Record that an echo was dropped because the send pool was empty.
+    void on_pool_empty() { ++pool_empty_; }
+
+    /**
+     * @brief Re-evaluate the depth if the current window has elapsed.
+     *
+     * @param now_ns Current monotonic time in nanoseconds.
+     * @return true if the depth changed.
+     */
+    bool update(uint64_t now_ns) {
+        if (!enabled_) return false;
+        if (window_start_ns_ == 0) window_start_ns_ = now_ns;
+        if (now_ns - window_start_ns_ < WINDOW_NS) return false;
+
+        const size_t previous = depth_;
+        const bool saturated =
+            dequeues_ > 0 && static_cast<double>(saturated_) >=
+                                 SATURATED_FRACTION * static_cast<double>(dequeues_);
+        if (pool_empty_ > 0 || saturated) {
+            depth_ = (std::min)(max_depth_, depth_ * 2);
+        } else if (peak_ < depth_ / 4) {
+            depth_ = (std::max)(min_depth_, depth_ / 2);
+        }
+
+        window_start_ns_ = now_ns;
+        dequeues_ = saturated_ = pool_empty_ = peak_ = 0;
+        return depth_ != previous;
+    }
+
+   private:
+    size_t min_depth_;
+    size_t max_depth_;
+    size_t depth_;
+    bool enabled_;
+
+    uint64_t window_start_ns_{0};
+    uint64_t dequeues_{0};
+    uint64_t saturated_{0};
+    uint64_t pool_empty_{0};
+    size_t peak_{0};
+};
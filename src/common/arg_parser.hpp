@@ -207,6 +207,28 @@ class ArgParser {
         return it->second.set;
     }
 
+    /**
+     * Rebuild the options that were explicitly set as command-line arguments.
+     *
+     * Each set option becomes `--name value` (or `--name` for a flag), so the
+     * result can be passed to another instance of the program.
+     *
+     * @param exclude Long option names to leave out.
+     * @return The arguments, in option-name order.
+     */
+    std::vector<std::string> set_arguments(const std::vector<std::string>& exclude = {}) const {
+        std::vector<std::string> args;
+        for (const auto& [long_name, opt] : opts_) {
+            if (!opt.set) continue;
+            bool excluded = false;
+            for (const auto& e : exclude) excluded = excluded || e == long_name;
+            if (excluded) continue;
+            args.push_back("--" + long_name);
+            if (opt.takes_value) args.push_back(opt.value);
+        }
+        return args;
+    }
+
    private:
     /**
      * Internal representation for a registered option.
@@ -0,0 +1,166 @@
+/**
+ * @file arrival_process.hpp
+ * @brief Open-loop arrival processes for the client's `--arrival` modes.
+ *
+ * An arrival process yields the gap between consecutive intended send
+ * times. Unlike the token bucket, the schedule does not depend on when
+ * packets actually leave, so a stalled client or server shows up as
+ * schedule lag and latency instead of silently sending less.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief An arrival process used by `open_loop_pacer`.
+ *
+ * @tparam T The arrival process type to check.
+ */
+template <typename T>
+concept ArrivalProcessConcept = requires(T a) {
+    { a.next_gap_ns() } -> std::same_as<uint64_t>;
+    { a.mean_rate_pps() } -> std::same_as<double>;
+};
+
+/**
+ * @brief Poisson arrivals: exponentially distributed gaps at a mean rate.
+ *
+ * Workers' independent Poisson streams add up to a Poisson stream at the
+ * total rate.
+ */
+class poisson_arrivals {
+   public:
+    poisson_arrivals(double rate_pps, uint64_t seed)
+        : rate_pps_(rate_pps), rng_(seed), gap_s_(rate_pps) {}
+
+    uint64_t next_gap_ns() { return static_cast<uint64_t>(gap_s_(rng_) * 1e9); }
+    double mean_rate_pps() const { return rate_pps_; }
+
+   private:
+    double rate_pps_;
+    std::mt19937_64 rng_;
+    std::exponential_distribution<double> gap_s_;
+};
+
+/**
+ * @brief On/off arrivals: evenly spaced bursts during "on", silence during "off".
+ *
+ * The peak rate during "on" is chosen so the mean over a period equals
+ * `rate_pps`. Workers start together, so their bursts coincide.
+ */
+class on_off_arrivals {
+   public:
+    on_off_arrivals(double rate_pps, uint64_t on_ns, uint64_t off_ns)
+        : rate_pps_(rate_pps), on_ns_(on_ns), off_ns_(off_ns) {
+        const double period_s = static_cast<double>(on_ns + off_ns) / 1e9;
+        per_burst_ = (std::max)(uint64_t{1}, static_cast<uint64_t>(rate_pps * period_s));
+        gap_ns_ = on_ns / per_burst_;
+    }
+
+    uint64_t next_gap_ns() {
+        if (++sent_in_burst_ < per_burst_) return gap_ns_;
+        // Last packet of the burst: wait out the rest of the on period and the off period.
+        sent_in_burst_ = 0;
+        return on_ns_ - gap_ns_ * (per_burst_ - 1) + off_ns_;
+    }
+    double mean_rate_pps() const { return rate_pps_; }
+
+   private:
+    double rate_pps_;
+    uint64_t on_ns_;
+    uint64_t off_ns_;
+    uint64_t per_burst_{1};
+    uint64_t gap_ns_{0};
+    uint64_t sent_in_burst_{0};
+};
+
+/**
+ * @brief Replay of recorded inter-arrival times, looping at the end.
+ *
+ * With N workers, worker i sends arrivals i, i+N, i+2N, ... of the trace, so
+ * together they reproduce the recorded aggregate arrival process.
+ */
+class trace_arrivals {
+   public:
+    /**
+     * @param gaps_ns Recorded gaps between consecutive arrivals (shared by all workers).
+     * @param worker_index This worker's index in [0, worker_count).
+     * @param worker_count Number of workers replaying the trace.
+     */
+    trace_arrivals(std::shared_ptr<const std::vector<uint64_t>> gaps_ns, size_t worker_index,
+                   size_t worker_count)
+        : gaps_(std::move(gaps_ns)), stride_(worker_count) {
+        uint64_t total_ns = 0;
+        for (uint64_t gap : *gaps_) total_ns += gap;
+        rate_pps_ = total_ns == 0 ? 0.0
+                                  : static_cast<double>(gaps_->size()) * 1e9 /
+                                        static_cast<double>(total_ns) /
+                                        static_cast<double>(worker_count);
+        // The first gap offsets this worker to its first arrival.
+        first_gap_ns_ = sum_gaps(worker_index);
+    }
+
+    uint64_t next_gap_ns() {
+        if (!started_) {
+            started_ = true;
+            return first_gap_ns_;
+        }
+        return sum_gaps(stride_);
+    }
+    double mean_rate_pps() const { return rate_pps_; }
+
+    /**
+     * @brief Load gaps from a text file: one inter-arrival time in microseconds per line.
+     *
+     * Blank lines and lines starting with `#` are skipped.
+     *
+     * @throws std::runtime_error if the file cannot be read or holds no valid gaps.
+     */
+    static std::shared_ptr<const std::vector<uint64_t>> load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) throw std::runtime_error("Failed to open arrival trace '" + path + "'");
+        auto gaps = std::make_shared<std::vector<uint64_t>>();
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            const double gap_us = std::stod(line);
+            if (!(gap_us >= 0.0)) {
+                throw std::runtime_error("Negative gap in arrival trace '" + path + "'");
+            }
+            gaps->push_back(static_cast<uint64_t>(gap_us * 1000.0));
+        }
+        if (gaps->empty()) throw std::runtime_error("Arrival trace '" + path + "' is empty");
+        return gaps;
+    }
+
+   private:
+    /// Sum the next `count` gaps, advancing (and wrapping) the replay position.
+    uint64_t sum_gaps(size_t count) {
+        uint64_t total_ns = 0;
+        for (size_t i = 0; i < count; ++i) {
+            total_ns += (*gaps_)[position_];
+            if (++position_ == gaps_->size()) position_ = 0;
+        }
+        return total_ns;
+    }
+
+    std::shared_ptr<const std::vector<uint64_t>> gaps_;
+    size_t stride_;
+    size_t position_{0};
+    uint64_t first_gap_ns_{0};
+    bool started_{false};
+    double rate_pps_{0.0};
+};
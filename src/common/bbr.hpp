@@ -14,11 +14,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
-#include <deque>
 
 #include "congestion_controller.hpp"
 
@@ -27,9 +28,11 @@
  * @brief Lightweight, header-only BBR-like congestion controller.
  *
  * This class provides a simplified BBR-inspired rate estimator intended for
- * use by the client pacer. It maintains a short history of sent sequence
- * numbers and ACK timestamps to estimate delivered bandwidth (packets per
- * second) and a smoothed RTT estimate. The controller exposes a target
+ * use by the client pacer. Each send records a snapshot of the delivery
+ * state in a fixed ring indexed by sequence number; the matching ACK turns
+ * it into a delivery-rate sample (packets per second), as in BBR's rate
+ * sampling, and updates a smoothed RTT estimate. Both paths are O(1) and
+ * never allocate. The controller exposes a target
  * sending rate in packets-per-second which callers should respect when
  * scheduling sends.
  */
@@ -64,26 +67,30 @@ class bbr_congestion_controller {
     /**
      * @brief Notify the controller that a packet was sent.
      *
-     * The controller records the sequence number and send timestamp so that
-     * delivered rate can later be estimated when ACKs arrive. Implementations
-     * should call this for each transmitted packet that they expect to be
-     * ACKed.
+     * The controller snapshots the delivered count and time into the
+     * sequence's history slot so the ACK can later compute the delivery rate
+     * over this packet's flight. Implementations should call this for each
+     * transmitted packet that they expect to be ACKed.
      *
      * @param now_ns Current time in nanoseconds.
      * @param seq Packet sequence number associated with the send.
      */
     void on_send(uint64_t now_ns, uint64_t seq) {
-        sent_history_.emplace_back(seq, now_ns);
-        while (sent_history_.size() > max_history_) sent_history_.pop_front();
+        // Nothing acknowledged yet: the delivery interval starts at the first send.
+        if (delivered_time_ns_ == 0) delivered_time_ns_ = first_sent_ns_ = now_ns;
+        sent_history_[seq & (HISTORY_CAPACITY - 1)] = {seq, now_ns, delivered_,
+                                                       delivered_time_ns_, first_sent_ns_};
     }
 
     /**
      * @brief Handle an incoming ACK and update bandwidth / RTT estimates.
      *
-     * Updates a smoothed RTT estimate, appends the ACK timestamp into a
-     * sliding window used to compute delivered packets-per-second, and
-     * computes a new target sending rate. The target is smoothed and never
-     * exceeds the value set by `set_initial_rate`.
+     * Updates a smoothed RTT estimate and, if the sequence's send record is
+     * still in the history ring, takes a delivery-rate sample: packets
+     * delivered since that send over the longer of its send and ACK
+     * intervals (which guards against ACK compression). The bandwidth
+     * estimate is smoothed from the samples and a new target sending rate is
+     * computed; it never exceeds the value set by `set_initial_rate`.
      *
      * @param now_ns Current time in nanoseconds (ACK receive time).
      * @param seq Sequence number acknowledged by this ACK.
@@ -96,19 +103,22 @@ class bbr_congestion_controller {
         else
             rtt_est_ns_ = static_cast<uint64_t>(rtt_est_ns_ * 0.875 + rtt_ns * 0.125);
 
-        // Add this ACK timestamp to sliding window and evict old samples
-        ack_history_.push_back(now_ns);
-        const uint64_t window_ns = ack_window_ns_;
-        while (!ack_history_.empty() && ack_history_.front() + window_ns < now_ns)
-            ack_history_.pop_front();
-
-        // Compute sample delivered packets/sec over the window
-        double sample_pps = 0.0;
-        if (!ack_history_.empty()) {
-            double window_s =
-                static_cast<double>(std::max<uint64_t>(1, now_ns - ack_history_.front())) * 1e-9;
-            if (window_s > 0.0) sample_pps = static_cast<double>(ack_history_.size()) / window_s;
-        }
+        ++delivered_;
+        delivered_time_ns_ = now_ns;
+
+        // A slot reused by a later sequence (more than HISTORY_CAPACITY in
+        // flight) or already acknowledged yields no sample.
+        send_record& sent = sent_history_[seq & (HISTORY_CAPACITY - 1)];
+        if (sent.seq != seq) return;
+        sent.seq = NO_SEQUENCE;
+        first_sent_ns_ = sent.send_ns;
+
+        const uint64_t send_elapsed_ns = sent.send_ns - sent.first_sent_ns;
+        const uint64_t ack_elapsed_ns = now_ns - sent.delivered_time_ns;
+        const uint64_t interval_ns = (std::max)(send_elapsed_ns, ack_elapsed_ns);
+        if (interval_ns == 0) return;
+        const double sample_pps = static_cast<double>(delivered_ - sent.delivered) * 1e9 /
+                                  static_cast<double>(interval_ns);
 
         if (bandwidth_pps_ == 0.0)
             bandwidth_pps_ = sample_pps;
@@ -190,21 +200,36 @@ class bbr_congestion_controller {
     const uint64_t decay_interval_ns_ = 200000000;  // 200ms
 
     /**
-     * @brief Maximum number of recent sends to remember.
+     * @brief Send records kept for matching ACKs; a power of two so the slot
+     * is `seq & (HISTORY_CAPACITY - 1)`.
+     */
+    static constexpr size_t HISTORY_CAPACITY = 4096;
+    static constexpr uint64_t NO_SEQUENCE = UINT64_MAX;
+
+    /**
+     * @brief Delivery state when a packet was sent.
      */
-    const size_t max_history_ = 1024;
+    struct send_record {
+        uint64_t seq{NO_SEQUENCE};
+        uint64_t send_ns{0};
+        /// `delivered_`, `delivered_time_ns_` and `first_sent_ns_` at send time.
+        uint64_t delivered{0};
+        uint64_t delivered_time_ns{0};
+        uint64_t first_sent_ns{0};
+    };
 
     /**
-     * @brief Recent sent packet records: pair<sequence, send_time_ns>.
+     * @brief Recent send records, indexed by sequence number.
      */
-    std::deque<std::pair<uint64_t, uint64_t>> sent_history_;  // pair<seq, send_ns>
+    std::array<send_record, HISTORY_CAPACITY> sent_history_{};
 
     /**
-     * @brief ACK receive timestamps used to compute delivered rate over a
-     * sliding window.
+     * @brief Packets acknowledged so far, the time of the latest ACK, and the
+     * send time of the packet it acknowledged.
      */
-    const uint64_t ack_window_ns_ = 200000000;  // 200ms
-    std::deque<uint64_t> ack_history_;
+    uint64_t delivered_ = 0;
+    uint64_t delivered_time_ns_ = 0;
+    uint64_t first_sent_ns_ = 0;
 
     /**
      * @brief Optional initial rate (pps) supplied by the caller; acts as an
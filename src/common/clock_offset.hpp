@@ -0,0 +1,77 @@
+/**
+ * @file clock_offset.hpp
+ * @brief Client/server clock offset estimate for one-way delay decomposition.
+ *
+ * With client send/receive times t0/t3 and server receive/send times t1/t2
+ * (each on its own host's clock), the round trip splits into
+ * client->server = t1 - t0 - offset, server dwell = t2 - t1 and
+ * server->client = t3 - t2 + offset. The offset is taken NTP-style from the
+ * exchange with the smallest network path (rtt - dwell), where queueing is
+ * least and the two directions are most nearly symmetric. The minimum is
+ * searched over a sliding pair of windows so slow clock drift is followed.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Windowed minimum-path estimator of (server clock - client clock).
+ * @note Not thread-safe; one per client worker.
+ */
+class clock_offset_estimator {
+   public:
+    /// Default window over which the best exchange is searched.
+    static constexpr uint64_t DEFAULT_WINDOW_NS = 10'000'000'000ULL;
+
+    explicit clock_offset_estimator(uint64_t window_ns = DEFAULT_WINDOW_NS)
+        : window_ns_(window_ns) {}
+
+    /**
+     * @brief Feed one exchange. Exchanges whose timestamps are not ordered are ignored.
+     *
+     * @param t0 Client send time (client clock).
+     * @param t1 Server receive time (server clock).
+     * @param t2 Server send time (server clock).
+     * @param t3 Client receive time (client clock).
+     */
+    void on_exchange(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3) {
+        if (t3 < t0 || t2 < t1 || t3 - t0 < t2 - t1) return;
+        const uint64_t path_ns = (t3 - t0) - (t2 - t1);
+        const int64_t offset_ns =
+            (static_cast<int64_t>(t1 - t0) + static_cast<int64_t>(t2 - t3)) / 2;
+
+        if (window_start_ns_ == 0) {
+            window_start_ns_ = t3;
+        } else if (t3 - window_start_ns_ >= window_ns_) {
+            previous_ = current_;
+            current_ = {};
+            window_start_ns_ = t3;
+        }
+        if (path_ns < current_.path_ns) current_ = {path_ns, offset_ns};
+    }
+
+    /// True once at least one exchange has been accepted.
+    bool valid() const { return best().path_ns != UINT64_MAX; }
+
+    /// Estimated server clock minus client clock, in nanoseconds.
+    int64_t offset_ns() const { return best().offset_ns; }
+
+   private:
+    struct sample {
+        uint64_t path_ns{UINT64_MAX};
+        int64_t offset_ns{0};
+    };
+
+    const sample& best() const {
+        return previous_.path_ns < current_.path_ns ? previous_ : current_;
+    }
+
+    uint64_t window_ns_;
+    uint64_t window_start_ns_{0};
+    sample current_;
+    sample previous_;
+};
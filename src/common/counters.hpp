@@ -0,0 +1,50 @@
+/**
+ * @file counters.hpp
+ * @brief Single-writer statistics counters for worker hot paths.
+ *
+ * Each worker owns its counters and is the only thread that updates them;
+ * stats threads only take snapshots. Under that contract an update does not
+ * need a locked read-modify-write: a relaxed load followed by a relaxed store
+ * compiles to a plain add on x86, while readers still see a consistent,
+ * tear-free value through the atomic.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief 64-bit counter with one writer thread and any number of snapshot readers.
+ *
+ * Not safe for concurrent writers; use `std::atomic::fetch_add` for those.
+ */
+class single_writer_counter {
+   public:
+    constexpr single_writer_counter(uint64_t initial = 0) : value_(initial) {}
+
+    single_writer_counter(const single_writer_counter&) = delete;
+    single_writer_counter& operator=(const single_writer_counter&) = delete;
+
+    /// Add `n` (writer thread only).
+    void add(uint64_t n = 1) { store(load() + n); }
+    /// Replace the value (writer thread only).
+    void store(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+    /// Relaxed snapshot; safe from any thread.
+    uint64_t load() const { return value_.load(std::memory_order_relaxed); }
+
+    /// Lower the value to `value` if it is smaller (writer thread only).
+    void update_min(uint64_t value) {
+        if (value < load()) store(value);
+    }
+    /// Raise the value to `value` if it is larger (writer thread only).
+    void update_max(uint64_t value) {
+        if (value > load()) store(value);
+    }
+
+   private:
+    std::atomic<uint64_t> value_;
+};
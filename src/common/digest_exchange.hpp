@@ -0,0 +1,126 @@
+/**
+ * @file digest_exchange.hpp
+ * @brief Lock-free hand-off of filled per-worker digests to a merge thread.
+ *
+ * Each worker owns a small, fixed pool of digest objects. It records samples
+ * into the current one and, when it rotates, pushes that digest onto a
+ * "filled" SPSC ring and takes a cleared one from a "free" ring. The merge
+ * thread pops filled digests, merges them, resets them and returns them on the
+ * free ring. Digests are recycled rather than reallocated, and if the merge
+ * thread has not returned one yet the worker simply keeps accumulating into
+ * the current digest, so a rotation never blocks and never allocates.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "counters.hpp"
+#include "spsc_ring.hpp"
+
+/**
+ * @brief One worker's pool of recycled digests and the rings that move them.
+ *
+ * The worker thread is the only caller of `current()`, `rotate()` and
+ * `close()`; the merge thread is the only caller of `drain()`.
+ *
+ * @tparam Digest Digest type; must provide `reset()`.
+ */
+template <typename Digest>
+class digest_exchange {
+   public:
+    /// Digests per exchange unless the caller asks for more.
+    static constexpr size_t DEFAULT_POOL_SIZE = 4;
+
+    /**
+     * @brief Construct the pool with `pool_size` digests created by `make`.
+     *
+     * @param pool_size Digests in the pool (at least 2: one current, one spare).
+     * @param make Callable returning `std::unique_ptr<Digest>`; called `pool_size` times here.
+     */
+    template <typename Factory>
+    digest_exchange(size_t pool_size, Factory&& make)
+        : filled_((std::max)(pool_size, size_t{2})), free_((std::max)(pool_size, size_t{2})) {
+        pool_size = (std::max)(pool_size, size_t{2});
+        storage_.reserve(pool_size);
+        for (size_t i = 0; i < pool_size; ++i) {
+            storage_.push_back(make());
+        }
+        current_ = storage_.front().get();
+        for (size_t i = 1; i < pool_size; ++i) {
+            free_.try_push(storage_[i].get());
+        }
+    }
+
+    digest_exchange(const digest_exchange&) = delete;
+    digest_exchange& operator=(const digest_exchange&) = delete;
+
+    /// Digest the worker records into. Must not be called after `close()`.
+    Digest& current() { return *current_; }
+
+    /**
+     * @brief Hand the current digest to the merge thread and switch to a cleared one.
+     *
+     * @return false if no cleared digest was available; the current digest is
+     *         kept and the caller simply tries again on a later sample.
+     */
+    bool rotate() {
+        Digest* next = nullptr;
+        if (!free_.try_pop(next)) {
+            deferred_rotations_.add();
+            return false;
+        }
+        // Every digest is either current, filled or free, so `filled_` has room.
+        filled_.try_push(current_);
+        current_ = next;
+        return true;
+    }
+
+    /**
+     * @brief Hand over the current digest for a final merge (worker exit).
+     */
+    void close() {
+        if (current_ == nullptr) return;
+        filled_.try_push(current_);
+        current_ = nullptr;
+    }
+
+    /**
+     * @brief Merge every filled digest with `merge` and return it to the worker.
+     *
+     * @param merge Callable invoked as `merge(Digest&)` for each filled digest; it may
+     *              modify the digest (e.g. compress it), which is reset afterwards.
+     * @return Number of digests merged.
+     */
+    template <typename Merge>
+    size_t drain(Merge&& merge) {
+        size_t merged = 0;
+        Digest* digest = nullptr;
+        while (filled_.try_pop(digest)) {
+            merge(*digest);
+            digest->reset();
+            free_.try_push(digest);
+            ++merged;
+        }
+        return merged;
+    }
+
+    /// Rotations skipped because the merge thread had not yet returned a digest.
+    uint64_t deferred_rotations() const { return deferred_rotations_.load(); }
+
+   private:
+    std::vector<std::unique_ptr<Digest>> storage_;
+    Digest* current_{nullptr};
+    /// Worker -> merge thread.
+    spsc_ring<Digest*> filled_;
+    /// Merge thread -> worker.
+    spsc_ring<Digest*> free_;
+    single_writer_counter deferred_rotations_{0};
+};
@@ -0,0 +1,108 @@
+/**
+ * @file io_context_pool.cpp
+ * @brief Implementation of the NUMA-local `io_context` slab allocator.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "io_context_pool.hpp"
+
+#include <mutex>
+#include <new>
+
+/**
+ * @brief Round `value` up to a multiple of `alignment` (a power of two).
+ */
+static size_t round_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @brief Enable `SeLockMemoryPrivilege` on the process token, once per process.
+ *
+ * Large-page allocations fail without this privilege; the account must hold
+ * the "Lock pages in memory" user right for it to be enabled.
+ *
+ * @return true if the privilege is enabled.
+ */
+static bool enable_lock_memory_privilege() {
+    static std::once_flag once;
+    static bool enabled = false;
+    std::call_once(once, []() {
+        HANDLE raw_token = nullptr;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY,
+                              &raw_token)) {
+            return;
+        }
+        wil::unique_handle token(raw_token);
+
+        TOKEN_PRIVILEGES privileges = {};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if (!LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)) {
+            return;
+        }
+        // AdjustTokenPrivileges succeeds with ERROR_NOT_ALL_ASSIGNED when the
+        // account does not hold the right, so check the last error as well.
+        enabled = AdjustTokenPrivileges(token.get(), FALSE, &privileges, 0, nullptr, nullptr) &&
+                  GetLastError() == ERROR_SUCCESS;
+    });
+    return enabled;
+}
+
+/**
+ * @brief Allocate the slab on `numa_node` and construct the contexts in place.
+ */
+io_context_pool::io_context_pool(size_t count, size_t buffer_size, uint32_t numa_node)
+    : count_(count), buffer_size_(buffer_size), numa_node_(numa_node) {
+    if (count_ == 0) return;
+
+    // Headers first (already cache-line sized through io_context's alignment),
+    // then one cache-line aligned buffer per context.
+    const size_t headers_size = round_up(count_ * sizeof(io_context), CACHE_LINE_SIZE);
+    const size_t buffer_stride = round_up(buffer_size_, CACHE_LINE_SIZE);
+    const size_t required = headers_size + count_ * buffer_stride;
+
+    // Large pages only pay off once the slab spans at least one of them.
+    const size_t large_page = GetLargePageMinimum();
+    if (large_page != 0 && required >= large_page && enable_lock_memory_privilege()) {
+        const size_t size = round_up(required, large_page);
+        base_ = static_cast<char*>(
+            VirtualAllocExNuma(GetCurrentProcess(), nullptr, size,
+                               MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE,
+                               numa_node_));
+        if (base_ != nullptr) {
+            slab_size_ = size;
+            large_pages_ = true;
+        }
+    }
+
+    if (base_ == nullptr) {
+        base_ = static_cast<char*>(VirtualAllocExNuma(GetCurrentProcess(), nullptr, required,
+                                                      MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE,
+                                                      numa_node_));
+        if (base_ == nullptr) {
+            throw socket_exception(std::format("VirtualAllocExNuma ({} bytes, node {}) failed: {}",
+                                               required, numa_node_, get_last_error_message()));
+        }
+        slab_size_ = required;
+    }
+
+    contexts_ = reinterpret_cast<io_context*>(base_);
+    for (size_t i = 0; i < count_; ++i) {
+        io_context* ctx = new (contexts_ + i) io_context();
+        ctx->attach_buffer(std::span<char>(base_ + headers_size + i * buffer_stride, buffer_size_));
+    }
+}
+
+/**
+ * @brief Destroy the contexts and release the slab.
+ */
+io_context_pool::~io_context_pool() {
+    if (base_ == nullptr) return;
+    for (size_t i = 0; i < count_; ++i) {
+        contexts_[i].~io_context();
+    }
+    VirtualFree(base_, 0, MEM_RELEASE);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file io_context_pool.hpp
+ * @brief Per-worker slab allocator for `io_context` headers and packet buffers.
+ *
+ * A pool owns one virtual allocation on a single NUMA node. The front of the
+ * slab holds the `io_context` headers back-to-back (each one cache-line
+ * aligned), followed by one cache-line aligned packet buffer per context sized
+ * to the configured maximum datagram size. Large pages are used when the slab
+ * is big enough and the process holds `SeLockMemoryPrivilege`; otherwise the
+ * pool falls back to regular pages.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "socket_utils.hpp"
+
+/**
+ * @brief Fixed-size pool of `io_context` objects backed by a NUMA-local slab.
+ *
+ * Contexts are addressed by index and stay at stable addresses for the life
+ * of the pool, so a contiguous range test (`contains`) can tell which pool a
+ * completed `OVERLAPPED` came from.
+ */
+class io_context_pool {
+   public:
+    /**
+     * @brief Allocate `count` contexts, each with a `buffer_size`-byte packet buffer.
+     *
+     * @param count Number of contexts.
+     * @param buffer_size Packet buffer size per context in bytes.
+     * @param numa_node NUMA node to allocate from; defaults to the node of the
+     *                  calling thread's current processor.
+     * @throws socket_exception if the slab cannot be allocated.
+     */
+    io_context_pool(size_t count, size_t buffer_size, uint32_t numa_node = get_current_numa_node());
+    ~io_context_pool();
+
+    io_context_pool(const io_context_pool&) = delete;
+    io_context_pool& operator=(const io_context_pool&) = delete;
+
+    /// Number of contexts in the pool.
+    size_t size() const { return count_; }
+    /// Packet buffer size of each context in bytes.
+    size_t buffer_size() const { return buffer_size_; }
+    /// NUMA node the slab was allocated from.
+    uint32_t numa_node() const { return numa_node_; }
+    /// True if the slab is backed by large pages.
+    bool large_pages() const { return large_pages_; }
+    /// Total bytes committed for headers and buffers.
+    size_t slab_size() const { return slab_size_; }
+
+    /// Context at `index`.
+    io_context* get(size_t index) const { return contexts_ + index; }
+    /// Iteration over the contexts.
+    io_context* begin() const { return contexts_; }
+    io_context* end() const { return contexts_ + count_; }
+
+    /// True if `ctx` is one of this pool's contexts.
+    bool contains(const io_context* ctx) const { return ctx >= begin() && ctx < end(); }
+
+   private:
+    char* base_{nullptr};
+    io_context* contexts_{nullptr};
+    size_t count_{0};
+    size_t buffer_size_{0};
+    size_t slab_size_{0};
+    uint32_t numa_node_{0};
+    bool large_pages_{false};
+};
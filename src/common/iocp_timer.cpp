@@ -0,0 +1,113 @@
+/**
+ * @file iocp_timer.cpp
+ * @brief Implementation of the IOCP-completing high-resolution timer.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "iocp_timer.hpp"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace {
+
+// Wait completion packet entry points (ntdll, Windows 8 and later).
+using nt_create_wait_completion_packet_fn = NTSTATUS(NTAPI*)(PHANDLE, ACCESS_MASK, PVOID);
+using nt_associate_wait_completion_packet_fn = NTSTATUS(NTAPI*)(HANDLE, HANDLE, HANDLE, PVOID,
+                                                                PVOID, NTSTATUS, ULONG_PTR,
+                                                                PBOOLEAN);
+using nt_cancel_wait_completion_packet_fn = NTSTATUS(NTAPI*)(HANDLE, BOOLEAN);
+
+struct wait_completion_packet_api {
+    nt_create_wait_completion_packet_fn create{nullptr};
+    nt_associate_wait_completion_packet_fn associate{nullptr};
+    nt_cancel_wait_completion_packet_fn cancel{nullptr};
+};
+
+/// Resolve the entry points once; members stay null where unavailable.
+const wait_completion_packet_api& wait_completion_packets() {
+    static const wait_completion_packet_api api = []() {
+        wait_completion_packet_api a;
+        HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+        if (ntdll == nullptr) return a;
+        a.create = reinterpret_cast<nt_create_wait_completion_packet_fn>(
+            GetProcAddress(ntdll, "NtCreateWaitCompletionPacket"));
+        a.associate = reinterpret_cast<nt_associate_wait_completion_packet_fn>(
+            GetProcAddress(ntdll, "NtAssociateWaitCompletionPacket"));
+        a.cancel = reinterpret_cast<nt_cancel_wait_completion_packet_fn>(
+            GetProcAddress(ntdll, "NtCancelWaitCompletionPacket"));
+        return a;
+    }();
+    return api;
+}
+
+}  // namespace
+
+/**
+ * @brief Create a high-resolution timer and a wait completion packet for `iocp`.
+ */
+iocp_timer::iocp_timer(HANDLE iocp, ULONG_PTR key) : iocp_(iocp), key_(key) {
+    const auto& api = wait_completion_packets();
+    if (api.create == nullptr || api.associate == nullptr || api.cancel == nullptr) {
+        throw socket_exception("Wait completion packets are not supported by this system");
+    }
+
+    timer_.reset(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                        TIMER_ALL_ACCESS));
+    if (!timer_) {
+        throw socket_exception(std::format("CreateWaitableTimerExW (high resolution) failed: {}",
+                                           get_last_error_message()));
+    }
+
+    HANDLE packet = nullptr;
+    const NTSTATUS status = api.create(&packet, GENERIC_ALL, nullptr);
+    if (status < 0) {
+        throw socket_exception(std::format("NtCreateWaitCompletionPacket failed: 0x{:08x}",
+                                           static_cast<uint32_t>(status)));
+    }
+    packet_.reset(packet);
+}
+
+/**
+ * @brief Drop a pending association (and any expiry already queued) before the handles close.
+ */
+iocp_timer::~iocp_timer() {
+    if (packet_) wait_completion_packets().cancel(packet_.get(), TRUE);
+}
+
+/**
+ * @brief Set the timer's due time and make sure an association is outstanding.
+ */
+bool iocp_timer::arm(uint64_t delay_ns) {
+    const uint64_t deadline_ns = get_timestamp_ns() + delay_ns;
+    if (pending_ && (deadline_ns > deadline_ns_ ? deadline_ns - deadline_ns_
+                                                : deadline_ns_ - deadline_ns) < REARM_SLACK_NS) {
+        return true;
+    }
+
+    // Relative due times are negative, in 100 ns units.
+    LARGE_INTEGER due = {};
+    due.QuadPart = -(std::max)(LONGLONG{1}, static_cast<LONGLONG>(delay_ns / 100));
+    if (!SetWaitableTimer(timer_.get(), &due, 0, nullptr, nullptr, FALSE)) {
+        throw socket_exception(
+            std::format("SetWaitableTimer failed: {}", get_last_error_message()));
+    }
+    deadline_ns_ = deadline_ns;
+    // Moving the due time of a timer that is already associated needs no new association.
+    if (pending_) return true;
+
+    BOOLEAN already_signaled = FALSE;
+    const NTSTATUS status =
+        wait_completion_packets().associate(packet_.get(), iocp_, timer_.get(),
+                                            reinterpret_cast<PVOID>(key_), nullptr, 0, 0,
+                                            &already_signaled);
+    if (status < 0) {
+        throw socket_exception(std::format("NtAssociateWaitCompletionPacket failed: 0x{:08x}",
+                                           static_cast<uint32_t>(status)));
+    }
+    pending_ = !already_signaled;
+    return pending_;
+}
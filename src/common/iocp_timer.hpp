@@ -0,0 +1,74 @@
+/**
+ * @file iocp_timer.hpp
+ * @brief High-resolution waitable timer whose expiry is queued to an IOCP.
+ *
+ * The timer is created with `CREATE_WAITABLE_TIMER_HIGH_RESOLUTION` and tied
+ * to the completion port through a wait completion packet
+ * (`NtAssociateWaitCompletionPacket`, the mechanism the system thread pool
+ * uses), so a pacer deadline arrives as one more entry in the worker's
+ * `GetQueuedCompletionStatusEx` batch. A worker can then block in a single
+ * dequeue until either I/O completes or it is time to send, instead of
+ * sleeping in millisecond steps or spinning.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "socket_utils.hpp"
+
+/**
+ * @brief One-shot high-resolution timer that completes to an IOCP.
+ *
+ * The expiry is dequeued as an entry with `lpCompletionKey == key()` and a
+ * null `lpOverlapped`; pass it to `on_completion`. Not thread-safe; owned by
+ * the worker that dequeues from the port.
+ */
+class iocp_timer {
+   public:
+    /**
+     * @brief Create the timer and its wait completion packet.
+     *
+     * @param iocp Completion port expiries are queued to.
+     * @param key Completion key that identifies expiries on that port.
+     * @throws socket_exception if high-resolution timers or wait completion
+     *         packets are not available (callers fall back to timed waits).
+     */
+    iocp_timer(HANDLE iocp, ULONG_PTR key);
+    ~iocp_timer();
+
+    iocp_timer(const iocp_timer&) = delete;
+    iocp_timer& operator=(const iocp_timer&) = delete;
+
+    /**
+     * @brief Arrange for an expiry to be queued `delay_ns` from now.
+     *
+     * Replaces any earlier deadline. Re-arming to within `REARM_SLACK_NS` of
+     * a deadline that is still pending is skipped, so a worker woken by I/O
+     * can re-arm every pass without a system call each time.
+     *
+     * @return false if the timer had already expired when associated (no
+     *         completion will be queued; the caller should treat the deadline
+     *         as reached).
+     */
+    bool arm(uint64_t delay_ns);
+
+    /// Record that the expiry for the pending deadline was dequeued.
+    void on_completion() { pending_ = false; }
+
+    ULONG_PTR key() const { return key_; }
+
+    /// Deadlines closer than this to a pending one are not re-armed.
+    static constexpr uint64_t REARM_SLACK_NS = 20'000ULL;  // 20 us
+
+   private:
+    HANDLE iocp_;
+    ULONG_PTR key_;
+    wil::unique_handle timer_;
+    wil::unique_handle packet_;
+    /// An association is outstanding (its expiry has not been dequeued).
+    bool pending_{false};
+    /// Absolute deadline (`get_timestamp_ns` clock) of the pending association.
+    uint64_t deadline_ns_{0};
+};
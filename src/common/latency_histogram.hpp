@@ -0,0 +1,148 @@
+/**
+ * @file latency_histogram.hpp
+ * @brief Fixed-size, log-linear (HDR-style) latency histogram.
+ *
+ * Values are bucketed by their power of two and, within each power of two,
+ * by their top `SUB_BUCKET_BITS` bits, so every bucket spans less than
+ * 1/128 of its value. Values below 2^SUB_BUCKET_BITS get exact buckets.
+ * Recording is a bit scan, a shift and one increment; the bucket array is
+ * allocated once at construction, and two histograms merge by adding their
+ * arrays element by element. Unlike a t-digest, tail percentiles come from
+ * exact bucket counts, and memory stays the same however long the run.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Log-linear histogram of unsigned integer values (nanoseconds in this project).
+ * @note Not thread-safe; owned by one thread at a time (hand off with `digest_exchange`).
+ */
+class latency_histogram {
+   public:
+    /// Linear sub-buckets per power of two: 2^7 = 128, i.e. < 0.8% relative error.
+    static constexpr unsigned SUB_BUCKET_BITS = 7;
+    /// Largest power of two tracked; larger values land in the top bucket (~68.7 s in ns).
+    static constexpr unsigned MAX_VALUE_BITS = 36;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr uint64_t MAX_TRACKABLE = (uint64_t{1} << MAX_VALUE_BITS) - 1;
+    static constexpr size_t BUCKET_COUNT =
+        static_cast<size_t>((MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS);
+
+    latency_histogram() : counts_(BUCKET_COUNT, 0) {}
+
+    /**
+     * @brief Record one value. Values above `MAX_TRACKABLE` are clamped to it.
+     */
+    void record(uint64_t value) {
+        if (value > MAX_TRACKABLE) {
+            value = MAX_TRACKABLE;
+            ++saturated_;
+        }
+        ++counts_[bucket_index(value)];
+        ++total_;
+        min_ = (std::min)(min_, value);
+        max_ = (std::max)(max_, value);
+    }
+
+    /**
+     * @brief Add every bucket of `other` into this histogram.
+     */
+    void merge(const latency_histogram& other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        saturated_ += other.saturated_;
+        min_ = (std::min)(min_, other.min_);
+        max_ = (std::max)(max_, other.max_);
+    }
+
+    /**
+     * @brief Reset to empty without releasing the bucket array.
+     */
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = saturated_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+    }
+
+    /**
+     * @brief Value at quantile q in [0,1]. Returns NaN if empty.
+     *
+     * Returns the midpoint of the bucket holding the q-th value, clamped to
+     * the recorded minimum and maximum so p0 and p100 are exact.
+     */
+    double percentile(double q) const {
+        if (!(q >= 0.0 && q <= 1.0)) throw std::invalid_argument("q must be in [0,1]");
+        if (total_ == 0) return std::numeric_limits<double>::quiet_NaN();
+
+        const uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total_)));
+        const uint64_t target = (std::max)(uint64_t{1}, rank);
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            cumulative += counts_[i];
+            if (cumulative >= target) {
+                const double low = static_cast<double>(bucket_low(i));
+                const double mid = low + static_cast<double>(bucket_width(i) - 1) / 2.0;
+                return std::clamp(mid, static_cast<double>(min_), static_cast<double>(max_));
+            }
+        }
+        return static_cast<double>(max_);
+    }
+
+    /// Number of values recorded.
+    uint64_t total_count() const { return total_; }
+    /// Values clamped to `MAX_TRACKABLE`.
+    uint64_t saturated_count() const { return saturated_; }
+    /// Smallest value recorded (UINT64_MAX if empty).
+    uint64_t min_value() const { return min_; }
+    /// Largest value recorded (0 if empty).
+    uint64_t max_value() const { return max_; }
+
+   private:
+    /**
+     * @brief Bucket for `value` (<= MAX_TRACKABLE).
+     *
+     * Below SUB_BUCKETS the index is the value. Above it, the exponent picks
+     * a row of SUB_BUCKETS buckets and the top SUB_BUCKET_BITS bits below the
+     * leading one pick the column.
+     */
+    static size_t bucket_index(uint64_t value) {
+        if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+        const unsigned exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+        const unsigned shift = exponent - SUB_BUCKET_BITS;
+        const uint64_t sub = (value >> shift) - SUB_BUCKETS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKETS + sub);
+    }
+
+    /// Smallest value mapping to bucket `index`.
+    static uint64_t bucket_low(size_t index) {
+        if (index < SUB_BUCKETS) return index;
+        const uint64_t row = index / SUB_BUCKETS;  // shift + 1
+        const uint64_t sub = index % SUB_BUCKETS;
+        return (SUB_BUCKETS + sub) << (row - 1);
+    }
+
+    /// Number of distinct values mapping to bucket `index`.
+    static uint64_t bucket_width(size_t index) {
+        if (index < SUB_BUCKETS) return 1;
+        return uint64_t{1} << (index / SUB_BUCKETS - 1);
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_{0};
+    uint64_t saturated_{0};
+    uint64_t min_{UINT64_MAX};
+    uint64_t max_{0};
+};
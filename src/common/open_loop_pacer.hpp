@@ -0,0 +1,67 @@
+/**
+ * @file open_loop_pacer.hpp
+ * @brief Pacer that follows an open-loop arrival schedule.
+ *
+ * Each packet has an intended send time drawn from an arrival process,
+ * independent of when earlier packets actually went out. When the client
+ * falls behind (send pool exhausted, thread descheduled, slow completions)
+ * the backlog is sent as soon as possible and the delay is reported as
+ * schedule lag; the client stamps packets with their intended send time so
+ * measured latency includes it, avoiding coordinated omission.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include "arrival_process.hpp"
+#include "pacer.hpp"
+
+/**
+ * @brief Open-loop pacer over an arrival process.
+ *
+ * Congestion feedback is ignored: an open-loop generator must not slow down
+ * when the system under test does.
+ *
+ * @note Not thread-safe; one per client worker.
+ */
+template <ArrivalProcessConcept Arrivals>
+class open_loop_pacer : public client_send_pacer_base {
+   public:
+    explicit open_loop_pacer(Arrivals arrivals)
+        : arrivals_(std::move(arrivals)), first_gap_ns_(arrivals_.next_gap_ns()) {
+        reset_to_now(get_timestamp_ns());
+    }
+
+    bool can_send(uint64_t now_ns) override { return now_ns >= next_send_ns_; }
+
+    void record_send(uint64_t, uint64_t) override { next_send_ns_ += arrivals_.next_gap_ns(); }
+
+    void poll(uint64_t) override {}
+
+    uint64_t get_next_send_time_ns(uint64_t now_ns) const override {
+        return next_send_ns_ > now_ns ? next_send_ns_ - now_ns : 0;
+    }
+
+    // The schedule (re)starts one first gap from now.
+    void reset_to_now(uint64_t now_ns) override { next_send_ns_ = now_ns + first_gap_ns_; }
+
+    void on_ack(uint64_t, uint64_t, uint64_t) override {}
+
+    double get_target_rate_pps() const override { return arrivals_.mean_rate_pps(); }
+
+    uint64_t schedule_lag_ns(uint64_t now_ns) const override {
+        return now_ns > next_send_ns_ ? now_ns - next_send_ns_ : 0;
+    }
+
+   private:
+
+    Arrivals arrivals_;
+    uint64_t first_gap_ns_;
+    /// Intended send time of the next packet (`get_timestamp_ns` clock).
+    uint64_t next_send_ns_{0};
+};
@@ -13,26 +13,34 @@
 #pragma once
 
 #include <algorithm>
-#include <chrono>
 #include <cstdint>
+#include <utility>
 
 #include "congestion_controller.hpp"
+#include "null_cc.hpp"
+#include "timestamp.hpp"
 
 /**
  * @brief Abstract base for client send pacer. Provides a stable polymorphic
  * interface so different templated pacer implementations can be stored
  * behind a single pointer type.
+ *
+ * Every call takes the current time (`get_timestamp_ns`) from the caller,
+ * so a send loop reads the clock once and reuses it instead of each pacer
+ * call reading it again.
  */
 class client_send_pacer_base {
    public:
     virtual ~client_send_pacer_base() = default;
-    virtual bool can_send() = 0;
-    virtual void record_send(uint64_t seq) = 0;
-    virtual void poll() = 0;
-    virtual uint64_t get_next_send_time_ns() const = 0;
-    virtual void reset_to_now() = 0;
+    virtual bool can_send(uint64_t now_ns) = 0;
+    virtual void record_send(uint64_t now_ns, uint64_t seq) = 0;
+    virtual void poll(uint64_t now_ns) = 0;
+    virtual uint64_t get_next_send_time_ns(uint64_t now_ns) const = 0;
+    virtual void reset_to_now(uint64_t now_ns) = 0;
     virtual void on_ack(uint64_t now_ns, uint64_t seq, uint64_t rtt_ns) = 0;
     virtual double get_target_rate_pps() const = 0;
+    /// How far behind its intended send time the next packet is (0 for closed-loop pacers).
+    virtual uint64_t schedule_lag_ns(uint64_t now_ns) const = 0;
 };
 
 /**
@@ -47,14 +55,24 @@ class client_send_pacer : public client_send_pacer_base {
      *
      * @param[in] pps The target packet rate in packets per second (0 = unlimited).
      */
-    explicit client_send_pacer(double pps)
+    explicit client_send_pacer(double pps) : client_send_pacer(pps, std::in_place) {}
+
+    /**
+     * @brief Construct a pacer whose congestion controller takes constructor arguments.
+     *
+     * @param[in] pps The target packet rate in packets per second (0 = unlimited).
+     * @param[in] cc_args Arguments forwarded to the congestion controller's constructor.
+     */
+    template <class... Args>
+    client_send_pacer(double pps, std::in_place_t, Args&&... cc_args)
         : rate_pps_(pps),
           unlimited_(pps == 0.0),
           // Allow a small burst window (fraction of a second) to tolerate
           // scheduling jitter. Default burst window = 0.005s (5 ms).
           capacity_((std::max)(1.0, pps * 0.005)),
           tokens_(0.0),
-          last_refill_ns_(now_ns()) {
+          last_refill_ns_(get_timestamp_ns()),
+          cc_(std::forward<Args>(cc_args)...) {
         // Initialize congestion controller with initial rate
         cc_.set_initial_rate(pps);
     }
@@ -62,15 +80,14 @@ class client_send_pacer : public client_send_pacer_base {
     ~client_send_pacer() override = default;
 
     /**
-     * @brief Query whether a packet can be sent now.
+     * @brief Query whether a packet can be sent at `now_ns`.
      *
-     * This method obtains the current steady-clock timestamp internally and
-     * checks the token bucket state.
+     * Refills the token bucket up to `now_ns` and checks it.
      *
      * @return true A packet may be sent immediately.
      * @return false A packet must be delayed to satisfy the rate.
      */
-    bool can_send() override {
+    bool can_send(uint64_t now_ns) override {
         if (unlimited_) return true;
         // Allow congestion controller to influence effective rate
         double target = cc_.target_rate_pps();
@@ -79,52 +96,48 @@ class client_send_pacer : public client_send_pacer_base {
             // recompute capacity when rate changes
             capacity_ = (std::max)(1.0, rate_pps_ * 0.005);
         }
-        uint64_t now = now_ns();
-        refill(now);
+        refill(now_ns);
         return tokens_ >= 1.0 - 1e-12;
     }
 
     /**
-     * @brief Record that a packet has been sent (uses current time internally).
+     * @brief Record that a packet was sent at `now_ns`.
      *
      * Decrements the token count; if called when tokens are unavailable, a
      * bounded negative debt is permitted to represent transient overshoot.
      */
-    void record_send(uint64_t seq) override {
+    void record_send(uint64_t now_ns, uint64_t seq) override {
         if (unlimited_) return;
-        uint64_t now = now_ns();
-        refill(now);
+        refill(now_ns);
         // consume one token; do not allow negative debt
         tokens_ = (std::max)(0.0, tokens_ - 1.0);
         // inform congestion controller about the send (caller-provided sequence)
-        cc_.on_send(now, seq);
+        cc_.on_send(now_ns, seq);
     }
 
     /**
      * @brief Perform periodic polling to update internal state.
      */
-    void poll() override {
+    void poll(uint64_t now_ns) override {
         if (unlimited_) return;
-        uint64_t now = now_ns();
-        refill(now);
-        cc_.on_poll(now);
+        refill(now_ns);
+        cc_.on_poll(now_ns);
     }
 
     /**
-     * @brief Get the relative wait time (ns) from now until a packet can be sent.
+     * @brief Get the relative wait time (ns) from `now_ns` until a packet can be sent.
      *
      * Returns 0 when a packet can be sent immediately. For limited rates this
      * returns the required delay in nanoseconds.
      *
      * @return uint64_t wait time in nanoseconds (0 == send now)
      */
-    uint64_t get_next_send_time_ns() const override {
+    uint64_t get_next_send_time_ns(uint64_t now_ns) const override {
         if (unlimited_) return 0;
-        uint64_t now = now_ns();
         // compute tokens as if we refilled now (without mutating state)
         double tokens_at_now = tokens_;
-        if (now > last_refill_ns_) {
-            double delta_s = static_cast<double>(now - last_refill_ns_) / 1e9;
+        if (now_ns > last_refill_ns_) {
+            double delta_s = static_cast<double>(now_ns - last_refill_ns_) / 1e9;
             tokens_at_now = (std::min)(capacity_, tokens_at_now + rate_pps_ * delta_s);
         }
         if (tokens_at_now >= 1.0) return 0;
@@ -140,11 +153,10 @@ class client_send_pacer : public client_send_pacer_base {
      * Use this to align pacer state to a synchronized start time so that
      * no tokens accumulate before measurement begins.
      */
-    void reset_to_now() override {
+    void reset_to_now(uint64_t now_ns) override {
         if (unlimited_) return;
-        uint64_t now = now_ns();
         tokens_ = 0.0;
-        last_refill_ns_ = now;
+        last_refill_ns_ = now_ns;
     }
 
     // Let caller pass RTT/ack info to congestion controller
@@ -153,14 +165,10 @@ class client_send_pacer : public client_send_pacer_base {
         cc_.on_ack(now_ns, seq, rtt_ns);
     }
     double get_target_rate_pps() const override { return cc_.target_rate_pps(); }
+    // The token bucket sends as soon as a token is available, so it never lags.
+    uint64_t schedule_lag_ns(uint64_t) const override { return 0; }
 
    private:
-    static uint64_t now_ns() {
-        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
-                                         std::chrono::steady_clock::now().time_since_epoch())
-                                         .count());
-    }
-
     void refill(uint64_t now_ns) {
         if (now_ns <= last_refill_ns_) return;
         double delta_s = static_cast<double>(now_ns - last_refill_ns_) / 1e9;
@@ -0,0 +1,122 @@
+/**
+ * @file packet_handler.hpp
+ * @brief Packet handler concept and the handlers shipped with the server.
+ *
+ * The IOCP worker is a template over its handler type, so the per-datagram
+ * call is resolved at compile time and inlined: there is no virtual dispatch
+ * per packet. A handler sees each received datagram (each segment, when URO
+ * coalesces several) in place and returns what to do with it.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "socket_utils.hpp"
+
+/**
+ * @brief What the worker should do with a handled datagram.
+ */
+struct handler_action {
+    enum class verdict { reply, drop, forward };
+
+    verdict kind{verdict::drop};
+    /// Bytes at the start of the datagram buffer to send (`reply` / `forward`).
+    size_t length{0};
+    /// Destination for `forward`; must stay valid until the worker posts the send.
+    const sockaddr* forward_addr{nullptr};
+    int forward_addr_len{0};
+
+    /// Send the first `n` bytes of the (possibly rewritten) datagram back to its sender.
+    static handler_action reply(size_t n) { return {verdict::reply, n, nullptr, 0}; }
+    /// Send nothing.
+    static handler_action drop() { return {}; }
+    /// Send the first `n` bytes to `addr` instead of the sender.
+    static handler_action forward(size_t n, const sockaddr* addr, int addr_len) {
+        return {verdict::forward, n, addr, addr_len};
+    }
+};
+
+/**
+ * @brief One received datagram as presented to a handler.
+ */
+struct datagram {
+    /// Datagram bytes; the handler may rewrite them in place.
+    char* data;
+    /// Bytes received.
+    size_t length;
+    /// Bytes at `data` the handler may use (>= `length`), so a reply may grow up to it.
+    size_t capacity;
+    /// Sender address.
+    const sockaddr* from;
+    int from_len;
+    /// Receive time on the `get_timestamp_ns` clock: the stack timestamp with
+    /// `--rx-timestamps`, otherwise when the worker dequeued the completion batch.
+    uint64_t rx_timestamp_ns;
+    /// True if `rx_timestamp_ns` is a stack timestamp.
+    bool stack_rx_timestamp;
+};
+
+/**
+ * @brief A per-datagram handler used by the server's IOCP worker.
+ *
+ * `handle(datagram&)` may rewrite the datagram in place and returns what to
+ * do with it. Each worker owns its handler instance, so handlers may keep
+ * state without synchronization.
+ *
+ * @tparam T The handler type to check.
+ */
+template <typename T>
+concept PacketHandlerConcept = std::default_initializable<T> && requires(T h, datagram& d) {
+    { h.handle(d) } -> std::same_as<handler_action>;
+};
+
+/**
+ * @brief Echo (RFC 862): reply with the datagram unchanged.
+ */
+struct echo_handler {
+    handler_action handle(datagram& d) { return handler_action::reply(d.length); }
+};
+
+/**
+ * @brief Discard (RFC 863): receive and count, never reply.
+ */
+struct discard_handler {
+    handler_action handle(datagram&) { return handler_action::drop(); }
+};
+
+/**
+ * @brief Reflector that stamps server timestamps into the datagram.
+ *
+ * A datagram carrying a `packet_header_ext` gets its server receive and send
+ * times filled in (the version negotiation of the extended header). Any
+ * other datagram long enough gets the receive time written into the 8 bytes
+ * that follow `packet_header`. Either way the result is echoed, so the
+ * measured cost includes touching the payload.
+ */
+struct timestamp_handler {
+    handler_action handle(datagram& d) {
+        if (d.length >= EXT_HEADER_SIZE) {
+            packet_header_ext ext;
+            std::memcpy(&ext, d.data, sizeof(ext));
+            if (ext.magic == PACKET_EXT_MAGIC && ext.version >= 1) {
+                ext.version = PACKET_EXT_VERSION;
+                ext.flags = d.stack_rx_timestamp ? PACKET_EXT_FLAG_STACK_RX_TIMESTAMP : 0;
+                ext.server_recv_ns = d.rx_timestamp_ns;
+                ext.server_send_ns = get_timestamp_ns();
+                std::memcpy(d.data, &ext, sizeof(ext));
+                return handler_action::reply(d.length);
+            }
+        }
+        if (d.length >= HEADER_SIZE + sizeof(uint64_t)) {
+            std::memcpy(d.data + HEADER_SIZE, &d.rx_timestamp_ns, sizeof(d.rx_timestamp_ns));
+        }
+        return handler_action::reply(d.length);
+    }
+};
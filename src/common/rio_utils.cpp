@@ -0,0 +1,85 @@
+/**
+ * @file rio_utils.cpp
+ * @brief Implementation of the Registered I/O (RIO) helpers.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "rio_utils.hpp"
+
+/**
+ * @brief Load the RIO extension function table via
+ * `SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER`.
+ *
+ * @param sock A socket created with `WSA_FLAG_REGISTERED_IO`.
+ * @throws socket_exception on failure.
+ * @return Populated function table.
+ */
+RIO_EXTENSION_FUNCTION_TABLE load_rio_function_table(const unique_socket& sock) {
+    GUID function_table_id = WSAID_MULTIPLE_RIO;
+    RIO_EXTENSION_FUNCTION_TABLE rio = {};
+    rio.cbSize = sizeof(rio);
+    DWORD bytes_returned = 0;
+
+    int result = WSAIoctl(sock.get(), SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER,
+                          &function_table_id, sizeof(function_table_id), &rio, sizeof(rio),
+                          &bytes_returned, nullptr, nullptr);
+    if (result == SOCKET_ERROR) {
+        throw socket_exception(
+            std::format("WSAIoctl (RIO function table) failed: {}", get_last_error_message()));
+    }
+    return rio;
+}
+
+/**
+ * @brief Allocate a page-aligned slab on `numa_node` and register it with RIO.
+ */
+rio_buffer_slab::rio_buffer_slab(const RIO_EXTENSION_FUNCTION_TABLE& rio, size_t size,
+                                 uint32_t numa_node)
+    : deregister_(rio.RIODeregisterBuffer), size_(size) {
+    base_ = static_cast<char*>(VirtualAllocExNuma(GetCurrentProcess(), nullptr, size_,
+                                                  MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE,
+                                                  numa_node));
+    if (base_ == nullptr) {
+        throw socket_exception(std::format("VirtualAllocExNuma ({} bytes, node {}) failed: {}",
+                                           size_, numa_node, get_last_error_message()));
+    }
+
+    id_ = rio.RIORegisterBuffer(base_, static_cast<DWORD>(size_));
+    if (id_ == RIO_INVALID_BUFFERID) {
+        std::string message =
+            std::format("RIORegisterBuffer ({} bytes) failed: {}", size_, get_last_error_message());
+        VirtualFree(base_, 0, MEM_RELEASE);
+        throw socket_exception(message);
+    }
+}
+
+/**
+ * @brief Deregister and free the slab.
+ */
+rio_buffer_slab::~rio_buffer_slab() {
+    if (id_ != RIO_INVALID_BUFFERID) deregister_(id_);
+    if (base_ != nullptr) VirtualFree(base_, 0, MEM_RELEASE);
+}
+
+/**
+ * @brief Create a RIO completion queue.
+ */
+rio_completion_queue::rio_completion_queue(const RIO_EXTENSION_FUNCTION_TABLE& rio,
+                                           DWORD queue_size,
+                                           RIO_NOTIFICATION_COMPLETION* notification)
+    : close_(rio.RIOCloseCompletionQueue) {
+    cq_ = rio.RIOCreateCompletionQueue(queue_size, notification);
+    if (cq_ == RIO_INVALID_CQ) {
+        throw socket_exception(
+            std::format("RIOCreateCompletionQueue failed: {}", get_last_error_message()));
+    }
+}
+
+/**
+ * @brief Close the completion queue.
+ */
+rio_completion_queue::~rio_completion_queue() {
+    if (cq_ != RIO_INVALID_CQ) close_(cq_);
+}
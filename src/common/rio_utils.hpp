@@ -0,0 +1,105 @@
+/**
+ * @file rio_utils.hpp
+ * @brief Registered I/O (RIO) helpers used by the server's RIO engine.
+ *
+ * Registered I/O replaces per-call buffer probing/locking and per-call
+ * kernel transitions with buffers that are registered once and request /
+ * completion queues that live in user space. This header wraps the small
+ * amount of boilerplate needed to load the RIO extension function table,
+ * register buffer slabs and own completion queues with RAII semantics.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "socket_utils.hpp"
+
+/**
+ * @brief Load the RIO extension function table through `sock`.
+ *
+ * The socket must have been created with `WSA_FLAG_REGISTERED_IO`.
+ *
+ * @throws socket_exception if the provider does not support RIO.
+ */
+RIO_EXTENSION_FUNCTION_TABLE load_rio_function_table(const unique_socket& sock);
+
+/**
+ * @brief A page-aligned memory slab registered with RIO.
+ *
+ * The slab is allocated with `VirtualAllocExNuma` and registered as a single
+ * `RIO_BUFFERID`; callers carve it into fixed-size slots addressed by
+ * offset. Deregistration and release happen on destruction.
+ */
+class rio_buffer_slab {
+   public:
+    /**
+     * @brief Allocate and register a slab of at least `size` bytes.
+     *
+     * @param rio Loaded RIO function table.
+     * @param size Requested slab size in bytes.
+     * @param numa_node NUMA node to allocate from; defaults to the node of the
+     *                  calling thread's current processor.
+     * @throws socket_exception on allocation or registration failure.
+     */
+    rio_buffer_slab(const RIO_EXTENSION_FUNCTION_TABLE& rio, size_t size,
+                    uint32_t numa_node = get_current_numa_node());
+    ~rio_buffer_slab();
+
+    rio_buffer_slab(const rio_buffer_slab&) = delete;
+    rio_buffer_slab& operator=(const rio_buffer_slab&) = delete;
+
+    /// Base address of the slab.
+    char* data() const { return base_; }
+    /// Size of the slab in bytes.
+    size_t size() const { return size_; }
+    /// Registered buffer id used in `RIO_BUF` descriptors.
+    RIO_BUFFERID id() const { return id_; }
+
+    /**
+     * @brief Build a `RIO_BUF` describing `length` bytes at `offset`.
+     */
+    RIO_BUF slice(size_t offset, size_t length) const {
+        RIO_BUF buf = {};
+        buf.BufferId = id_;
+        buf.Offset = static_cast<ULONG>(offset);
+        buf.Length = static_cast<ULONG>(length);
+        return buf;
+    }
+
+   private:
+    LPFN_RIODEREGISTERBUFFER deregister_;
+    char* base_{nullptr};
+    size_t size_{0};
+    RIO_BUFFERID id_{RIO_INVALID_BUFFERID};
+};
+
+/**
+ * @brief RAII owner for a RIO completion queue.
+ */
+class rio_completion_queue {
+   public:
+    /**
+     * @brief Create a completion queue with room for `queue_size` results.
+     *
+     * @param rio Loaded RIO function table.
+     * @param queue_size Number of completion entries.
+     * @param notification Optional IOCP/event notification; `nullptr` for a
+     *                     polled queue.
+     * @throws socket_exception on failure.
+     */
+    rio_completion_queue(const RIO_EXTENSION_FUNCTION_TABLE& rio, DWORD queue_size,
+                         RIO_NOTIFICATION_COMPLETION* notification);
+    ~rio_completion_queue();
+
+    rio_completion_queue(const rio_completion_queue&) = delete;
+    rio_completion_queue& operator=(const rio_completion_queue&) = delete;
+
+    /// Underlying completion queue handle.
+    RIO_CQ get() const { return cq_; }
+
+   private:
+    LPFN_RIOCLOSECOMPLETIONQUEUE close_;
+    RIO_CQ cq_{RIO_INVALID_CQ};
+};
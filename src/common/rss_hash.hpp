@@ -0,0 +1,246 @@
+/**
+ * @file rss_hash.hpp
+ * @brief Toeplitz RSS hash and indirection table model for choosing client source ports.
+ *
+ * The server shards by RSS: the NIC hashes each datagram's addresses and
+ * ports with the Toeplitz function, indexes its indirection table with the
+ * low bits of the hash and delivers the datagram on that queue's processor,
+ * where the server's socket with the matching `SIO_CPU_AFFINITY` receives
+ * it. Ephemeral source ports leave this to chance, and with a handful of
+ * flows some shards end up with two or three times the load of others. The
+ * client (`--rss-queues`) instead evaluates the same hash for candidate
+ * source ports and binds each socket to a port that lands on the queue it
+ * was assigned.
+ *
+ * The input layout is the one Windows RSS uses for UDP over IPv4/IPv6
+ * (`NDIS_HASH_UDP_IPV4` / `NDIS_HASH_UDP_IPV6`): source address,
+ * destination address, source port, destination port, all in network byte
+ * order, seen from the receiving (server) side.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "socket_utils.hpp"
+
+/// The default RSS secret key from the Microsoft RSS specification, which most NICs ship with.
+constexpr std::array<uint8_t, 40> DEFAULT_RSS_KEY = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3,
+    0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3,
+    0x80, 0x30, 0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa};
+
+/// Indirection table size used when none is given (the usual Windows table size).
+constexpr size_t DEFAULT_RSS_TABLE_SIZE = 128;
+
+/**
+ * @brief Toeplitz hash of `input` under `key`.
+ *
+ * For every set bit of the input (most significant bit first), XOR in the
+ * 32-bit window of the key that starts at that bit position. The key must
+ * be at least four bytes longer than the input.
+ */
+inline uint32_t toeplitz_hash(std::span<const uint8_t> key, std::span<const uint8_t> input) {
+    uint32_t result = 0;
+    // `window` holds key bits [i, i + 32) for the current input bit i.
+    uint32_t window = (static_cast<uint32_t>(key[0]) << 24) |
+                      (static_cast<uint32_t>(key[1]) << 16) |
+                      (static_cast<uint32_t>(key[2]) << 8) | key[3];
+    for (size_t byte = 0; byte < input.size(); ++byte) {
+        const uint8_t next_key_byte = byte + 4 < key.size() ? key[byte + 4] : 0;
+        for (int bit = 7; bit >= 0; --bit) {
+            if (input[byte] & (1u << bit)) result ^= window;
+            window = (window << 1) | ((next_key_byte >> bit) & 1u);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief The server's RSS configuration as far as the client needs to model it.
+ */
+struct rss_model {
+    /// Toeplitz secret key.
+    std::vector<uint8_t> key{DEFAULT_RSS_KEY.begin(), DEFAULT_RSS_KEY.end()};
+    /// Queue for each low-bits hash value; the size must be a power of two.
+    std::vector<uint32_t> indirection_table;
+
+    /**
+     * @brief Flat table of `table_size` entries over `queues` queues (entry i -> i % queues).
+     */
+    static std::vector<uint32_t> round_robin_table(uint32_t queues,
+                                                   size_t table_size = DEFAULT_RSS_TABLE_SIZE) {
+        std::vector<uint32_t> table(table_size);
+        for (size_t i = 0; i < table_size; ++i) table[i] = static_cast<uint32_t>(i % queues);
+        return table;
+    }
+
+    /// Number of queues the table refers to (highest entry + 1).
+    uint32_t queue_count() const {
+        uint32_t highest = 0;
+        for (uint32_t queue : indirection_table) highest = (std::max)(highest, queue);
+        return indirection_table.empty() ? 0 : highest + 1;
+    }
+
+    /**
+     * @brief Hash of the UDP 4-tuple `source` -> `destination` (ports included).
+     *
+     * @throws std::invalid_argument if the families differ or are not IPv4/IPv6.
+     */
+    uint32_t hash(const sockaddr_storage& source, const sockaddr_storage& destination) const {
+        std::array<uint8_t, 36> input = {};
+        size_t length = 0;
+        auto append = [&](const void* bytes, size_t n) {
+            std::memcpy(input.data() + length, bytes, n);
+            length += n;
+        };
+        if (source.ss_family != destination.ss_family) {
+            throw std::invalid_argument("RSS hash needs source and destination of one family");
+        }
+        if (source.ss_family == AF_INET) {
+            const auto& src = reinterpret_cast<const sockaddr_in&>(source);
+            const auto& dst = reinterpret_cast<const sockaddr_in&>(destination);
+            append(&src.sin_addr, 4);
+            append(&dst.sin_addr, 4);
+            append(&src.sin_port, 2);
+            append(&dst.sin_port, 2);
+        } else if (source.ss_family == AF_INET6) {
+            const auto& src = reinterpret_cast<const sockaddr_in6&>(source);
+            const auto& dst = reinterpret_cast<const sockaddr_in6&>(destination);
+            append(&src.sin6_addr, 16);
+            append(&dst.sin6_addr, 16);
+            append(&src.sin6_port, 2);
+            append(&dst.sin6_port, 2);
+        } else {
+            throw std::invalid_argument("RSS hash supports IPv4 and IPv6 only");
+        }
+        return toeplitz_hash(key, std::span<const uint8_t>(input.data(), length));
+    }
+
+    /// Queue the NIC delivers `source` -> `destination` on.
+    uint32_t queue(const sockaddr_storage& source, const sockaddr_storage& destination) const {
+        const uint32_t h = hash(source, destination);
+        return indirection_table[h & static_cast<uint32_t>(indirection_table.size() - 1)];
+    }
+};
+
+/**
+ * @brief Parse an RSS key given as hex bytes, optionally separated by ':', '-' or ','.
+ *
+ * @throws std::invalid_argument if the text is not whole hex bytes or the key
+ *         is too short to hash an IPv6 4-tuple (40 bytes).
+ */
+inline std::vector<uint8_t> parse_rss_key(const std::string& text) {
+    std::string digits;
+    for (char c : text) {
+        if (c == ':' || c == '-' || c == ',' || c == ' ') continue;
+        if (!std::isxdigit(static_cast<unsigned char>(c))) {
+            throw std::invalid_argument(std::format("Invalid RSS key character '{}'", c));
+        }
+        digits.push_back(c);
+    }
+    if (digits.size() % 2 != 0) throw std::invalid_argument("RSS key has an odd number of digits");
+    std::vector<uint8_t> key;
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        key.push_back(
+            static_cast<uint8_t>(std::strtoul(digits.substr(i, 2).c_str(), nullptr, 16)));
+    }
+    if (key.size() < DEFAULT_RSS_KEY.size()) {
+        throw std::invalid_argument(
+            std::format("RSS key must be at least {} bytes", DEFAULT_RSS_KEY.size()));
+    }
+    return key;
+}
+
+/**
+ * @brief Parse an indirection table given as comma-separated queue numbers.
+ *
+ * @throws std::invalid_argument if an entry is malformed or the entry count
+ *         is not a power of two.
+ */
+inline std::vector<uint32_t> parse_rss_table(const std::string& text) {
+    std::vector<uint32_t> table;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end = nullptr;
+        const unsigned long queue = std::strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0') {
+            throw std::invalid_argument(std::format("Invalid RSS table entry '{}'", item));
+        }
+        table.push_back(static_cast<uint32_t>(queue));
+    }
+    if (table.empty() || (table.size() & (table.size() - 1)) != 0) {
+        throw std::invalid_argument("RSS table size must be a power of two");
+    }
+    return table;
+}
+
+/**
+ * @brief Hands out source ports whose 4-tuple lands on a requested RSS queue.
+ *
+ * Ports are searched upwards through the dynamic range (49152-65535), with a
+ * separate cursor per queue so no port is offered twice. Not thread-safe.
+ */
+class rss_port_selector {
+   public:
+    static constexpr uint16_t FIRST_PORT = 49152;
+    static constexpr uint16_t LAST_PORT = 65535;
+
+    /**
+     * @param model The server's RSS key and indirection table.
+     * @param local Client source address (the port is ignored).
+     * @param server Server address and port.
+     */
+    rss_port_selector(const rss_model& model, const sockaddr_storage& local,
+                      const sockaddr_storage& server)
+        : model_(&model),
+          local_(local),
+          server_(server),
+          cursors_(model.queue_count(), FIRST_PORT) {}
+
+    /**
+     * @brief Next unoffered port that maps to `queue`.
+     *
+     * @return The port in host byte order, or 0 once the range is exhausted.
+     */
+    uint16_t next(uint32_t queue) {
+        if (queue >= cursors_.size()) return 0;
+        uint32_t& cursor = cursors_[queue];
+        for (; cursor <= LAST_PORT; ++cursor) {
+            set_port(local_, static_cast<uint16_t>(cursor));
+            if (model_->queue(local_, server_) == queue) {
+                return static_cast<uint16_t>(cursor++);
+            }
+        }
+        return 0;
+    }
+
+   private:
+    static void set_port(sockaddr_storage& addr, uint16_t port) {
+        if (addr.ss_family == AF_INET6) {
+            reinterpret_cast<sockaddr_in6&>(addr).sin6_port = htons(port);
+        } else {
+            reinterpret_cast<sockaddr_in&>(addr).sin_port = htons(port);
+        }
+    }
+
+    const rss_model* model_;
+    sockaddr_storage local_;
+    sockaddr_storage server_;
+    std::vector<uint32_t> cursors_;
+};
@@ -0,0 +1,173 @@
+/**
+ * @file sequence_window.hpp
+ * @brief Fixed-size ring tracking the fate of every sequence number a worker sends.
+ *
+ * Sequence numbers are assigned monotonically per worker, so the most recent
+ * `capacity` of them map onto a power-of-two ring by `sequence & mask` with no
+ * hashing and no allocation after construction. Each slot records the send
+ * time and whether the sequence is outstanding, echoed or declared lost. That
+ * lets an echo be classified as in order, reordered, duplicate or late
+ * (arriving after its loss timeout), and lets loss be declared as soon as a
+ * sequence's timeout passes instead of only at shutdown.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Classification of a received echo.
+ */
+enum class echo_kind {
+    /// First echo of a sequence newer than every sequence echoed so far.
+    in_order,
+    /// First echo of a sequence older than one already echoed.
+    reordered,
+    /// Sequence was already echoed.
+    duplicate,
+    /// Sequence had already been declared lost (or has left the window).
+    late,
+    /// Sequence was never sent by this worker.
+    unknown,
+};
+
+/**
+ * @brief Ring of per-sequence send state for one worker.
+ * @note Not thread-safe; owned by a single worker thread.
+ */
+class sequence_window {
+   public:
+    /**
+     * @brief Construct a window.
+     *
+     * @param capacity Number of most recent sequences tracked (rounded up to a power of two).
+     * @param timeout_ns Time after which an unechoed sequence is declared lost.
+     */
+    sequence_window(size_t capacity, uint64_t timeout_ns)
+        : capacity_(std::bit_ceil((std::max)(capacity, size_t{2}))),
+          mask_(capacity_ - 1),
+          timeout_ns_(timeout_ns),
+          send_ns_(capacity_, 0),
+          state_(capacity_, slot_state::empty) {}
+
+    /// Number of sequences tracked by the ring.
+    size_t capacity() const { return capacity_; }
+    /// Sequences sent and neither echoed nor declared lost.
+    uint64_t outstanding() const { return outstanding_; }
+
+    /**
+     * @brief Record the send of `sequence`, which must be the next sequence number.
+     *
+     * @return Number of sequences declared lost because the window overflowed (0 or 1).
+     */
+    uint64_t on_send(uint64_t sequence, uint64_t now_ns) {
+        uint64_t lost = 0;
+        // The slot about to be reused belongs to `sequence - capacity_`; if it
+        // is still outstanding the window is full and it is declared lost.
+        if (next_ - oldest_ == capacity_) {
+            lost = retire_oldest();
+        }
+        const size_t index = static_cast<size_t>(sequence & mask_);
+        send_ns_[index] = now_ns;
+        state_[index] = slot_state::outstanding;
+        next_ = sequence + 1;
+        ++outstanding_;
+        return lost;
+    }
+
+    /**
+     * @brief Classify an echo of `sequence` and mark it echoed.
+     */
+    echo_kind on_echo(uint64_t sequence) {
+        if (sequence >= next_) return echo_kind::unknown;
+        if (next_ - sequence > capacity_) return echo_kind::late;
+
+        const size_t index = static_cast<size_t>(sequence & mask_);
+        switch (state_[index]) {
+            case slot_state::outstanding: {
+                state_[index] = slot_state::echoed;
+                --outstanding_;
+                const bool reordered = any_echoed_ && sequence < highest_echoed_;
+                if (!any_echoed_ || sequence > highest_echoed_) highest_echoed_ = sequence;
+                any_echoed_ = true;
+                return reordered ? echo_kind::reordered : echo_kind::in_order;
+            }
+            case slot_state::lost:
+                // Remember the echo so a repeat is reported as a duplicate.
+                state_[index] = slot_state::echoed;
+                return echo_kind::late;
+            case slot_state::echoed:
+                return echo_kind::duplicate;
+            default:
+                return echo_kind::unknown;
+        }
+    }
+
+    /**
+     * @brief Declare lost every outstanding sequence sent more than the timeout ago.
+     *
+     * Amortised O(1): the scan resumes from the oldest unresolved sequence and
+     * stops at the first one still within its timeout.
+     *
+     * @return Number of sequences newly declared lost.
+     */
+    uint64_t expire(uint64_t now_ns) {
+        uint64_t lost = 0;
+        while (oldest_ < next_) {
+            const size_t index = static_cast<size_t>(oldest_ & mask_);
+            if (state_[index] == slot_state::outstanding &&
+                now_ns - send_ns_[index] < timeout_ns_) {
+                break;
+            }
+            lost += retire_oldest();
+        }
+        return lost;
+    }
+
+    /**
+     * @brief Declare every outstanding sequence lost (e.g. at shutdown).
+     *
+     * @return Number of sequences declared lost.
+     */
+    uint64_t expire_all() {
+        uint64_t lost = 0;
+        while (oldest_ < next_) lost += retire_oldest();
+        return lost;
+    }
+
+   private:
+    enum class slot_state : uint8_t { empty, outstanding, echoed, lost };
+
+    /// Advance past the oldest unresolved sequence, declaring it lost if still outstanding.
+    uint64_t retire_oldest() {
+        const size_t index = static_cast<size_t>(oldest_ & mask_);
+        ++oldest_;
+        if (state_[index] == slot_state::outstanding) {
+            state_[index] = slot_state::lost;
+            --outstanding_;
+            return 1;
+        }
+        return 0;
+    }
+
+    size_t capacity_;
+    uint64_t mask_;
+    uint64_t timeout_ns_;
+    std::vector<uint64_t> send_ns_;
+    std::vector<slot_state> state_;
+
+    /// One past the most recently sent sequence.
+    uint64_t next_{0};
+    /// Oldest sequence not yet resolved (echoed or lost) by `expire`.
+    uint64_t oldest_{0};
+    uint64_t outstanding_{0};
+    uint64_t highest_echoed_{0};
+    bool any_echoed_{false};
+};
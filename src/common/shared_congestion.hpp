@@ -0,0 +1,188 @@
+/**
+ * @file shared_congestion.hpp
+ * @brief Aggregate congestion state that re-splits the client's total rate across workers.
+ *
+ * Without it every worker paces an even `--rate / workers` share and its
+ * controller estimates the path on its own, so a worker whose shard is hot
+ * keeps losing packets while the others leave rate unused. With `--cc-shared`
+ * each worker's controller is wrapped in `shared_congestion_controller`,
+ * which publishes the worker's delivered count to its own cache line of a
+ * `shared_rate_state` and caps the worker at the share allotted there. Once
+ * a second the main thread rebalances: workers whose echoes keep up with
+ * their share split whatever the lagging ones cannot use, and a worker that
+ * recovers wins its share back over a few seconds. Workers only ever
+ * touch their own slot with relaxed loads and stores, so the per-packet
+ * paths stay lock-free.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "congestion_controller.hpp"
+#include "counters.hpp"
+#include "null_cc.hpp"
+#include "socket_utils.hpp"
+
+/**
+ * @brief Per-worker delivered counts and rate allotments for one run.
+ */
+class shared_rate_state {
+   public:
+    /// A worker delivering at least this fraction of its share is keeping up.
+    static constexpr double KEEP_UP_FRACTION = 0.9;
+    /// A lagging worker is allotted this much more than it delivered, so it can recover.
+    static constexpr double LAGGING_HEADROOM = 1.1;
+    /// A worker below an even split that keeps up is weighted this much higher, so a
+    /// recovered worker wins back its share over a few rebalances.
+    static constexpr double PROBE_GAIN = 1.1;
+    /// No worker's share drops below this fraction of an even split.
+    static constexpr double MIN_SHARE_FRACTION = 0.1;
+
+    /**
+     * @param total_rate_pps The run's total rate (`--rate`), split evenly to start.
+     * @param worker_count Number of workers sharing it.
+     */
+    shared_rate_state(double total_rate_pps, size_t worker_count)
+        : total_rate_pps_(total_rate_pps), slots_(worker_count) {
+        for (auto& slot : slots_) slot.allotted_pps.store(even_share());
+    }
+
+    shared_rate_state(const shared_rate_state&) = delete;
+    shared_rate_state& operator=(const shared_rate_state&) = delete;
+
+    double total_rate_pps() const { return total_rate_pps_; }
+
+    /// Publish a worker's running delivered count (that worker only).
+    void publish(size_t worker, uint64_t delivered) { slots_[worker].delivered.store(delivered); }
+
+    /// A worker's current share in packets per second.
+    double allotted_pps(size_t worker) const {
+        return slots_[worker].allotted_pps.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Re-split the total rate from what each worker delivered since the last call.
+     *
+     * Call from one thread only (the client's main loop), about once a second.
+     *
+     * @param elapsed_s Seconds since the previous call.
+     */
+    void rebalance(double elapsed_s) {
+        if (elapsed_s <= 0.0 || slots_.empty()) return;
+        const double floor_pps = MIN_SHARE_FRACTION * even_share();
+
+        // Lagging workers keep a little more than they managed; the rest is spare.
+        double spare_pps = total_rate_pps_;
+        double keeping_up_weight = 0.0;
+        for (auto& slot : slots_) {
+            const uint64_t delivered = slot.delivered.load();
+            const double delivered_pps =
+                static_cast<double>(delivered - slot.last_delivered) / elapsed_s;
+            slot.last_delivered = delivered;
+            const double allotted = slot.allotted_pps.load(std::memory_order_relaxed);
+            slot.keeping_up = delivered_pps >= KEEP_UP_FRACTION * allotted;
+            if (slot.keeping_up) {
+                slot.weight = allotted < even_share()
+                                  ? (std::min)(allotted * PROBE_GAIN, even_share())
+                                  : allotted;
+                keeping_up_weight += slot.weight;
+            } else {
+                slot.next_pps =
+                    (std::max)(floor_pps, (std::min)(delivered_pps * LAGGING_HEADROOM, allotted));
+                spare_pps -= slot.next_pps;
+            }
+        }
+        // Nobody keeps up: the path, not the split, is the limit, so leave it alone.
+        if (keeping_up_weight == 0.0) return;
+        spare_pps = (std::max)(spare_pps, 0.0);
+
+        // Workers that keep up split the spare in proportion to their weights.
+        for (auto& slot : slots_) {
+            if (slot.keeping_up) slot.next_pps = spare_pps * slot.weight / keeping_up_weight;
+            slot.allotted_pps.store(slot.next_pps, std::memory_order_relaxed);
+        }
+    }
+
+   private:
+    double even_share() const { return total_rate_pps_ / static_cast<double>(slots_.size()); }
+
+    /// One worker's state, on its own cache line so workers never share one.
+    struct alignas(CACHE_LINE_SIZE) slot {
+        /// Echoes delivered so far (written by the worker).
+        single_writer_counter delivered{0};
+        /// Share in packets per second (written by `rebalance`).
+        std::atomic<double> allotted_pps{0.0};
+        /// `rebalance` bookkeeping.
+        uint64_t last_delivered{0};
+        double next_pps{0.0};
+        double weight{0.0};
+        bool keeping_up{false};
+    };
+
+    double total_rate_pps_;
+    std::vector<slot> slots_;
+};
+
+/**
+ * @brief Congestion controller wrapper that shares state through a `shared_rate_state`.
+ *
+ * The wrapped controller still estimates the path from this worker's sends
+ * and ACKs; its target is capped by the worker's allotted share. The wrapped
+ * controller's own ceiling is the whole run's rate so it never caps a share
+ * that has grown past the even split.
+ *
+ * @tparam Inner The worker's own controller.
+ */
+template <CongestionControllerConcept Inner>
+class shared_congestion_controller {
+   public:
+    /// Publish the delivered count at most this often.
+    static constexpr uint64_t PUBLISH_INTERVAL_NS = 10'000'000ULL;  // 10ms
+
+    shared_congestion_controller(shared_rate_state& state, size_t worker)
+        : state_(&state), worker_(worker) {}
+
+    void set_initial_rate(double) { inner_.set_initial_rate(state_->total_rate_pps()); }
+
+    void on_send(uint64_t now_ns, uint64_t seq) { inner_.on_send(now_ns, seq); }
+
+    void on_ack(uint64_t now_ns, uint64_t seq, uint64_t rtt_ns) {
+        ++delivered_;
+        inner_.on_ack(now_ns, seq, rtt_ns);
+    }
+
+    void on_poll(uint64_t now_ns) {
+        inner_.on_poll(now_ns);
+        if (now_ns - last_publish_ns_ >= PUBLISH_INTERVAL_NS) {
+            state_->publish(worker_, delivered_);
+            last_publish_ns_ = now_ns;
+        }
+    }
+
+    /// The wrapped controller's target capped by this worker's share (the share alone if the
+    /// wrapped controller gives no guidance).
+    double target_rate_pps() const {
+        const double allotted = state_->allotted_pps(worker_);
+        const double inner = inner_.target_rate_pps();
+        return inner > 0.0 ? (std::min)(inner, allotted) : allotted;
+    }
+
+   private:
+    Inner inner_;
+    shared_rate_state* state_;
+    size_t worker_;
+    uint64_t delivered_{0};
+    uint64_t last_publish_ns_{0};
+};
+
+static_assert(CongestionControllerConcept<shared_congestion_controller<null_congestion_controller>>,
+              "shared_congestion_controller does not meet "
+              "CongestionControllerConcept requirements");
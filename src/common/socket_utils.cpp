@@ -21,6 +21,14 @@
 #define SIO_CPU_AFFINITY _WSAIOW(IOC_VENDOR, 21)
 #endif
 
+// Socket timestamping (Windows 10 2004+) may not be defined in older SDKs
+#ifndef SIO_TIMESTAMPING
+#define SIO_TIMESTAMPING _WSAIOW(IOC_VENDOR, 235)
+#endif
+#ifndef SO_TIMESTAMP
+#define SO_TIMESTAMP 0x300A
+#endif
+
 /**
  * @brief Initialize the Winsock library (WSAStartup).
  *
@@ -46,15 +54,16 @@ void cleanup_winsock() {
  *
  * @param family Address family (AF_INET or AF_INET6). If an unsupported
  *               family is passed, AF_INET will be used.
+ * @param extra_flags Additional `WSASocket` flags OR-ed with `WSA_FLAG_OVERLAPPED`.
  * @throws socket_exception on failure to create the socket.
  * @return RAII `unique_socket` owning the created SOCKET.
  */
-unique_socket create_udp_socket(int family) {
+unique_socket create_udp_socket(int family, DWORD extra_flags) {
     int af = family;
     if (af != AF_INET && af != AF_INET6) {
         af = AF_INET;
     }
-    DWORD flags = WSA_FLAG_OVERLAPPED;
+    DWORD flags = WSA_FLAG_OVERLAPPED | extra_flags;
     SOCKET raw = WSASocketW(af, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, flags);
     if (raw == INVALID_SOCKET) {
         throw socket_exception(std::format("WSASocket failed: {}", get_last_error_message()));
@@ -66,7 +75,8 @@ unique_socket create_udp_socket(int family) {
  * @brief Set CPU affinity for a socket using SIO_CPU_AFFINITY.
  *
  * @param sock Socket to configure.
- * @param processor_id Logical processor index to bind the socket to.
+ * @param processor_id Global logical processor index (groups numbered in order)
+ *                     to bind the socket to.
  * @throws socket_exception on failure.
  */
 void set_socket_cpu_affinity(const unique_socket& sock, uint16_t processor_id) {
@@ -149,9 +159,9 @@ unique_iocp create_iocp() {
 }
 
 /**
- * @brief Pin the current thread to the given logical processor (group 0).
+ * @brief Pin the current thread to the given logical processor.
  *
- * @param processor_id Logical processor index within group 0.
+ * @param processor_id Global logical processor index (groups numbered in order).
  * @throws socket_exception if the processor id is out of range or setting
  *                          the group affinity fails.
  */
@@ -187,7 +197,7 @@ void set_thread_affinity(uint32_t processor_id) {
     if (!found) {
         throw socket_exception(
             std::format("Processor ID {} is out of range ({} logical processors)", processor_id,
-                        processor_id + 1u));
+                        processor_id - remaining));
     }
 
     GROUP_AFFINITY affinity = {};
@@ -203,12 +213,26 @@ void set_thread_affinity(uint32_t processor_id) {
 /**
  * @brief Return the number of logical processors available to the system.
  *
+ * Counts every processor group; `GetSystemInfo` only reports the calling
+ * thread's group, which caps hosts with more than 64 processors.
+ *
  * @return Number of logical processors.
  */
-uint32_t get_processor_count() {
-    SYSTEM_INFO sys_info;
-    GetSystemInfo(&sys_info);
-    return sys_info.dwNumberOfProcessors;
+uint32_t get_processor_count() { return GetActiveProcessorCount(ALL_PROCESSOR_GROUPS); }
+
+/**
+ * @brief Return the NUMA node of the current processor.
+ *
+ * @return NUMA node number, or 0 if the node cannot be determined.
+ */
+uint32_t get_current_numa_node() {
+    PROCESSOR_NUMBER processor = {};
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node = 0;
+    if (!GetNumaProcessorNodeEx(&processor, &node)) {
+        return 0;
+    }
+    return node;
 }
 
 /**
@@ -261,15 +285,51 @@ void set_socket_option(const unique_socket& sock, int level, int optname, const
 }
 
 /**
- * @brief Post an asynchronous receive (WSARecvFrom) for `sock` using `ctx`.
+ * @brief Resolve the WSARecvMsg extension function via `sock`.
+ *
+ * The pointer is provider-wide, so it is resolved once and cached.
  *
- * On failure other than `WSA_IO_PENDING` the error is logged to `std::cerr`.
+ * @throws socket_exception if the extension cannot be loaded.
  */
-void post_recv(const unique_socket& sock, io_context* ctx) {
+static LPFN_WSARECVMSG get_wsa_recv_msg(const unique_socket& sock) {
+    static LPFN_WSARECVMSG wsa_recv_msg = nullptr;
+    static std::once_flag once;
+    std::call_once(once, [&]() {
+        GUID guid = WSAID_WSARECVMSG;
+        DWORD bytes_returned = 0;
+        if (WSAIoctl(sock.get(), SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid),
+                     &wsa_recv_msg, sizeof(wsa_recv_msg), &bytes_returned, nullptr,
+                     nullptr) == SOCKET_ERROR) {
+            wsa_recv_msg = nullptr;
+        }
+    });
+    if (wsa_recv_msg == nullptr) {
+        throw socket_exception(
+            std::format("WSAIoctl (WSARecvMsg) failed: {}", get_last_error_message()));
+    }
+    return wsa_recv_msg;
+}
+
+/**
+ * @brief Post an asynchronous receive (WSARecvMsg) for `sock` using `ctx`.
+ *
+ * On failure other than `WSA_IO_PENDING` the error is logged to `std::cerr`
+ * and returned so callers can account for the lost receive.
+ */
+int post_recv(const unique_socket& sock, io_context* ctx) {
+    LPFN_WSARECVMSG wsa_recv_msg = get_wsa_recv_msg(sock);
+
     ctx->operation = io_operation_type::recv;
     ctx->wsa_buf.buf = ctx->buffer.data();
     ctx->wsa_buf.len = static_cast<ULONG>(ctx->buffer.size());
-    ctx->remote_addr_len = sizeof(ctx->remote_addr);
+
+    ctx->msg.name = reinterpret_cast<sockaddr*>(&ctx->remote_addr);
+    ctx->msg.namelen = sizeof(ctx->remote_addr);
+    ctx->msg.lpBuffers = &ctx->wsa_buf;
+    ctx->msg.dwBufferCount = 1;
+    ctx->msg.Control.buf = ctx->control;
+    ctx->msg.Control.len = sizeof(ctx->control);
+    ctx->msg.dwFlags = 0;
 
     // Reset OVERLAPPED structure
     ctx->Internal = 0;
@@ -277,21 +337,80 @@ void post_recv(const unique_socket& sock, io_context* ctx) {
     ctx->Offset = 0;
     ctx->OffsetHigh = 0;
 
-    DWORD flags = 0;
     DWORD bytes_received = 0;
 
-    int result = WSARecvFrom(sock.get(), &ctx->wsa_buf, 1, &bytes_received, &flags,
-                             reinterpret_cast<sockaddr*>(&ctx->remote_addr), &ctx->remote_addr_len,
-                             ctx, nullptr);
+    int result = wsa_recv_msg(sock.get(), &ctx->msg, &bytes_received, ctx, nullptr);
 
     if (result == SOCKET_ERROR) {
         int error = WSAGetLastError();
         // Ignore WSAECONNRESET which can happen with UDP when no one is listening
         if (error != WSA_IO_PENDING && error != WSAECONNRESET) {
-            std::cerr << std::format("WSARecvFrom failed: {} ({})\n", get_last_error_message(),
+            std::cerr << std::format("WSARecvMsg failed: {} ({})\n", get_last_error_message(),
                                      error);
+            return error;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Enable URO by setting `UDP_RECV_MAX_COALESCED_SIZE` on `sock`.
+ *
+ * @return false if the option is rejected (unsupported OS/NIC), true otherwise.
+ */
+bool enable_udp_recv_coalescing(const unique_socket& sock, DWORD max_coalesced_size) {
+    return setsockopt(sock.get(), IPPROTO_UDP, UDP_RECV_MAX_COALESCED_SIZE,
+                      reinterpret_cast<const char*>(&max_coalesced_size),
+                      sizeof(max_coalesced_size)) == 0;
+}
+
+/**
+ * @brief Walk the control data of a completed receive looking for `UDP_COALESCED_INFO`.
+ */
+DWORD get_coalesced_segment_size(const io_context* ctx) {
+    WSAMSG msg = ctx->msg;
+    for (WSACMSGHDR* cmsg = WSA_CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = WSA_CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_COALESCED_INFO) {
+            DWORD segment_size = 0;
+            std::memcpy(&segment_size, WSA_CMSG_DATA(cmsg), sizeof(segment_size));
+            return segment_size;
         }
     }
+    return 0;
+}
+
+/**
+ * @brief Enable software receive timestamps via `SIO_TIMESTAMPING`.
+ */
+bool enable_rx_timestamps(const unique_socket& sock) {
+    // Layout of TIMESTAMPING_CONFIG; TIMESTAMPING_FLAG_RX = 0x1.
+    struct {
+        ULONG flags;
+        USHORT tx_timestamps_buffered;
+    } config = {0x1, 0};
+    DWORD bytes_returned = 0;
+    return WSAIoctl(sock.get(), SIO_TIMESTAMPING, &config, sizeof(config), nullptr, 0,
+                    &bytes_returned, nullptr, nullptr) == 0;
+}
+
+/**
+ * @brief Walk the control data of a completed receive looking for `SO_TIMESTAMP`.
+ *
+ * Software timestamps are QueryPerformanceCounter ticks, so they convert to
+ * the same clock as `get_timestamp_ns`.
+ */
+uint64_t get_rx_timestamp_ns(const io_context* ctx) {
+    WSAMSG msg = ctx->msg;
+    for (WSACMSGHDR* cmsg = WSA_CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = WSA_CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP) {
+            uint64_t ticks = 0;
+            std::memcpy(&ticks, WSA_CMSG_DATA(cmsg), sizeof(ticks));
+            return ticks == 0 ? 0 : qpc_ticks_to_ns(ticks);
+        }
+    }
+    return 0;
 }
 
 /**
@@ -307,13 +426,31 @@ void post_recv(const unique_socket& sock, io_context* ctx) {
  */
 void post_send(const unique_socket& sock, io_context* ctx, const char* data, size_t len,
                const sockaddr* dest_addr, int dest_addr_len) {
-    ctx->operation = io_operation_type::send;
-
     // Copy data to buffer
     if (len > ctx->buffer.size()) {
         len = ctx->buffer.size();
     }
     std::memcpy(ctx->buffer.data(), data, len);
+    post_send_in_place(sock, ctx, len, dest_addr, dest_addr_len);
+}
+
+/**
+ * @brief Post an asynchronous send (WSASendTo) of data already held in `ctx->buffer`.
+ *
+ * @param sock Socket to send on.
+ * @param ctx Overlapped I/O context whose buffer holds the datagram.
+ * @param len Number of bytes to send; truncated to the context buffer size if larger.
+ * @param dest_addr Destination socket address (may point into `ctx->remote_addr`).
+ * @param dest_addr_len Length of the destination socket address.
+ * @throws socket_exception on non-pending failures from WSASendTo.
+ */
+void post_send_in_place(const unique_socket& sock, io_context* ctx, size_t len,
+                        const sockaddr* dest_addr, int dest_addr_len) {
+    ctx->operation = io_operation_type::send;
+
+    if (len > ctx->buffer.size()) {
+        len = ctx->buffer.size();
+    }
     ctx->wsa_buf.buf = ctx->buffer.data();
     ctx->wsa_buf.len = static_cast<ULONG>(len);
 
@@ -334,6 +471,73 @@ void post_send(const unique_socket& sock, io_context* ctx, const char* data, siz
     }
 }
 
+/**
+ * @brief Post a USO send of `len` bytes from `ctx->buffer` split into `segment_size` datagrams.
+ *
+ * @param sock Socket to send on.
+ * @param ctx Overlapped I/O context whose buffer holds the packed datagrams.
+ * @param len Total number of bytes to send; truncated to the context buffer size if larger.
+ * @param segment_size Size in bytes of each datagram (the last may be shorter).
+ * @param dest_addr Destination socket address.
+ * @param dest_addr_len Length of the destination socket address.
+ * @throws socket_exception on non-pending failures from WSASendMsg.
+ */
+void post_send_segmented(const unique_socket& sock, io_context* ctx, size_t len,
+                         DWORD segment_size, const sockaddr* dest_addr, int dest_addr_len) {
+    ctx->operation = io_operation_type::send;
+
+    if (len > ctx->buffer.size()) {
+        len = ctx->buffer.size();
+    }
+    ctx->wsa_buf.buf = ctx->buffer.data();
+    ctx->wsa_buf.len = static_cast<ULONG>(len);
+
+    if (reinterpret_cast<const void*>(dest_addr) != &ctx->remote_addr) {
+        std::memcpy(&ctx->remote_addr, dest_addr, static_cast<size_t>(dest_addr_len));
+    }
+
+    // Single control message carrying the USO segment size.
+    std::memset(ctx->control, 0, sizeof(ctx->control));
+    WSACMSGHDR* cmsg = reinterpret_cast<WSACMSGHDR*>(ctx->control);
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEND_MSG_SIZE;
+    cmsg->cmsg_len = WSA_CMSG_LEN(sizeof(segment_size));
+    std::memcpy(WSA_CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+
+    ctx->msg.name = reinterpret_cast<sockaddr*>(&ctx->remote_addr);
+    ctx->msg.namelen = dest_addr_len;
+    ctx->msg.lpBuffers = &ctx->wsa_buf;
+    ctx->msg.dwBufferCount = 1;
+    ctx->msg.Control.buf = ctx->control;
+    ctx->msg.Control.len = static_cast<ULONG>(WSA_CMSG_SPACE(sizeof(segment_size)));
+    ctx->msg.dwFlags = 0;
+
+    // Reset OVERLAPPED structure
+    std::memset(static_cast<OVERLAPPED*>(ctx), 0, sizeof(OVERLAPPED));
+
+    DWORD bytes_sent = 0;
+
+    int result = WSASendMsg(sock.get(), &ctx->msg, 0, &bytes_sent, ctx, nullptr);
+
+    if (result == SOCKET_ERROR) {
+        int error = WSAGetLastError();
+        if (error != WSA_IO_PENDING) {
+            throw socket_exception(
+                std::format("WSASendMsg failed: {} ({})", get_last_error_message(), error));
+        }
+    }
+}
+
+/**
+ * @brief Probe `UDP_SEND_MSG_SIZE` with getsockopt to detect USO support.
+ */
+bool is_udp_send_segmentation_supported(const unique_socket& sock) {
+    DWORD segment_size = 0;
+    int len = static_cast<int>(sizeof(segment_size));
+    return getsockopt(sock.get(), IPPROTO_UDP, UDP_SEND_MSG_SIZE,
+                      reinterpret_cast<char*>(&segment_size), &len) == 0;
+}
+
 int send_sync(const unique_socket& sock, const char* data, size_t len, const sockaddr* dest_addr,
               int dest_addr_len) {
     // For UDP, sendto either sends the full datagram or fails.
@@ -361,21 +565,6 @@ std::pair<sockaddr_storage, int> get_socket_name(const unique_socket& sock) {
     return {storage, len};
 }
 
-/**
- * @brief Return a monotonic timestamp in nanoseconds using QueryPerformanceCounter.
- */
-uint64_t get_timestamp_ns() {
-    static LARGE_INTEGER frequency = {};
-    static std::once_flag freq_once;
-    std::call_once(freq_once, [&]() { QueryPerformanceFrequency(&frequency); });
-
-    LARGE_INTEGER counter;
-    QueryPerformanceCounter(&counter);
-
-    // Convert to nanoseconds
-    return static_cast<uint64_t>(counter.QuadPart * 1000000000ULL / frequency.QuadPart);
-}
-
 /**
  * @brief Format the last Win32 or Winsock error code into a human-readable string.
  *
@@ -32,11 +32,14 @@
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <thread>
 #include <utility>
 #include <vector>
 
+#include "timestamp.hpp"
+
 // Packet header for tracking sequence numbers
 #pragma pack(push, 1)
 /**
@@ -51,18 +54,63 @@ struct packet_header {
     /// Sender timestamp in nanoseconds when the packet was created.
     uint64_t timestamp_ns;
 };
+
+/**
+ * @brief Extended header carrying server-side timestamps (client `--server-timestamps`).
+ *
+ * Begins with a plain `packet_header`, so servers that do not understand it
+ * still echo it unchanged. The client sends `magic`/`version` with zeroed
+ * server fields; a server that understands the version writes its receive
+ * and send times (on its own monotonic clock), sets `version` to the version
+ * it filled in and echoes the datagram. `client_send_ns` belongs to the
+ * client and is echoed unchanged by every server.
+ */
+struct packet_header_ext {
+    packet_header base;
+    /// `PACKET_EXT_MAGIC` when the extension is present.
+    uint32_t magic;
+    /// Extension version requested by the client / filled in by the server.
+    uint16_t version;
+    /// `PACKET_EXT_FLAG_*` bits set by the server.
+    uint16_t flags;
+    /// Server receive time in nanoseconds (0 if not stamped).
+    uint64_t server_recv_ns;
+    /// Server send time in nanoseconds (0 if not stamped).
+    uint64_t server_send_ns;
+    /// Time the client actually sent the datagram. `base.timestamp_ns` is the
+    /// intended send time under an open-loop schedule, so the two differ by the
+    /// schedule lag.
+    uint64_t client_send_ns;
+};
 #pragma pack(pop)
 
+/// Marks a `packet_header_ext` ("WUSE" in little-endian byte order).
+constexpr uint32_t PACKET_EXT_MAGIC = 0x45535557;
+/// Extension version this build reads and writes.
+constexpr uint16_t PACKET_EXT_VERSION = 1;
+/// `packet_header_ext::flags`: the receive time is a stack (socket) timestamp
+/// rather than the worker's dequeue time.
+constexpr uint16_t PACKET_EXT_FLAG_STACK_RX_TIMESTAMP = 0x1;
+
 /// Maximum UDP payload size (practical limit for IPv4/IPv6 datagrams).
 constexpr size_t MAX_PACKET_SIZE = 65507;  // Max UDP payload size
 /// Size of the packet header defined above.
 constexpr size_t HEADER_SIZE = sizeof(packet_header);
 /// Maximum application payload size after subtracting the header.
 constexpr size_t MAX_PAYLOAD_SIZE = MAX_PACKET_SIZE - HEADER_SIZE;
+/// Size of the extended header (replaces `HEADER_SIZE` with `--server-timestamps`).
+constexpr size_t EXT_HEADER_SIZE = sizeof(packet_header_ext);
 
 // Shared configuration constants
-/// Number of simultaneous outstanding asynchronous I/O operations per socket.
-constexpr size_t OUTSTANDING_OPS = 16;  // Number of outstanding I/O operations per socket
+/// Default number of simultaneous outstanding asynchronous I/O operations per socket
+/// (overridable at runtime with `--depth`).
+constexpr size_t DEFAULT_OUTSTANDING_OPS = 16;
+/// Upper bound accepted for `--depth`.
+constexpr size_t MAX_OUTSTANDING_OPS = 4096;
+/// Cache line size used to align per-I/O headers and pool buffers.
+constexpr size_t CACHE_LINE_SIZE = 64;
+/// Upper bound on datagrams packed into one UDP send segmentation offload (USO) send.
+constexpr size_t MAX_USO_SEGMENTS = 64;
 /// Timeout in milliseconds used when polling an IOCP for events.
 constexpr DWORD IOCP_TIMEOUT_MS = 10;  // IOCP polling timeout in milliseconds
 /// Timeout used specifically during shutdown checks on the IOCP.
@@ -89,33 +137,50 @@ class socket_exception : public std::runtime_error {
     explicit socket_exception(const std::string& message) : std::runtime_error(message) {}
 };
 
+/// Size of the per-context control (ancillary data) buffer used by WSARecvMsg.
+constexpr size_t CONTROL_BUFFER_SIZE = 64;
+
 /**
  * @brief Overlapped context extended with additional metadata for IOCP.
  *
  * Instances of `io_context` are allocated per outstanding operation and
- * posted to Winsock APIs. They embed a `WSABUF` and backing buffer, the
- * remote peer address storage and an `io_operation_type` to disambiguate
- * completion handling.
+ * posted to Winsock APIs. They embed a `WSABUF` view of the packet buffer,
+ * the remote peer address storage, a `WSAMSG` and control buffer for
+ * `WSARecvMsg`, and an `io_operation_type` to disambiguate completion
+ * handling. Contexts are cache-line aligned and do not own their packet
+ * buffer; `io_context_pool` places them densely in a slab and attaches a
+ * right-sized buffer to each one.
  */
-struct io_context : OVERLAPPED {
+struct alignas(CACHE_LINE_SIZE) io_context : OVERLAPPED {
     /// Operation type (recv or send).
     io_operation_type operation;
     /// WSABUF pointing at the `buffer` storage.
     WSABUF wsa_buf;
-    /// Backing storage for the packet (includes header + payload).
-    std::vector<char> buffer;
+    /// Packet storage (includes header + payload), owned by the pool.
+    std::span<char> buffer;
     /// Storage for the remote peer address.
     sockaddr_storage remote_addr;
-    /// Length of the remote address in bytes.
-    int remote_addr_len;
+    /// Message descriptor for WSARecvMsg. After a receive completes,
+    /// `msg.namelen` holds the length of `remote_addr` and `msg.Control.len`
+    /// the number of control bytes returned.
+    WSAMSG msg;
+    /// Control (ancillary data) buffer referenced by `msg.Control`.
+    alignas(WSACMSGHDR) char control[CONTROL_BUFFER_SIZE];
+
+    io_context() : OVERLAPPED{}, operation{io_operation_type::recv}, wsa_buf{}, msg{} {
+        std::memset(&remote_addr, 0, sizeof(remote_addr));
+        std::memset(control, 0, sizeof(control));
+    }
 
-    io_context()
-        : OVERLAPPED{}, operation{io_operation_type::recv}, remote_addr_len{sizeof(remote_addr)} {
-        buffer.resize(MAX_PACKET_SIZE);
+    /// Point the context (and its WSABUF) at externally owned packet storage.
+    void attach_buffer(std::span<char> storage) {
+        buffer = storage;
         wsa_buf.buf = buffer.data();
         wsa_buf.len = static_cast<ULONG>(buffer.size());
-        std::memset(&remote_addr, 0, sizeof(remote_addr));
     }
+
+    /// Length of the remote address captured by the last receive.
+    int remote_addr_len() const { return msg.namelen; }
 };
 
 /**
@@ -134,15 +199,18 @@ void cleanup_winsock();
  * @brief Create a UDP socket for the specified address family.
  *
  * @param family Address family (AF_INET or AF_INET6). Defaults to AF_INET.
+ * @param extra_flags Additional `WSASocket` flags OR-ed with `WSA_FLAG_OVERLAPPED`
+ *                    (e.g. `WSA_FLAG_REGISTERED_IO`).
  * @return A RAII `unique_socket` owning the created SOCKET.
  */
-unique_socket create_udp_socket(int family = AF_INET);
+unique_socket create_udp_socket(int family = AF_INET, DWORD extra_flags = 0);
 
 /**
  * @brief Set the CPU affinity for a socket (Windows SIO_CPU_AFFINITY).
  *
  * @param sock The socket to configure.
- * @param processor_id Logical processor index to bind the socket to.
+ * @param processor_id Global logical processor index (groups numbered in order)
+ *                     to bind the socket to.
  */
 void set_socket_cpu_affinity(const unique_socket& sock, uint16_t processor_id);
 
@@ -186,14 +254,23 @@ void set_file_completion_notification_modes(HANDLE handle,
  * @brief Set the current thread's processor affinity.
  *
  * This is used by worker threads that should be pinned to a specific CPU.
+ * `processor_id` is a global index: processors are numbered group by group.
  */
 void set_thread_affinity(uint32_t processor_id);
 
 /**
- * @brief Query the number of logical processors available on the system.
+ * @brief Query the number of logical processors available on the system (all groups).
  */
 uint32_t get_processor_count();
 
+/**
+ * @brief Return the NUMA node of the processor the calling thread is running on.
+ *
+ * Call after `set_thread_affinity` to get the node a pinned worker should
+ * allocate from.
+ */
+uint32_t get_current_numa_node();
+
 /**
  * @brief Bind a UDP socket to the given port and address family.
  *
@@ -208,9 +285,52 @@ void set_socket_option(const unique_socket& sock, int level, int optname, const
                        int optlen);
 
 /**
- * @brief Post an asynchronous receive (WSARecvFrom) using the provided context.
+ * @brief Post an asynchronous receive (WSARecvMsg) using the provided context.
+ *
+ * The sender address and any control data (e.g. URO segment size) are
+ * captured into `ctx->remote_addr` / `ctx->control`.
+ *
+ * @return 0 if the receive was posted (or is pending), otherwise the Winsock
+ *         error code, which has already been logged.
+ */
+int post_recv(const unique_socket& sock, io_context* ctx);
+
+/**
+ * @brief Enable UDP receive coalescing (URO) on a socket.
+ *
+ * Sets `UDP_RECV_MAX_COALESCED_SIZE` so the stack may deliver several
+ * same-sender datagrams in one receive completion.
+ *
+ * @param sock Socket to configure.
+ * @param max_coalesced_size Maximum coalesced message size in bytes; must not exceed the
+ *                           receive buffer size.
+ * @return true if the option was accepted, false if the OS or NIC does not support it.
+ */
+bool enable_udp_recv_coalescing(const unique_socket& sock, DWORD max_coalesced_size);
+
+/**
+ * @brief Return the URO segment size reported in the control data of a completed receive.
+ *
+ * @return Segment size in bytes, or 0 if the receive was not coalesced.
  */
-void post_recv(const unique_socket& sock, io_context* ctx);
+DWORD get_coalesced_segment_size(const io_context* ctx);
+
+/**
+ * @brief Ask the stack to timestamp received datagrams (`SIO_TIMESTAMPING`).
+ *
+ * Timestamps arrive as `SO_TIMESTAMP` control data on each receive. Requires
+ * Windows 10 version 2004 or later.
+ *
+ * @return false if the OS does not support receive timestamps.
+ */
+bool enable_rx_timestamps(const unique_socket& sock);
+
+/**
+ * @brief Return the stack receive timestamp in the control data of a completed receive.
+ *
+ * @return Timestamp on the QPC `get_timestamp_ns` clock, or 0 if none was attached.
+ */
+uint64_t get_rx_timestamp_ns(const io_context* ctx);
 
 /**
  * @brief Post an asynchronous send (WSASendTo) using the provided context.
@@ -220,6 +340,34 @@ void post_recv(const unique_socket& sock, io_context* ctx);
 void post_send(const unique_socket& sock, io_context* ctx, const char* data, size_t len,
                const sockaddr* dest_addr, int dest_addr_len);
 
+/**
+ * @brief Post an asynchronous send (WSASendTo) of the first `len` bytes already in `ctx->buffer`.
+ *
+ * Unlike `post_send` no copy is made, so a receive context can be echoed in place.
+ */
+void post_send_in_place(const unique_socket& sock, io_context* ctx, size_t len,
+                        const sockaddr* dest_addr, int dest_addr_len);
+
+/**
+ * @brief Post a segmented send (WSASendMsg + `UDP_SEND_MSG_SIZE`) of data in `ctx->buffer`.
+ *
+ * The first `len` bytes of the buffer hold back-to-back datagrams of
+ * `segment_size` bytes each (the last one may be shorter). The stack or NIC
+ * splits them into individual datagrams (USO). The destination address is
+ * copied into `ctx->remote_addr` so it outlives the call.
+ *
+ * @throws socket_exception on non-pending failures from WSASendMsg.
+ */
+void post_send_segmented(const unique_socket& sock, io_context* ctx, size_t len,
+                         DWORD segment_size, const sockaddr* dest_addr, int dest_addr_len);
+
+/**
+ * @brief Query whether the stack supports UDP send segmentation offload on `sock`.
+ *
+ * @return true if `UDP_SEND_MSG_SIZE` is recognised, false otherwise.
+ */
+bool is_udp_send_segmentation_supported(const unique_socket& sock);
+
 /**
  * @brief Synchronously send a UDP datagram using `sendto`.
  *
@@ -228,11 +376,6 @@ void post_send(const unique_socket& sock, io_context* ctx, const char* data, siz
 int send_sync(const unique_socket& sock, const char* data, size_t len, const sockaddr* dest_addr,
               int dest_addr_len);
 
-/**
- * @brief Return a monotonic timestamp in nanoseconds.
- */
-uint64_t get_timestamp_ns();
-
 /**
  * @brief Return the local socket address (sockname) for a socket.
  *
@@ -0,0 +1,83 @@
+/**
+ * @file spsc_ring.hpp
+ * @brief Bounded single-producer/single-consumer ring of trivially copyable values.
+ *
+ * One thread pushes and one thread pops. Each side only writes its own index
+ * and reads the other's with acquire ordering, so neither side ever takes a
+ * lock or allocates after construction. The indices sit on separate cache
+ * lines so the producer and consumer do not false-share.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "socket_utils.hpp"
+
+/**
+ * @brief Fixed-capacity lock-free SPSC queue.
+ *
+ * @tparam T Element type; copied in and out of the ring.
+ */
+template <typename T>
+class spsc_ring {
+    static_assert(std::is_trivially_copyable_v<T>, "spsc_ring elements must be trivially copyable");
+
+   public:
+    /**
+     * @brief Construct a ring holding at least `capacity` elements (rounded up to a power of two).
+     */
+    explicit spsc_ring(size_t capacity)
+        : capacity_(std::bit_ceil((std::max)(capacity, size_t{1}))),
+          mask_(capacity_ - 1),
+          slots_(capacity_) {}
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    /// Number of elements the ring can hold.
+    size_t capacity() const { return capacity_; }
+
+    /**
+     * @brief Append `value` (producer thread only).
+     * @return false if the ring is full.
+     */
+    bool try_push(const T& value) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == capacity_) return false;
+        slots_[static_cast<size_t>(tail & mask_)] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest element into `value` (consumer thread only).
+     * @return false if the ring is empty.
+     */
+    bool try_pop(T& value) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        value = slots_[static_cast<size_t>(head & mask_)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+   private:
+    size_t capacity_;
+    uint64_t mask_;
+    std::vector<T> slots_;
+
+    /// Next slot to pop; written by the consumer.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head_{0};
+    /// Next slot to fill; written by the producer.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail_{0};
+};
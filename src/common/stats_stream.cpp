@@ -0,0 +1,168 @@
+/**
+ * @file stats_stream.cpp
+ * @brief Implementation of the time-series statistics exporter.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "stats_stream.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <syncstream>
+
+stats_row& stats_row::add(std::string_view name, uint64_t value) {
+    fields_.push_back({std::string(name), std::to_string(value), false});
+    return *this;
+}
+
+stats_row& stats_row::add(std::string_view name, double value) {
+    fields_.push_back(
+        {std::string(name), std::isfinite(value) ? std::format("{:.3f}", value) : "", false});
+    return *this;
+}
+
+stats_row& stats_row::add(std::string_view name, std::string_view value) {
+    fields_.push_back({std::string(name), std::string(value), true});
+    return *this;
+}
+
+/**
+ * @brief Open the sink named by the spec prefix.
+ */
+stats_stream::stats_stream(const std::string& spec) {
+    const size_t colon = spec.find(':');
+    if (colon == std::string::npos || colon + 1 == spec.size()) {
+        throw std::invalid_argument(std::format(
+            "Invalid stats stream '{}': expected csv:|ndjson:|udp:|pipe: followed by a target",
+            spec));
+    }
+    const std::string kind = spec.substr(0, colon);
+    const std::string target = spec.substr(colon + 1);
+
+    if (kind == "csv" || kind == "ndjson") {
+        sink_ = kind == "csv" ? sink::csv : sink::ndjson;
+        file_.open(target, std::ios::out | std::ios::trunc);
+        if (!file_) throw std::runtime_error(std::format("Failed to open '{}'", target));
+    } else if (kind == "udp") {
+        sink_ = sink::udp;
+        // host:port, with an IPv6 literal optionally in brackets.
+        const size_t port_sep = target.rfind(':');
+        if (port_sep == std::string::npos || port_sep == 0) {
+            throw std::invalid_argument(std::format("Invalid UDP stats target '{}'", target));
+        }
+        std::string host = target.substr(0, port_sep);
+        const std::string port = target.substr(port_sep + 1);
+        if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* res = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || res == nullptr) {
+            throw socket_exception(std::format("Failed to resolve stats target '{}'", target));
+        }
+        std::memcpy(&dest_, res->ai_addr, res->ai_addrlen);
+        dest_len_ = static_cast<int>(res->ai_addrlen);
+        const int family = res->ai_family;
+        freeaddrinfo(res);
+
+        socket_ = create_udp_socket(family);
+        // Never let a slow or absent listener block the stats thread.
+        u_long non_blocking = 1;
+        if (ioctlsocket(socket_.get(), FIONBIO, &non_blocking) != 0) {
+            throw socket_exception(
+                std::format("ioctlsocket(FIONBIO) failed: {}", get_last_error_message()));
+        }
+    } else if (kind == "pipe") {
+        sink_ = sink::pipe;
+        const std::string name =
+            target.starts_with("\\\\.\\pipe\\") ? target : "\\\\.\\pipe\\" + target;
+        pipe_.reset(
+            CreateFileA(name.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr));
+        if (!pipe_) {
+            throw std::runtime_error(
+                std::format("Failed to open pipe '{}': {}", name, get_last_error_message()));
+        }
+    } else {
+        throw std::invalid_argument(std::format("Unknown stats stream type '{}'", kind));
+    }
+}
+
+/**
+ * @brief Format a row as a single-line JSON object.
+ */
+std::string stats_stream::to_json(const stats_row& row) {
+    std::string line = "{";
+    for (size_t i = 0; i < row.fields_.size(); ++i) {
+        const auto& f = row.fields_[i];
+        if (i > 0) line += ',';
+        line += std::format("\"{}\":", f.name);
+        if (f.quoted) {
+            line += std::format("\"{}\"", f.value);
+        } else {
+            line += f.value.empty() ? "null" : f.value;
+        }
+    }
+    line += "}\n";
+    return line;
+}
+
+void stats_stream::write(const stats_row& row) {
+    switch (sink_) {
+        case sink::csv: {
+            if (!header_written_) {
+                for (size_t i = 0; i < row.fields_.size(); ++i) {
+                    file_ << (i > 0 ? "," : "") << row.fields_[i].name;
+                }
+                file_ << '\n';
+                header_written_ = true;
+            }
+            for (size_t i = 0; i < row.fields_.size(); ++i) {
+                file_ << (i > 0 ? "," : "") << row.fields_[i].value;
+            }
+            file_ << '\n';
+            break;
+        }
+        case sink::ndjson:
+            file_ << to_json(row);
+            break;
+        case sink::udp: {
+            const std::string line = to_json(row);
+            const int sent =
+                sendto(socket_.get(), line.data(), static_cast<int>(line.size()), 0,
+                       reinterpret_cast<const sockaddr*>(&dest_), dest_len_);
+            if (sent == SOCKET_ERROR) ++dropped_;
+            break;
+        }
+        case sink::pipe: {
+            // Blocking writes only ever stall the stats thread, not the workers.
+            // A failed write (usually the reader went away) closes the pipe; later
+            // rows are counted as dropped, so export never stops the run.
+            if (!pipe_) {
+                ++dropped_;
+                break;
+            }
+            const std::string line = to_json(row);
+            DWORD written = 0;
+            if (!WriteFile(pipe_.get(), line.data(), static_cast<DWORD>(line.size()), &written,
+                           nullptr)) {
+                std::osyncstream(std::cerr) << std::format(
+                    "Stats pipe write failed: {} (closing the pipe, further rows are dropped)\n",
+                    get_last_error_message());
+                pipe_.reset();
+                ++dropped_;
+            }
+            break;
+        }
+    }
+}
+
+void stats_stream::flush() {
+    if (sink_ == sink::csv || sink_ == sink::ndjson) file_.flush();
+}
@@ -0,0 +1,97 @@
+/**
+ * @file stats_stream.hpp
+ * @brief Live time-series export of per-second, per-worker statistics.
+ *
+ * A `stats_stream` writes one row per worker per sampling interval to a CSV
+ * or NDJSON file, to a local UDP endpoint (one NDJSON object per datagram) or
+ * to an existing named pipe (NDJSON lines). Rows are built and written by the
+ * stats thread from relaxed counter snapshots, so workers never wait on the
+ * export; UDP sends are non-blocking and a datagram that does not fit is
+ * dropped and counted instead. A failed pipe write closes the pipe, and the
+ * rows after it are dropped and counted the same way.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "socket_utils.hpp"
+
+/**
+ * @brief One time-series sample: named fields in a fixed order.
+ */
+class stats_row {
+   public:
+    /// Add an unsigned integer field.
+    stats_row& add(std::string_view name, uint64_t value);
+    /// Add a floating-point field; NaN is written as an empty CSV cell / JSON null.
+    stats_row& add(std::string_view name, double value);
+    /// Add a string field (quoted in JSON).
+    stats_row& add(std::string_view name, std::string_view value);
+
+   private:
+    friend class stats_stream;
+
+    struct field {
+        std::string name;
+        std::string value;  ///< Already formatted.
+        bool quoted;        ///< True for strings (JSON needs quotes).
+    };
+    std::vector<field> fields_;
+};
+
+/**
+ * @brief Destination for `stats_row`s selected by a `--stats-stream` spec.
+ *
+ * Specs: `csv:<path>`, `ndjson:<path>`, `udp:<host>:<port>` or `pipe:<name>`,
+ * where a pipe name without a `\\.\pipe\` prefix gets one. The pipe must
+ * already have a listening server.
+ *
+ * @note Not thread-safe; written by a single stats thread.
+ */
+class stats_stream {
+   public:
+    /**
+     * @brief Open the destination described by `spec`.
+     * @throws std::invalid_argument for a malformed spec, socket_exception or
+     *         std::runtime_error if the destination cannot be opened.
+     */
+    explicit stats_stream(const std::string& spec);
+
+    stats_stream(const stats_stream&) = delete;
+    stats_stream& operator=(const stats_stream&) = delete;
+
+    /**
+     * @brief Write one row. In CSV mode the first row also writes the header,
+     * and later rows must have the same fields.
+     */
+    void write(const stats_row& row);
+
+    /// Flush buffered file output (called once per sampling interval).
+    void flush();
+
+    /// Rows dropped: UDP datagrams that did not fit the socket buffer, or
+    /// pipe rows from the failed write on (the reader went away).
+    uint64_t dropped() const { return dropped_; }
+
+   private:
+    enum class sink { csv, ndjson, udp, pipe };
+
+    static std::string to_json(const stats_row& row);
+
+    sink sink_;
+    std::ofstream file_;
+    unique_socket socket_;
+    sockaddr_storage dest_{};
+    int dest_len_{0};
+    wil::unique_hfile pipe_;
+    bool header_written_{false};
+    uint64_t dropped_{0};
+};
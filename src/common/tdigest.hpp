@@ -7,6 +7,15 @@
  * @file tdigest.hpp
  * @brief Mergeable, lock-free t-digest style estimator.
  *
+ * Centroids are stored as separate mean and weight arrays (struct of arrays)
+ * and kept sorted by mean. Compression radix-sorts the buffered samples and
+ * merges them with the existing centroids in one linear pass, so no
+ * temporary (value, weight) pairs are built or sorted. All intermediate
+ * arrays are members that are reused across calls and keep their capacity
+ * through `reset()`, so a digest that is recycled stops allocating once it
+ * has seen its largest batch. Weight sums and the cumulative weight scan in
+ * `percentile()` use SSE2 where available.
+ *
  * @copyright Copyright (c) 2025 LinuxUDPShardedEcho Contributors
  * SPDX-License-Identifier: MIT
  *
@@ -14,13 +23,20 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
-#include <numeric>
 #include <stdexcept>
 #include <vector>
 
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TDIGEST_HAVE_SSE2 1
+#endif
+
 /**
  * @class TDigest
  * @brief Mergeable t-digest implementation without internal locking.
@@ -37,8 +53,7 @@ class TDigest {
      * @brief Construct a TDigest.
      * @param compression Tuning parameter (higher => more accuracy).
      */
-    explicit TDigest(double compression)
-        : compression_(compression), buffer_(), centroids_(), total_weight_(0.0) {
+    explicit TDigest(double compression) : compression_(compression) {
         if (!(compression_ > 0.0)) throw std::invalid_argument("compression must be > 0");
     }
 
@@ -57,23 +72,13 @@ class TDigest {
      * centroids according to the compression parameter.
      */
     void compress() {
-        if (buffer_.empty() && centroids_.empty()) return;
-
-        // Merge buffer and existing centroids into sorted list of (value, weight)
-        std::vector<std::pair<double, double>> merged;
-        merged.reserve(buffer_.size() + centroids_.size());
-
-        std::transform(buffer_.begin(), buffer_.end(), std::back_inserter(merged),
-                       [](double v) { return std::pair<double, double>(v, 1.0); });
-        std::transform(
-            centroids_.begin(), centroids_.end(), std::back_inserter(merged),
-            [](const Centroid& c) { return std::pair<double, double>(c.mean, c.weight); });
+        if (buffer_.empty()) return;
 
+        sort_samples(buffer_, keys_, key_scratch_);
+        merge_runs(means_.data(), weights_.data(), means_.size(), buffer_.data(), nullptr,
+                   buffer_.size(), scratch_means_, scratch_weights_);
         buffer_.clear();
-
-        std::sort(merged.begin(), merged.end(),
-                  [](const auto& a, const auto& b) { return a.first < b.first; });
-        build_from(merged);
+        build_from(scratch_means_, scratch_weights_);
     }
 
     /**
@@ -82,67 +87,50 @@ class TDigest {
      * centroids). The caller must ensure proper synchronization if digests are used concurrently.
      */
     void merge(const TDigest& other) {
-        // Combine centroids and other's centroids + buffers into a merged vector
-        std::vector<std::pair<double, double>> merged;
-        merged.reserve(centroids_.size() + other.centroids_.size() + other.buffer_.size());
-
-        std::transform(
-            centroids_.begin(), centroids_.end(), std::back_inserter(merged),
-            [](const Centroid& c) { return std::pair<double, double>(c.mean, c.weight); });
-        std::transform(buffer_.begin(), buffer_.end(), std::back_inserter(merged),
-                       [](double v) { return std::pair<double, double>(v, 1.0); });
-
-        std::transform(
-            other.centroids_.begin(), other.centroids_.end(), std::back_inserter(merged),
-            [](const Centroid& c) { return std::pair<double, double>(c.mean, c.weight); });
-        std::transform(other.buffer_.begin(), other.buffer_.end(), std::back_inserter(merged),
-                       [](double v) { return std::pair<double, double>(v, 1.0); });
+        // Both digests' raw points are sorted together in our own buffer; the
+        // two centroid runs are already sorted.
+        buffer_.insert(buffer_.end(), other.buffer_.begin(), other.buffer_.end());
+        sort_samples(buffer_, keys_, key_scratch_);
 
-        total_weight_ += other.total_weight_;
+        merge_runs(means_.data(), weights_.data(), means_.size(), other.means_.data(),
+                   other.weights_.data(), other.means_.size(), merged_means_, merged_weights_);
+        merge_runs(merged_means_.data(), merged_weights_.data(), merged_means_.size(),
+                   buffer_.data(), nullptr, buffer_.size(), scratch_means_, scratch_weights_);
 
-        std::sort(merged.begin(), merged.end(),
-                  [](const auto& a, const auto& b) { return a.first < b.first; });
+        total_weight_ += other.total_weight_;
         buffer_.clear();
-        build_from(merged);
+        build_from(scratch_means_, scratch_weights_);
     }
 
     /**
      * @brief Estimate the q-th quantile (q in [0,1]). Returns NaN if empty.
+     *
+     * Buffered points are sorted into internal scratch space rather than
+     * compressed, so concurrent calls on the same digest are not safe.
      */
     double percentile(double q) const {
         if (!(q >= 0.0 && q <= 1.0)) throw std::invalid_argument("q must be in [0,1]");
         if (total_weight_ <= 0.0) return std::numeric_limits<double>::quiet_NaN();
 
         // If there are buffered points, we need to operate on a merged view.
-        std::vector<std::pair<double, double>> merged;
-        merged.reserve(centroids_.size() + buffer_.size());
-        std::transform(
-            centroids_.begin(), centroids_.end(), std::back_inserter(merged),
-            [](const Centroid& c) { return std::pair<double, double>(c.mean, c.weight); });
-        std::transform(buffer_.begin(), buffer_.end(), std::back_inserter(merged),
-                       [](double v) { return std::pair<double, double>(v, 1.0); });
-        if (!buffer_.empty())
-            std::sort(merged.begin(), merged.end(),
-                      [](const auto& a, const auto& b) { return a.first < b.first; });
-
-        // Walk merged list to find desired cumulative weight
-        double target = q * total_weight_;
-        double cumulative = 0.0;
-
-        if (merged.empty()) return std::numeric_limits<double>::quiet_NaN();
-
-        for (size_t i = 0; i < merged.size(); ++i) {
-            double v = merged[i].first;
-            double w = merged[i].second;
-            if (cumulative + w >= target) {
-                // simple linear interpolation within this item
-                return v;
-            }
-            cumulative += w;
+        const double* means = means_.data();
+        const double* weights = weights_.data();
+        size_t count = means_.size();
+        if (!buffer_.empty()) {
+            view_samples_.assign(buffer_.begin(), buffer_.end());
+            sort_samples(view_samples_, keys_, key_scratch_);
+            merge_runs(means_.data(), weights_.data(), means_.size(), view_samples_.data(),
+                       nullptr, view_samples_.size(), scratch_means_, scratch_weights_);
+            means = scratch_means_.data();
+            weights = scratch_weights_.data();
+            count = scratch_means_.size();
         }
+        if (count == 0) return std::numeric_limits<double>::quiet_NaN();
 
-        // If we didn't return, target is at or beyond the end — return max
-        return merged.back().first;
+        // Walk merged list to find desired cumulative weight
+        const size_t index = find_cumulative(weights, count, q * total_weight_);
+        // If the target is at or beyond the end, return max
+        return means[(std::min)(index, count - 1)];
     }
 
     /**
@@ -150,63 +138,229 @@ class TDigest {
      */
     void reset() {
         buffer_.clear();
-        centroids_.clear();
+        means_.clear();
+        weights_.clear();
         total_weight_ = 0.0;
     }
 
+    /**
+     * @brief Reserve room for `samples` buffered points so `add()` does not
+     * allocate until that many have been added. `reset()` keeps the capacity.
+     */
+    void reserve(size_t samples) { buffer_.reserve(samples); }
+
     /**
      * @brief Total weight (number of samples added).
      */
     double total_weight() const { return total_weight_; }
 
+    /**
+     * @brief Number of buffered points not yet folded into centroids.
+     */
+    size_t buffered_count() const { return buffer_.size(); }
+
+    /**
+     * @brief Number of compressed centroids (excluding buffered points).
+     */
+    size_t centroid_count() const { return means_.size(); }
+
    private:
-    struct Centroid {
-        double mean;
-        double weight;
-    };
+    /// Below this many samples `std::sort` beats the radix sort's fixed cost.
+    static constexpr size_t RADIX_SORT_MIN_SAMPLES = 256;
 
     double compression_;
-    std::vector<double> buffer_;       ///< Raw points waiting for compression
-    std::vector<Centroid> centroids_;  ///< Compressed centroids
-    double total_weight_ = 0.0;        ///< Sum of weights
+    std::vector<double> buffer_;   ///< Raw points waiting for compression
+    std::vector<double> means_;    ///< Centroid means, ascending
+    std::vector<double> weights_;  ///< Centroid weights, parallel to `means_`
+    double total_weight_ = 0.0;    ///< Sum of weights
+
+    // Scratch space reused by compress/merge/percentile.
+    std::vector<double> merged_means_;
+    std::vector<double> merged_weights_;
+    mutable std::vector<double> scratch_means_;
+    mutable std::vector<double> scratch_weights_;
+    mutable std::vector<double> view_samples_;
+    mutable std::vector<uint64_t> keys_;
+    mutable std::vector<uint64_t> key_scratch_;
 
     /**
-     * @brief Build compressed centroids from a sorted list of (value,weight).
+     * @brief Map a double to an unsigned key with the same ordering.
      */
-    void build_from(const std::vector<std::pair<double, double>>& merged) {
-        centroids_.clear();
-        if (merged.empty()) return;
+    static uint64_t sortable_key(double value) {
+        const uint64_t bits = std::bit_cast<uint64_t>(value);
+        constexpr uint64_t sign = 1ULL << 63;
+        return (bits & sign) ? ~bits : (bits | sign);
+    }
 
-        double total = std::accumulate(
-            merged.begin(), merged.end(), 0.0,
-            [](double sum, const std::pair<double, double>& p) { return sum + p.second; });
+    /**
+     * @brief Inverse of `sortable_key`.
+     */
+    static double from_sortable_key(uint64_t key) {
+        constexpr uint64_t sign = 1ULL << 63;
+        return std::bit_cast<double>((key & sign) ? (key & ~sign) : ~key);
+    }
+
+    /**
+     * @brief Sort `values` ascending with an LSD radix sort (8 bits per pass).
+     *
+     * All eight byte histograms are built in one pass over the keys, and a
+     * pass is skipped when every key has the same byte there, which is the
+     * common case for the high exponent bytes of latency samples.
+     */
+    static void sort_samples(std::vector<double>& values, std::vector<uint64_t>& keys,
+                             std::vector<uint64_t>& scratch) {
+        const size_t n = values.size();
+        if (n < RADIX_SORT_MIN_SAMPLES) {
+            std::sort(values.begin(), values.end());
+            return;
+        }
 
-        double k_limit = 4.0 * total / compression_;  // heuristic scaling
+        keys.resize(n);
+        scratch.resize(n);
+        std::array<std::array<size_t, 256>, 8> counts{};
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t key = sortable_key(values[i]);
+            keys[i] = key;
+            for (size_t pass = 0; pass < 8; ++pass) {
+                ++counts[pass][(key >> (pass * 8)) & 0xff];
+            }
+        }
+
+        uint64_t* src = keys.data();
+        uint64_t* dst = scratch.data();
+        for (size_t pass = 0; pass < 8; ++pass) {
+            auto& count = counts[pass];
+            const size_t shift = pass * 8;
+            if (count[(src[0] >> shift) & 0xff] == n) continue;
+
+            size_t offset = 0;
+            for (auto& c : count) {
+                const size_t bucket = c;
+                c = offset;
+                offset += bucket;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                dst[count[(src[i] >> shift) & 0xff]++] = src[i];
+            }
+            std::swap(src, dst);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            values[i] = from_sortable_key(src[i]);
+        }
+    }
+
+    /**
+     * @brief Merge two runs sorted by mean into `out_means`/`out_weights`.
+     *
+     * A null weight array means every point in that run has weight 1.
+     */
+    static void merge_runs(const double* a_means, const double* a_weights, size_t a_count,
+                           const double* b_means, const double* b_weights, size_t b_count,
+                           std::vector<double>& out_means, std::vector<double>& out_weights) {
+        out_means.resize(a_count + b_count);
+        out_weights.resize(a_count + b_count);
+        size_t i = 0, j = 0, k = 0;
+        while (i < a_count && j < b_count) {
+            if (b_means[j] < a_means[i]) {
+                out_means[k] = b_means[j];
+                out_weights[k++] = b_weights ? b_weights[j] : 1.0;
+                ++j;
+            } else {
+                out_means[k] = a_means[i];
+                out_weights[k++] = a_weights ? a_weights[i] : 1.0;
+                ++i;
+            }
+        }
+        for (; i < a_count; ++i, ++k) {
+            out_means[k] = a_means[i];
+            out_weights[k] = a_weights ? a_weights[i] : 1.0;
+        }
+        for (; j < b_count; ++j, ++k) {
+            out_means[k] = b_means[j];
+            out_weights[k] = b_weights ? b_weights[j] : 1.0;
+        }
+    }
+
+    /**
+     * @brief Sum `count` weights.
+     */
+    static double sum_weights(const double* weights, size_t count) {
+        size_t i = 0;
+        double total = 0.0;
+#ifdef TDIGEST_HAVE_SSE2
+        __m128d acc0 = _mm_setzero_pd();
+        __m128d acc1 = _mm_setzero_pd();
+        for (; i + 4 <= count; i += 4) {
+            acc0 = _mm_add_pd(acc0, _mm_loadu_pd(weights + i));
+            acc1 = _mm_add_pd(acc1, _mm_loadu_pd(weights + i + 2));
+        }
+        const __m128d acc = _mm_add_pd(acc0, acc1);
+        total = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+#endif
+        for (; i < count; ++i) total += weights[i];
+        return total;
+    }
+
+    /**
+     * @brief Index of the first item at which the cumulative weight reaches `target`.
+     *
+     * Whole blocks of four weights are summed with SIMD and skipped while the
+     * running total stays below the target; the block containing it is then
+     * walked one item at a time.
+     *
+     * @return `count` if the target is beyond the total weight.
+     */
+    static size_t find_cumulative(const double* weights, size_t count, double target) {
+        size_t i = 0;
         double cumulative = 0.0;
-        double current_mean = merged[0].first;
-        double current_weight = merged[0].second;
-
-        for (size_t i = 1; i < merged.size(); ++i) {
-            double v = merged[i].first;
-            double w = merged[i].second;
-            // projected is intentionally unused in this heuristic
-            (void)cumulative;
-            (void)current_weight;
-            (void)w;
-
-            if (current_weight + w <= (std::max)(1.0, k_limit)) {
+#ifdef TDIGEST_HAVE_SSE2
+        for (; i + 4 <= count; i += 4) {
+            const __m128d pair =
+                _mm_add_pd(_mm_loadu_pd(weights + i), _mm_loadu_pd(weights + i + 2));
+            const double block = _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+            if (cumulative + block >= target) break;
+            cumulative += block;
+        }
+#endif
+        for (; i < count; ++i) {
+            if (cumulative + weights[i] >= target) return i;
+            cumulative += weights[i];
+        }
+        return count;
+    }
+
+    /**
+     * @brief Build compressed centroids from a sorted run of (mean, weight).
+     */
+    void build_from(const std::vector<double>& merged_means,
+                    const std::vector<double>& merged_weights) {
+        means_.clear();
+        weights_.clear();
+        if (merged_means.empty()) return;
+
+        const double total = sum_weights(merged_weights.data(), merged_weights.size());
+        const double k_limit = (std::max)(1.0, 4.0 * total / compression_);  // heuristic scaling
+        double current_mean = merged_means[0];
+        double current_weight = merged_weights[0];
+
+        for (size_t i = 1; i < merged_means.size(); ++i) {
+            const double v = merged_means[i];
+            const double w = merged_weights[i];
+            if (current_weight + w <= k_limit) {
                 // merge into current centroid
                 current_mean = (current_mean * current_weight + v * w) / (current_weight + w);
                 current_weight += w;
             } else {
                 // push current and start a new centroid
-                centroids_.push_back({current_mean, current_weight});
-                cumulative += current_weight;
+                means_.push_back(current_mean);
+                weights_.push_back(current_weight);
                 current_mean = v;
                 current_weight = w;
             }
         }
         // push last
-        centroids_.push_back({current_mean, current_weight});
+        means_.push_back(current_mean);
+        weights_.push_back(current_weight);
     }
 };
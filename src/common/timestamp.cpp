@@ -0,0 +1,180 @@
+/**
+ * @file timestamp.cpp
+ * @brief Implementation of the QPC and TSC timestamp sources.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "timestamp.hpp"
+
+#include <stdexcept>
+
+#include "socket_utils.hpp"
+
+#if defined(_M_X64)
+#include <intrin.h>
+#define ECHO_HAVE_TSC 1
+#endif
+
+namespace {
+
+/**
+ * @brief Fixed-point ticks-to-nanoseconds scale: ns = ticks * mult / 2^shift.
+ *
+ * `mult` is kept below 2^32 and the low `shift` bits of the ticks are
+ * scaled separately, so neither product can overflow 64 bits for any
+ * timestamp below 2^64 ns (about 584 years).
+ */
+struct tick_scale {
+    uint64_t mult{0};
+    uint32_t shift{0};
+
+    static tick_scale for_frequency(uint64_t hz) {
+        // The largest shift whose multiplier still fits in 32 bits keeps the most precision.
+        tick_scale scale;
+        for (uint32_t shift = 32;; --shift) {
+            const uint64_t mult = (1'000'000'000ULL << shift) / hz;
+            if (mult < (1ULL << 32) || shift == 0) {
+                scale.mult = mult;
+                scale.shift = shift;
+                return scale;
+            }
+        }
+    }
+
+    uint64_t to_ns(uint64_t ticks) const {
+        const uint64_t low_mask = (1ULL << shift) - 1;
+        return (ticks >> shift) * mult + (((ticks & low_mask) * mult) >> shift);
+    }
+};
+
+uint64_t query_qpc_frequency() {
+    LARGE_INTEGER frequency = {};
+    QueryPerformanceFrequency(&frequency);
+    return static_cast<uint64_t>(frequency.QuadPart);
+}
+
+// The QPC frequency is fixed at boot, so it is read once during static initialization.
+const uint64_t g_qpc_frequency = query_qpc_frequency();
+const tick_scale g_qpc_scale = tick_scale::for_frequency(g_qpc_frequency);
+
+/**
+ * @brief TSC calibration: TSC ticks since `base_tsc` map to ns after `base_ns` (QPC clock).
+ */
+struct tsc_calibration {
+    bool calibrated{false};
+    uint64_t frequency{0};
+    uint64_t base_tsc{0};
+    uint64_t base_ns{0};
+    tick_scale scale;
+};
+
+tsc_calibration g_tsc;
+timestamp_source g_source = timestamp_source::qpc;
+
+uint64_t read_qpc() {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return static_cast<uint64_t>(counter.QuadPart);
+}
+
+#ifdef ECHO_HAVE_TSC
+uint64_t read_tsc() {
+    unsigned int aux = 0;
+    return __rdtscp(&aux);
+}
+
+/**
+ * @brief Measure the TSC frequency against QPC over `interval_ms`.
+ */
+void calibrate_tsc(uint32_t interval_ms) {
+    const uint64_t qpc_start = read_qpc();
+    const uint64_t tsc_start = read_tsc();
+    Sleep(interval_ms);
+    const uint64_t qpc_end = read_qpc();
+    const uint64_t tsc_end = read_tsc();
+
+    // (TSC ticks) * (QPC ticks/s) stays far below 2^64 for a sub-second interval.
+    g_tsc.frequency = (tsc_end - tsc_start) * g_qpc_frequency / (qpc_end - qpc_start);
+    g_tsc.scale = tick_scale::for_frequency(g_tsc.frequency);
+    g_tsc.base_tsc = tsc_end;
+    g_tsc.base_ns = g_qpc_scale.to_ns(qpc_end);
+    g_tsc.calibrated = true;
+}
+#endif
+
+}  // namespace
+
+/**
+ * @brief Parse a `--clock` value.
+ */
+timestamp_source parse_timestamp_source(const std::string& text) {
+    if (text == "qpc") return timestamp_source::qpc;
+    if (text == "tsc") return timestamp_source::tsc;
+    throw std::invalid_argument(std::format("Unknown clock: {} (valid: qpc|tsc)", text));
+}
+
+/**
+ * @brief Name of a timestamp source as accepted by `--clock`.
+ */
+const char* timestamp_source_name(timestamp_source source) {
+    return source == timestamp_source::tsc ? "tsc" : "qpc";
+}
+
+/**
+ * @brief Check CPUID leaf 0x80000007 for the invariant-TSC bit (EDX bit 8).
+ */
+bool invariant_tsc_supported() {
+#ifdef ECHO_HAVE_TSC
+    int regs[4] = {};
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned int>(regs[0]) < 0x80000007u) return false;
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Switch sources, calibrating the TSC the first time it is selected.
+ */
+timestamp_source set_timestamp_source(timestamp_source source) {
+    g_source = timestamp_source::qpc;
+#ifdef ECHO_HAVE_TSC
+    if (source == timestamp_source::tsc && invariant_tsc_supported()) {
+        if (!g_tsc.calibrated) calibrate_tsc(100);
+        g_source = timestamp_source::tsc;
+    }
+#else
+    static_cast<void>(source);
+#endif
+    return g_source;
+}
+
+timestamp_source get_timestamp_source() { return g_source; }
+
+uint64_t timestamp_frequency_hz() {
+    return g_source == timestamp_source::tsc ? g_tsc.frequency : g_qpc_frequency;
+}
+
+/**
+ * @brief Convert QueryPerformanceCounter ticks to nanoseconds with the precomputed scale.
+ */
+uint64_t qpc_ticks_to_ns(uint64_t ticks) { return g_qpc_scale.to_ns(ticks); }
+
+/**
+ * @brief Read the selected counter and convert it to nanoseconds.
+ */
+uint64_t get_timestamp_ns() {
+#ifdef ECHO_HAVE_TSC
+    if (g_source == timestamp_source::tsc) {
+        const uint64_t tsc = read_tsc();
+        // A processor whose TSC trails the calibrating one must not step back past the base.
+        return tsc > g_tsc.base_tsc ? g_tsc.base_ns + g_tsc.scale.to_ns(tsc - g_tsc.base_tsc)
+                                    : g_tsc.base_ns;
+    }
+#endif
+    return g_qpc_scale.to_ns(read_qpc());
+}
@@ -0,0 +1,78 @@
+/**
+ * @file timestamp.hpp
+ * @brief Monotonic nanosecond timestamps for the per-packet paths.
+ *
+ * `get_timestamp_ns` reads `QueryPerformanceCounter` and converts ticks with
+ * a fixed-point scale computed once from the counter frequency, so a
+ * timestamp costs one counter read, two multiplies and two shifts, with no
+ * division, and the conversion does not overflow however long the host has
+ * been up. Optionally (`set_timestamp_source(timestamp_source::tsc)`) it
+ * reads the time-stamp counter with `rdtscp` instead, after calibrating the
+ * TSC against QPC; this requires an invariant TSC (x64 only) and is anchored
+ * to the QPC timeline at calibration, so the two clocks agree closely but
+ * drift apart by the calibration error (parts per million) over a run.
+ * Timestamps that come from the stack (`get_rx_timestamp_ns`) are always on
+ * the QPC clock.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Counter behind `get_timestamp_ns`.
+ */
+enum class timestamp_source {
+    /// QueryPerformanceCounter (default).
+    qpc,
+    /// Calibrated invariant TSC read with `rdtscp`.
+    tsc,
+};
+
+/**
+ * @brief Parse a `--clock` value (`qpc` or `tsc`).
+ *
+ * @throws std::invalid_argument for anything else.
+ */
+timestamp_source parse_timestamp_source(const std::string& text);
+
+/**
+ * @brief Name of a timestamp source as accepted by `--clock`.
+ */
+const char* timestamp_source_name(timestamp_source source);
+
+/**
+ * @brief Whether this processor has an invariant TSC that `timestamp_source::tsc` can use.
+ */
+bool invariant_tsc_supported();
+
+/**
+ * @brief Select the counter behind `get_timestamp_ns`.
+ *
+ * The first switch to the TSC calibrates it against QPC, which takes about
+ * 100 ms. Not thread-safe: call before starting threads that take timestamps.
+ *
+ * @return The source in effect, which is `timestamp_source::qpc` if the TSC
+ *         was requested but is not invariant.
+ */
+timestamp_source set_timestamp_source(timestamp_source source);
+
+/// Counter currently behind `get_timestamp_ns`.
+timestamp_source get_timestamp_source();
+
+/// Tick frequency of the current source in Hz.
+uint64_t timestamp_frequency_hz();
+
+/**
+ * @brief Convert QueryPerformanceCounter ticks to nanoseconds.
+ */
+uint64_t qpc_ticks_to_ns(uint64_t ticks);
+
+/**
+ * @brief Return a monotonic timestamp in nanoseconds.
+ */
+uint64_t get_timestamp_ns();
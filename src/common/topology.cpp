@@ -0,0 +1,248 @@
+/**
+ * @file topology.cpp
+ * @brief Implementation of processor topology discovery and worker placement.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "topology.hpp"
+
+#include <mstcpip.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+// RSS processor query may not be defined in older SDKs
+#ifndef SIO_QUERY_RSS_PROCESSOR_INFO
+#define SIO_QUERY_RSS_PROCESSOR_INFO _WSAIOR(IOC_VENDOR, 165)
+typedef struct _SOCKET_PROCESSOR_AFFINITY {
+    PROCESSOR_NUMBER Processor;
+    USHORT NumaNodeId;
+    USHORT Reserved;
+} SOCKET_PROCESSOR_AFFINITY;
+#endif
+
+/**
+ * @brief Walk every active group and record each processor's NUMA node.
+ */
+processor_topology processor_topology::discover() {
+    processor_topology topology;
+    topology.group_count = GetActiveProcessorGroupCount();
+    std::set<uint32_t> nodes;
+    uint32_t index = 0;
+    for (WORD g = 0; g < topology.group_count; ++g) {
+        const DWORD count = GetActiveProcessorCount(g);
+        for (DWORD n = 0; n < count; ++n, ++index) {
+            PROCESSOR_NUMBER number = {};
+            number.Group = g;
+            number.Number = static_cast<BYTE>(n);
+            USHORT node = 0;
+            if (!GetNumaProcessorNodeEx(&number, &node)) node = 0;
+
+            logical_processor processor;
+            processor.index = index;
+            processor.group = g;
+            processor.number = static_cast<BYTE>(n);
+            processor.numa_node = node;
+            topology.processors.push_back(processor);
+            nodes.insert(node);
+        }
+    }
+    if (topology.processors.empty()) {
+        throw socket_exception("No active processors found");
+    }
+    topology.numa_node_count = static_cast<uint32_t>(nodes.size());
+    return topology;
+}
+
+/**
+ * @brief Look up a processor by its group-relative number.
+ */
+const logical_processor* processor_topology::find(WORD group, BYTE number) const {
+    for (const auto& processor : processors) {
+        if (processor.group == group && processor.number == number) return &processor;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Parse a `--placement` value.
+ */
+placement_policy parse_placement_policy(const std::string& text) {
+    if (text == "compact") return placement_policy::compact;
+    if (text == "spread") return placement_policy::spread;
+    if (text == "nic-local") return placement_policy::nic_local;
+    throw std::invalid_argument(
+        std::format("Unknown placement: {} (valid: compact|spread|nic-local)", text));
+}
+
+/**
+ * @brief Name of a placement policy as accepted by `--placement`.
+ */
+const char* placement_policy_name(placement_policy policy) {
+    switch (policy) {
+        case placement_policy::spread:
+            return "spread";
+        case placement_policy::nic_local:
+            return "nic-local";
+        default:
+            return "compact";
+    }
+}
+
+/**
+ * @brief Parse a comma-separated list of processor indices and `first-last` ranges.
+ *
+ * Order is preserved. A processor listed twice would get two workers, so it is rejected.
+ */
+std::vector<uint32_t> parse_cpu_list(const std::string& text) {
+    auto parse_index = [](const std::string& item, const std::string& value) {
+        char* end = nullptr;
+        const unsigned long index = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0') {
+            throw std::invalid_argument(std::format("Invalid CPU list entry '{}'", item));
+        }
+        return static_cast<uint32_t>(index);
+    };
+
+    std::vector<uint32_t> cpus;
+    std::set<uint32_t> seen;
+    auto add = [&](uint32_t cpu) {
+        if (!seen.insert(cpu).second) {
+            throw std::invalid_argument(std::format("CPU {} is listed more than once", cpu));
+        }
+        cpus.push_back(cpu);
+    };
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        const size_t dash = item.find('-');
+        if (dash == std::string::npos) {
+            add(parse_index(item, item));
+            continue;
+        }
+        const uint32_t first = parse_index(item, item.substr(0, dash));
+        const uint32_t last = parse_index(item, item.substr(dash + 1));
+        if (last < first) {
+            throw std::invalid_argument(std::format("Reversed CPU range '{}'", item));
+        }
+        for (uint32_t cpu = first; cpu <= last; ++cpu) add(cpu);
+    }
+    if (cpus.empty()) throw std::invalid_argument("Empty CPU list");
+    return cpus;
+}
+
+/**
+ * @brief Query the RSS processors of the socket's interface.
+ */
+std::vector<uint32_t> query_rss_processors(const unique_socket& sock,
+                                           const processor_topology& topology) {
+    // One entry per RSS queue; there are never more queues than processors.
+    std::vector<SOCKET_PROCESSOR_AFFINITY> entries(topology.processors.size());
+    DWORD bytes_returned = 0;
+    const int result = WSAIoctl(
+        sock.get(), SIO_QUERY_RSS_PROCESSOR_INFO, nullptr, 0, entries.data(),
+        static_cast<DWORD>(entries.size() * sizeof(SOCKET_PROCESSOR_AFFINITY)), &bytes_returned,
+        nullptr, nullptr);
+    if (result == SOCKET_ERROR) return {};
+
+    std::vector<uint32_t> rss;
+    const size_t count = bytes_returned / sizeof(SOCKET_PROCESSOR_AFFINITY);
+    for (size_t i = 0; i < count && i < entries.size(); ++i) {
+        const logical_processor* processor =
+            topology.find(entries[i].Processor.Group, entries[i].Processor.Number);
+        if (processor != nullptr &&
+            std::find(rss.begin(), rss.end(), processor->index) == rss.end()) {
+            rss.push_back(processor->index);
+        }
+    }
+    return rss;
+}
+
+/**
+ * @brief Probe the interface for `address` with a bound or connected UDP socket.
+ */
+std::vector<uint32_t> query_interface_rss_processors(const sockaddr* address, int address_len,
+                                                     bool local,
+                                                     const processor_topology& topology) {
+    try {
+        unique_socket probe = create_udp_socket(address->sa_family);
+        const int result = local ? bind(probe.get(), address, address_len)
+                                 : connect(probe.get(), address, address_len);
+        if (result == SOCKET_ERROR) return {};
+        return query_rss_processors(probe, topology);
+    } catch (const socket_exception&) {
+        return {};
+    }
+}
+
+/**
+ * @brief Order the processors according to the policy and take the first `count`.
+ */
+std::vector<logical_processor> select_worker_processors(
+    const processor_topology& topology, placement_policy policy, uint32_t count,
+    const std::vector<uint32_t>& rss_processors, const std::vector<uint32_t>& cpu_list) {
+    const auto& all = topology.processors;
+
+    if (!cpu_list.empty()) {
+        std::vector<logical_processor> selected;
+        for (uint32_t cpu : cpu_list) {
+            if (cpu >= all.size()) {
+                throw std::invalid_argument(std::format(
+                    "CPU {} is out of range ({} logical processors)", cpu, all.size()));
+            }
+            selected.push_back(all[cpu]);
+        }
+        return selected;
+    }
+
+    // Compact order: node by node, processor order within each node.
+    std::vector<logical_processor> order = all;
+    std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        return a.numa_node < b.numa_node;
+    });
+
+    if (policy == placement_policy::spread) {
+        // Take the next processor of each node in turn.
+        std::vector<std::vector<logical_processor>> by_node;
+        for (const auto& processor : order) {
+            if (by_node.empty() || by_node.back().front().numa_node != processor.numa_node) {
+                by_node.emplace_back();
+            }
+            by_node.back().push_back(processor);
+        }
+        order.clear();
+        for (size_t round = 0; order.size() < all.size(); ++round) {
+            for (const auto& node : by_node) {
+                if (round < node.size()) order.push_back(node[round]);
+            }
+        }
+    } else if (policy == placement_policy::nic_local && !rss_processors.empty()) {
+        // RSS processors first, then the rest of their nodes, then everything else.
+        std::set<uint32_t> rss_nodes;
+        for (uint32_t cpu : rss_processors) rss_nodes.insert(all[cpu].numa_node);
+        auto rank = [&](const logical_processor& processor) {
+            if (std::find(rss_processors.begin(), rss_processors.end(), processor.index) !=
+                rss_processors.end()) {
+                return 0;
+            }
+            return rss_nodes.count(processor.numa_node) != 0 ? 1 : 2;
+        };
+        std::vector<logical_processor> ranked;
+        for (uint32_t cpu : rss_processors) ranked.push_back(all[cpu]);
+        for (int r = 1; r <= 2; ++r) {
+            for (const auto& processor : order) {
+                if (rank(processor) == r) ranked.push_back(processor);
+            }
+        }
+        order = std::move(ranked);
+    }
+
+    order.resize((std::min)(static_cast<size_t>(count), order.size()));
+    return order;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file topology.hpp
+ * @brief Processor group / NUMA topology discovery and worker placement policies.
+ *
+ * Workers are identified by a global logical processor index: processors are
+ * numbered group by group (group 0 first), the same numbering taken by
+ * `set_thread_affinity` and `SIO_CPU_AFFINITY`, so hosts with more than 64
+ * logical processors are covered. `processor_topology` records each
+ * processor's group, number within the group and NUMA node;
+ * `select_worker_processors` turns a placement policy (or an explicit CPU
+ * list) into the processors the workers run on. `nic-local` placement asks
+ * the stack which processors the NIC's RSS queues interrupt
+ * (`SIO_QUERY_RSS_PROCESSOR_INFO`) so receive completions stay on the node
+ * that owns the NIC.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "socket_utils.hpp"
+
+/**
+ * @brief One active logical processor.
+ */
+struct logical_processor {
+    /// Global index (groups numbered in order), as taken by `set_thread_affinity`.
+    uint32_t index{0};
+    /// Processor group and number within that group.
+    WORD group{0};
+    BYTE number{0};
+    /// NUMA node the processor belongs to.
+    uint32_t numa_node{0};
+};
+
+/**
+ * @brief Active logical processors across all processor groups.
+ */
+struct processor_topology {
+    /// Processors ordered by global index.
+    std::vector<logical_processor> processors;
+    /// Number of active processor groups.
+    uint32_t group_count{0};
+    /// Number of distinct NUMA nodes the processors belong to.
+    uint32_t numa_node_count{0};
+
+    /**
+     * @brief Enumerate the active processors of every group.
+     *
+     * @throws socket_exception if no processors are reported.
+     */
+    static processor_topology discover();
+
+    /// Processor at `(group, number)`, or nullptr if it is not active.
+    const logical_processor* find(WORD group, BYTE number) const;
+};
+
+/**
+ * @brief How workers are spread over the processors (`--placement`).
+ */
+enum class placement_policy {
+    /// Fill one NUMA node before moving to the next (processor order on most hosts).
+    compact,
+    /// Round-robin across NUMA nodes.
+    spread,
+    /// The NIC's RSS processors first, then the rest of their nodes, then everything else.
+    nic_local,
+};
+
+/**
+ * @brief Parse a `--placement` value (`compact`, `spread` or `nic-local`).
+ *
+ * @throws std::invalid_argument for any other value.
+ */
+placement_policy parse_placement_policy(const std::string& text);
+
+/// Name of `policy` as accepted by `--placement`.
+const char* placement_policy_name(placement_policy policy);
+
+/**
+ * @brief Parse a `--cpus` list such as `0-3,8,10-11` into global processor indices.
+ *
+ * @throws std::invalid_argument if an entry is malformed, a range is reversed or
+ *         a processor is listed more than once.
+ */
+std::vector<uint32_t> parse_cpu_list(const std::string& text);
+
+/**
+ * @brief Ask the stack which processors service RSS for the socket's interface.
+ *
+ * The socket must be bound to (or connected through) the interface of
+ * interest; a wildcard-bound socket generally reports nothing.
+ *
+ * @return Global indices of the RSS processors, in the order reported and
+ *         without duplicates; empty if the interface does not support RSS or
+ *         the query fails.
+ */
+std::vector<uint32_t> query_rss_processors(const unique_socket& sock,
+                                           const processor_topology& topology);
+
+/**
+ * @brief RSS processors of the interface that owns, or routes to, `address`.
+ *
+ * Opens a probe socket and binds it to `address` (`local`, one of this
+ * host's addresses) or connects it to `address` (a remote peer, so the
+ * route's interface is used), then calls `query_rss_processors`.
+ *
+ * @return Global indices of the RSS processors; empty on any failure.
+ */
+std::vector<uint32_t> query_interface_rss_processors(const sockaddr* address, int address_len,
+                                                     bool local,
+                                                     const processor_topology& topology);
+
+/**
+ * @brief Choose the processors `count` workers run on.
+ *
+ * @param topology Discovered processors.
+ * @param policy Placement policy; ignored when `cpu_list` is not empty.
+ * @param count Number of workers (ignored when `cpu_list` is not empty).
+ * @param rss_processors RSS processors for `nic_local` (compact order if empty).
+ * @param cpu_list Explicit global processor indices (`--cpus`), used as given.
+ * @return One processor per worker, at most one worker per processor.
+ * @throws std::invalid_argument if `cpu_list` names an inactive processor.
+ */
+std::vector<logical_processor> select_worker_processors(
+    const processor_topology& topology, placement_policy policy, uint32_t count,
+    const std::vector<uint32_t>& rss_processors, const std::vector<uint32_t>& cpu_list);
@@ -0,0 +1,154 @@
+/**
+ * @file tracing.hpp
+ * @brief Opt-in ETW TraceLogging events for the worker hot paths.
+ *
+ * Each executable defines its own provider with `TRACELOGGING_DEFINE_PROVIDER`
+ * (`WinUDPShardedEcho.Server` / `WinUDPShardedEcho.Client`) and registers it
+ * for the life of `main` with `trace_provider_registration`. Events are
+ * batch-level (one per completion dequeue or pacer decision, never one per
+ * datagram), and every `TraceLoggingWrite` first checks the provider's enabled
+ * level and keywords, so with no session listening an event costs a load and
+ * a branch. The arguments of a `trace_*` call are still evaluated before that
+ * check, so call sites whose arguments cost more than reading a local guard
+ * the call with `trace_enabled`. Configuring with `-DENABLE_ETW_TRACING=OFF`
+ * compiles the events out entirely.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// Windows headers must precede TraceLoggingProvider.h.
+#include "socket_utils.hpp"
+
+#if ECHO_ETW_TRACING
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+/// Provider handle; defined once per executable in its main.cpp.
+TRACELOGGING_DECLARE_PROVIDER(g_trace_provider);
+#endif
+
+/// Keywords used to select event groups in a trace session.
+namespace trace_keyword {
+/// One event per GetQueuedCompletionStatusEx / RIODequeueCompletion batch.
+constexpr uint64_t DEQUEUE = 0x1;
+/// Send or receive context pools running dry.
+constexpr uint64_t POOL = 0x2;
+/// Receives that could not be reposted.
+constexpr uint64_t IO_ERROR = 0x4;
+/// Client pacer send/wait decisions.
+constexpr uint64_t PACER = 0x8;
+}  // namespace trace_keyword
+
+/**
+ * @brief Whether any trace session listens for events with `keyword` (at any level).
+ *
+ * Always false when the events are compiled out.
+ */
+inline bool trace_enabled(uint64_t keyword) {
+#if ECHO_ETW_TRACING
+    return TraceLoggingProviderEnabled(g_trace_provider, 0, keyword);
+#else
+    static_cast<void>(keyword);
+    return false;
+#endif
+}
+
+/**
+ * @brief Completions drained by one dequeue call.
+ *
+ * @param worker Worker (processor) index.
+ * @param completions Entries returned by the dequeue.
+ * @param receives Of which receive completions.
+ */
+inline void trace_completion_batch(uint32_t worker, uint32_t completions, uint32_t receives) {
+#if ECHO_ETW_TRACING
+    TraceLoggingWrite(g_trace_provider, "CompletionBatch",
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(trace_keyword::DEQUEUE),
+                      TraceLoggingUInt32(worker, "Worker"),
+                      TraceLoggingUInt32(completions, "Completions"),
+                      TraceLoggingUInt32(receives, "Receives"),
+                      TraceLoggingUInt32(completions - receives, "Sends"));
+#endif
+}
+
+/**
+ * @brief A datagram could not be sent because the send context pool was empty.
+ *
+ * @param worker Worker (processor) index.
+ * @param depth Outstanding-operation depth at the time.
+ */
+inline void trace_send_pool_empty(uint32_t worker, uint64_t depth) {
+#if ECHO_ETW_TRACING
+    TraceLoggingWrite(g_trace_provider, "SendPoolEmpty",
+                      TraceLoggingLevel(WINEVENT_LEVEL_WARNING),
+                      TraceLoggingKeyword(trace_keyword::POOL),
+                      TraceLoggingUInt32(worker, "Worker"), TraceLoggingUInt64(depth, "Depth"));
+#endif
+}
+
+/**
+ * @brief A receive could not be reposted.
+ *
+ * @param worker Worker (processor) index.
+ * @param error Winsock error code returned by the post.
+ */
+inline void trace_repost_failed(uint32_t worker, int error) {
+#if ECHO_ETW_TRACING
+    TraceLoggingWrite(g_trace_provider, "RepostFailed", TraceLoggingLevel(WINEVENT_LEVEL_ERROR),
+                      TraceLoggingKeyword(trace_keyword::IO_ERROR),
+                      TraceLoggingUInt32(worker, "Worker"), TraceLoggingInt32(error, "Error"));
+#endif
+}
+
+/**
+ * @brief One pass of the client send loop: what was sent and how long it will wait.
+ *
+ * @param worker Worker (processor) index.
+ * @param sent Datagrams sent in this pass.
+ * @param wait_ns Pacer delay until the next send (0 = may send now).
+ * @param target_rate_pps Congestion controller's current target rate.
+ * @param free_send_contexts Send contexts left; 0 means the pool, not the pacer, stopped the pass.
+ */
+inline void trace_pacer_decision(uint32_t worker, uint64_t sent, uint64_t wait_ns,
+                                 double target_rate_pps, uint64_t free_send_contexts) {
+#if ECHO_ETW_TRACING
+    TraceLoggingWrite(g_trace_provider, "PacerDecision",
+                      TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+                      TraceLoggingKeyword(trace_keyword::PACER),
+                      TraceLoggingUInt32(worker, "Worker"), TraceLoggingUInt64(sent, "Sent"),
+                      TraceLoggingUInt64(wait_ns, "WaitNs"),
+                      TraceLoggingFloat64(target_rate_pps, "TargetRatePps"),
+                      TraceLoggingUInt64(free_send_contexts, "FreeSendContexts"));
+#endif
+}
+
+/**
+ * @brief Registers `g_trace_provider` for the lifetime of the object.
+ *
+ * Registration failure is not fatal; the events are simply never enabled.
+ */
+class trace_provider_registration {
+   public:
+    trace_provider_registration() {
+#if ECHO_ETW_TRACING
+        registered_ = SUCCEEDED(TraceLoggingRegister(g_trace_provider));
+#endif
+    }
+    ~trace_provider_registration() {
+#if ECHO_ETW_TRACING
+        if (registered_) TraceLoggingUnregister(g_trace_provider);
+#endif
+    }
+
+    trace_provider_registration(const trace_provider_registration&) = delete;
+    trace_provider_registration& operator=(const trace_provider_registration&) = delete;
+
+   private:
+    bool registered_{false};
+};
@@ -0,0 +1,38 @@
+/**
+ * @file udp_stats.cpp
+ * @brief Implementation of the host-wide UDP statistics sampler.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "udp_stats.hpp"
+
+/**
+ * @brief Query the baseline; later samples report changes relative to it.
+ */
+udp_stats_sampler::udp_stats_sampler(int family) : family_(family) {
+    available_ = GetUdpStatisticsEx(&last_, static_cast<ULONG>(family)) == NO_ERROR;
+}
+
+/**
+ * @brief Read the MIB and accumulate the (wrap-safe) differences.
+ */
+udp_counters udp_stats_sampler::sample() {
+    udp_counters delta;
+    if (!available_) return delta;
+    MIB_UDPSTATS now = {};
+    if (GetUdpStatisticsEx(&now, static_cast<ULONG>(family_)) != NO_ERROR) return delta;
+
+    // Unsigned 32-bit subtraction stays correct across one wrap of a counter.
+    auto diff = [](DWORD current, DWORD previous) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(current - previous));
+    };
+    delta.in_datagrams = diff(now.dwInDatagrams, last_.dwInDatagrams);
+    delta.no_ports = diff(now.dwNoPorts, last_.dwNoPorts);
+    delta.in_errors = diff(now.dwInErrors, last_.dwInErrors);
+    delta.out_datagrams = diff(now.dwOutDatagrams, last_.dwOutDatagrams);
+    last_ = now;
+    totals_ += delta;
+    return delta;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file udp_stats.hpp
+ * @brief Host-wide UDP receive/drop counters from the IP helper API.
+ *
+ * Winsock has no per-socket drop counter, so datagrams the stack discards
+ * before any receive completes (socket receive buffer full, checksum or
+ * length errors, no socket bound to the port) are only visible in the
+ * host's UDP MIB. `udp_stats_sampler` reads it with `GetUdpStatisticsEx`
+ * for one address family and accumulates the change between samples into
+ * 64-bit totals; the MIB's 32-bit counters wrap, so sample at least every
+ * few seconds at high rates. The counters cover every UDP socket on the
+ * host, not just this process.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "socket_utils.hpp"
+
+// clang-format off -- iphlpapi.h needs the Winsock headers included first
+#include <iphlpapi.h>
+// clang-format on
+
+/**
+ * @brief UDP MIB counters (or their change over an interval).
+ */
+struct udp_counters {
+    /// Datagrams delivered to sockets.
+    uint64_t in_datagrams{0};
+    /// Datagrams for a port with no socket bound.
+    uint64_t no_ports{0};
+    /// Datagrams discarded for other reasons, chiefly full socket receive buffers.
+    uint64_t in_errors{0};
+    /// Datagrams sent.
+    uint64_t out_datagrams{0};
+
+    udp_counters& operator+=(const udp_counters& other) {
+        in_datagrams += other.in_datagrams;
+        no_ports += other.no_ports;
+        in_errors += other.in_errors;
+        out_datagrams += other.out_datagrams;
+        return *this;
+    }
+};
+
+/**
+ * @brief Samples the host's UDP statistics for one address family.
+ *
+ * Not thread-safe; owned by the thread that samples it.
+ */
+class udp_stats_sampler {
+   public:
+    /**
+     * @brief Take the baseline sample.
+     *
+     * @param family `AF_INET` or `AF_INET6`.
+     */
+    explicit udp_stats_sampler(int family);
+
+    /// Whether the statistics could be read (false if the baseline query failed).
+    bool available() const { return available_; }
+
+    int family() const { return family_; }
+
+    /**
+     * @brief Read the counters again.
+     *
+     * @return The change since the previous sample (all zero if unavailable);
+     *         also added to `totals()`.
+     */
+    udp_counters sample();
+
+    /// Total change since the baseline.
+    const udp_counters& totals() const { return totals_; }
+
+   private:
+    int family_;
+    bool available_{false};
+    MIB_UDPSTATS last_{};
+    udp_counters totals_;
+};
@@ -16,247 +16,283 @@
 // - Uses SIO_CPU_AFFINITY to affinitize each socket
 // - Uses an IO Completion Port per listening socket
 // - Services each IOCP using an affinitized thread
+// - Optionally uses Registered I/O (RIO) request/completion queues per socket
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <csignal>
 #include <cstdlib>
+#include <exception>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <numeric>
 #include <syncstream>
 #include <thread>
 
 #include "common/arg_parser.hpp"
+#include "common/counters.hpp"
 #include "common/socket_utils.hpp"
-
-// Global flag for shutdown; set to true to request orderly termination.
-std::atomic<bool> g_shutdown{false};
-// Global verbose flag; enable more verbose runtime output when true.
-std::atomic<bool> g_verbose{false};
-// If true, reply synchronously via `sendto` instead of posting overlapped sends.
-std::atomic<bool> g_sync_reply{false};
+#include "common/stats_stream.hpp"
+#include "common/topology.hpp"
+#include "common/tracing.hpp"
+#include "common/udp_stats.hpp"
+#include "server_worker.hpp"
+
+#if ECHO_ETW_TRACING
+// ETW provider "WinUDPShardedEcho.Server"; the GUID is the ETW hash of that name,
+// so sessions can also enable it as *WinUDPShardedEcho.Server.
+TRACELOGGING_DEFINE_PROVIDER(g_trace_provider, "WinUDPShardedEcho.Server",
+                             (0xbfa231e7, 0x04ee, 0x5a33, 0x0e, 0x66, 0xce, 0x03, 0x30, 0x2e,
+                              0x0b, 0xdc));
+#endif
+
+// Settings and stop flag shared by every worker of this run.
+server_config g_config;
+// Per-second, per-worker time-series export (`--stats-stream`); null when disabled.
+std::unique_ptr<stats_stream> g_stats_stream;
 
 /**
  * @brief Signal handler that requests shutdown.
  */
 void signal_handler(int) {
-    g_shutdown.store(true);
+    g_config.shutdown.store(true);
 }
 
 /**
- * @brief Per-worker context for server-side processing.
- *
- * Holds the listening socket, IOCP handle, a worker thread and basic
- * counters for received/sent packets and bytes.
+ * @brief Received-packet spread over the shards, one shard per CPU.
  */
-struct server_worker_context {
-    /// Logical processor id this worker is affinitized to.
-    uint32_t processor_id;
-    /// The UDP socket owned by the worker.
-    unique_socket socket;
-    /// IO Completion Port associated with the socket.
-    unique_iocp iocp;
-    /// Worker thread (jthread for cooperative cancellation support).
-    std::jthread worker_thread;
-    /// Counters and statistics.
-    std::atomic<uint64_t> packets_received{0};
-    std::atomic<uint64_t> packets_sent{0};
-    std::atomic<uint64_t> bytes_received{0};
-    std::atomic<uint64_t> bytes_sent{0};
+struct shard_balance {
+    /// Packets received per shard, ordered by CPU.
+    std::vector<std::pair<uint32_t, uint64_t>> received;
+    double mean{0.0};
+    /// Busiest and idlest shard relative to the mean (1.0 = perfectly even).
+    double max_ratio{0.0};
+    double min_ratio{0.0};
+    uint32_t max_cpu{0};
+    uint32_t min_cpu{0};
+    /// Coefficient of variation (standard deviation / mean).
+    double cov{0.0};
 };
 
 /**
- * @brief Worker thread entrypoint for the server.
+ * @brief One counter summed per shard, ordered by CPU.
  *
- * Pins the thread, posts initial receives, and loops processing IOCP
- * completions for receives and sends. Received datagrams are echoed back
- * to the sender in this example.
+ * The IPv4 and IPv6 workers of a CPU form one shard, since RSS steers by
+ * processor.
  */
-void worker_thread_func(server_worker_context* ctx) try {
-    // Set thread affinity to match socket affinity
-    set_thread_affinity(ctx->processor_id);
-
-    // Allocate receive contexts
-    std::vector<std::unique_ptr<io_context>> recv_contexts;
-    for (size_t i = 0; i < OUTSTANDING_OPS; ++i) {
-        recv_contexts.push_back(std::make_unique<io_context>());
-    }
-
-    // Pool of send contexts
-    std::vector<std::unique_ptr<io_context>> send_contexts;
-    for (size_t i = 0; i < OUTSTANDING_OPS; ++i) {
-        send_contexts.push_back(std::make_unique<io_context>());
-    }
-    std::vector<io_context*> available_send_contexts;
-    std::transform(send_contexts.begin(), send_contexts.end(),
-                   std::back_inserter(available_send_contexts),
-                   [](const std::unique_ptr<io_context>& ptr) { return ptr.get(); });
-
-    // Post initial receive operations
-    for (auto& recv_ctx : recv_contexts) {
-        post_recv(ctx->socket, recv_ctx.get());
-    }
-
-    if (g_verbose.load())
-        std::osyncstream(std::cout)
-            << std::format("[CPU {}] Worker started, {} outstanding receives\n", ctx->processor_id,
-                           OUTSTANDING_OPS);
-
-    // Short helper lambdas to make the completion-processing loop clearer.
-    auto handle_recv_completion = [&](const io_context* io_ctx, DWORD bytes_transferred) {
-        // Update basic receive counters
-        ctx->packets_received.fetch_add(1);
-        ctx->bytes_received.fetch_add(bytes_transferred);
-
-        // If we received data, prepare to echo or process it
-        if (bytes_transferred > 0) {
-            // NOTE: This is the primary packet-processing area. Real servers would
-            // parse or inspect the buffer here, apply protocol logic, and decide
-            // whether to reply, forward, or drop the packet. Keep processing
-            // extremely quick to avoid blocking the IOCP worker.
-
-            // For this example we echo the packet back to the sender. Get a send context
-            // from the pool and post a send.
-            return true;  // indicate that further send-handling is required
+template <typename WorkerType>
+std::vector<std::pair<uint32_t, uint64_t>> shard_totals(
+    const std::vector<std::unique_ptr<WorkerType>>& workers,
+    single_writer_counter WorkerType::* counter) {
+    std::vector<std::pair<uint32_t, uint64_t>> totals;
+    for (const auto& ctx : workers) {
+        auto it = std::find_if(totals.begin(), totals.end(),
+                               [&](const auto& shard) { return shard.first == ctx->processor_id; });
+        if (it == totals.end()) {
+            totals.emplace_back(ctx->processor_id, 0);
+            it = totals.end() - 1;
         }
-        return false;
-    };
-
-    auto handle_send_completion = [&](const io_context* io_ctx) {
-        // Send completed — update counters and make context available again.
-        // The caller is responsible for returning the context to the pool.
-        return;
-    };
-
-    while (!g_shutdown.load()) {
-        // Use GetQueuedCompletionStatusEx to batch completions
-        const ULONG max_entries = static_cast<ULONG>(OUTSTANDING_OPS * 2);
-        std::vector<OVERLAPPED_ENTRY> entries(max_entries);
-        ULONG num_removed = 0;
-
-        BOOL ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
-                                                     &num_removed, IOCP_SHUTDOWN_TIMEOUT_MS, FALSE);
+        it->second += ((*ctx).*counter).load();
+    }
+    std::sort(totals.begin(), totals.end());
+    return totals;
+}
 
-        if (!ex_result) {
-            DWORD error = GetLastError();
-            if (error == WAIT_TIMEOUT) {
-                continue;
-            }
-            if (error == ERROR_ABANDONED_WAIT_0) {
-                // IOCP was closed, time to exit
-                continue;
-            }
-            std::osyncstream(std::cerr)
-                << std::format("[CPU {}] GetQueuedCompletionStatusEx failed with error: {}\n",
-                               ctx->processor_id, error);
-            continue;
-        }
+/**
+ * @brief Packets received so far by each shard, ordered by CPU.
+ */
+template <typename WorkerType>
+std::vector<std::pair<uint32_t, uint64_t>> shard_received(
+    const std::vector<std::unique_ptr<WorkerType>>& workers) {
+    return shard_totals(workers, &WorkerType::packets_received);
+}
 
-        if (num_removed == 0) continue;
-
-        for (ULONG ei = 0; ei < num_removed; ++ei) {
-            const OVERLAPPED_ENTRY& entry = entries[ei];
-            DWORD bytes_transferred = entry.dwNumberOfBytesTransferred;
-            ULONG_PTR completion_key = entry.lpCompletionKey;
-            LPOVERLAPPED overlapped = entry.lpOverlapped;
-            if (overlapped == nullptr) continue;
-
-            auto* io_ctx = static_cast<io_context*>(overlapped);
-
-            if (io_ctx->operation == io_operation_type::recv) {
-                bool needs_send = handle_recv_completion(io_ctx, bytes_transferred);
-
-                if (needs_send) {
-                    if (g_sync_reply.load()) {
-                        try {
-                            int sent =
-                                send_sync(ctx->socket, io_ctx->buffer.data(), bytes_transferred,
-                                          reinterpret_cast<sockaddr*>(&io_ctx->remote_addr),
-                                          io_ctx->remote_addr_len);
-                            ctx->packets_sent.fetch_add(1);
-                            ctx->bytes_sent.fetch_add(sent);
-                        } catch (const std::exception& ex) {
-                            std::osyncstream(std::cerr) << std::format(
-                                "[CPU {}] sync send failed: {}\n", ctx->processor_id, ex.what());
-                        }
-                        // Re-post receive and continue
-                        post_recv(ctx->socket, io_ctx);
-                        continue;
-                    }
+/**
+ * @brief Sum of one counter over all workers.
+ */
+template <typename WorkerType>
+uint64_t worker_total(const std::vector<std::unique_ptr<WorkerType>>& workers,
+                      single_writer_counter WorkerType::* counter) {
+    uint64_t total = 0;
+    for (const auto& ctx : workers) total += ((*ctx).*counter).load();
+    return total;
+}
 
-                    // Acquire a send context from the pool
-                    io_context* send_ctx = nullptr;
-                    if (!available_send_contexts.empty()) {
-                        send_ctx = available_send_contexts.back();
-                        available_send_contexts.pop_back();
-                    } else {
-                        std::osyncstream(std::cerr) << std::format(
-                            "[CPU {}] No available send context\n", ctx->processor_id);
-                        // Re-post receive and continue — do not block here
-                        post_recv(ctx->socket, io_ctx);
-                        continue;
-                    }
+/**
+ * @brief Where the server lost packets, beyond the per-worker counters.
+ *
+ * The workers count what they see (echoes they could not send, receive
+ * errors); datagrams the stack discards before a receive completes — most
+ * often because the socket receive buffer was full — only show up in the
+ * host's UDP MIB, which the RPS thread samples once a second.
+ */
+struct drop_accounting {
+    /// One sampler per address family the workers use.
+    std::vector<udp_stats_sampler> os_udp;
+    /// OS UDP receive errors in each one-second window (host-wide).
+    std::vector<uint64_t> os_in_errors_per_window;
+    /// Echoes the workers dropped in each one-second window.
+    std::vector<uint64_t> echoes_dropped_per_window;
+
+    /// Sample every family and return the combined change.
+    udp_counters sample() {
+        udp_counters delta;
+        for (auto& sampler : os_udp) delta += sampler.sample();
+        return delta;
+    }
 
-                    // Echo the packet back — in a real server you would transform or
-                    // generate an appropriate response instead of simply echoing.
-                    post_send(ctx->socket, send_ctx, io_ctx->buffer.data(), bytes_transferred,
-                              reinterpret_cast<sockaddr*>(&io_ctx->remote_addr),
-                              io_ctx->remote_addr_len);
-                    ctx->packets_sent.fetch_add(1);
-                    ctx->bytes_sent.fetch_add(bytes_transferred);
-                }
+    /// Combined change since the samplers were created.
+    udp_counters os_totals() const {
+        udp_counters totals;
+        for (const auto& sampler : os_udp) totals += sampler.totals();
+        return totals;
+    }
 
-                // Re-post receive for continuous processing
-                post_recv(ctx->socket, io_ctx);
-            } else {
-                // Send completed — return context to pool
-                handle_send_completion(io_ctx);
-                available_send_contexts.push_back(io_ctx);
-            }
-        }
+    /// Whether any family's statistics could be read.
+    bool os_available() const {
+        return std::any_of(os_udp.begin(), os_udp.end(),
+                           [](const auto& sampler) { return sampler.available(); });
     }
+};
 
-    if (g_verbose.load())
-        std::osyncstream(std::cout) << std::format(
-            "[CPU {}] Worker shutting down. Stats: recv={}, sent={}, "
-            "bytes_recv={}, bytes_sent={}\n",
-            ctx->processor_id, ctx->packets_received.load(), ctx->packets_sent.load(),
-            ctx->bytes_received.load(), ctx->bytes_sent.load());
-} catch (const std::exception& ex) {
-    std::osyncstream(std::cerr) << std::format("[CPU {}] Worker thread exception: {}\n",
-                                               ctx->processor_id, ex.what());
-    // Shutdown on unhandled exception
-    g_shutdown.store(true);
-} catch (...) {
-    std::osyncstream(std::cerr) << std::format("[CPU {}] Worker thread unknown exception\n",
-                                               ctx->processor_id);
-    // Shutdown on unhandled exception
-    g_shutdown.store(true);
+/**
+ * @brief Summarize how evenly RSS spread received packets over the shards.
+ */
+shard_balance compute_shard_balance(std::vector<std::pair<uint32_t, uint64_t>> received) {
+    shard_balance balance;
+    balance.received = std::move(received);
+    if (balance.received.empty()) return balance;
+
+    uint64_t total = 0;
+    auto busiest = balance.received.front();
+    auto idlest = balance.received.front();
+    for (const auto& shard : balance.received) {
+        total += shard.second;
+        if (shard.second > busiest.second) busiest = shard;
+        if (shard.second < idlest.second) idlest = shard;
+    }
+    balance.mean = static_cast<double>(total) / static_cast<double>(balance.received.size());
+    if (balance.mean == 0.0) return balance;
+    double variance = 0.0;
+    for (const auto& shard : balance.received) {
+        const double d = static_cast<double>(shard.second) - balance.mean;
+        variance += d * d;
+    }
+    variance /= static_cast<double>(balance.received.size());
+    balance.max_ratio = static_cast<double>(busiest.second) / balance.mean;
+    balance.min_ratio = static_cast<double>(idlest.second) / balance.mean;
+    balance.max_cpu = busiest.first;
+    balance.min_cpu = idlest.first;
+    balance.cov = std::sqrt(variance) / balance.mean;
+    return balance;
 }
 
 /**
  * @brief Common template for RPS printer thread.
  *
+ * Also samples the OS UDP counters into `drops` once a second.
+ *
  * @tparam WorkerType IOCP worker context type
  */
 template <typename WorkerType>
-std::thread create_rps_thread(const std::vector<std::unique_ptr<WorkerType>>& workers) {
-    return std::thread([&workers]() {
+std::thread create_rps_thread(const std::vector<std::unique_ptr<WorkerType>>& workers,
+                              drop_accounting& drops) {
+    return std::thread([&workers, &drops]() {
         uint64_t prev_total = 0;
-        while (!g_shutdown.load()) {
+        uint64_t prev_dropped = 0;
+        // Per-shard received totals at the previous second, for the interval's balance.
+        std::vector<std::pair<uint32_t, uint64_t>> prev_shards;
+        // Per-worker counter snapshots from the previous second for --stats-stream.
+        struct snapshot {
+            uint64_t received{0}, sent{0}, bytes_received{0}, bytes_sent{0}, send_calls{0},
+                dropped{0}, send_errors{0}, recv_errors{0}, repost_failures{0};
+        };
+        std::vector<snapshot> previous(workers.size());
+        const auto start_time = std::chrono::steady_clock::now();
+        auto prev_sample_time = start_time;
+        while (!g_config.shutdown.load()) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
 
             uint64_t total_recv = std::accumulate(
                 workers.begin(), workers.end(), 0ULL,
                 [](uint64_t sum, const std::unique_ptr<WorkerType>& ctx) {
-                    return sum + ctx->packets_received.load(std::memory_order_relaxed);
+                    return sum + ctx->packets_received.load();
                 });
 
             uint64_t rps = (total_recv >= prev_total) ? (total_recv - prev_total) : 0;
             prev_total = total_recv;
 
-            std::osyncstream(std::cout) << std::format("[RPS] {} req/s\n", rps);
+            const uint64_t total_dropped = worker_total(workers, &WorkerType::echoes_dropped);
+            const uint64_t dropped = total_dropped - prev_dropped;
+            prev_dropped = total_dropped;
+            const uint64_t os_in_errors = drops.sample().in_errors;
+            drops.echoes_dropped_per_window.push_back(dropped);
+            drops.os_in_errors_per_window.push_back(os_in_errors);
+            const std::string drop_note =
+                dropped > 0 || os_in_errors > 0
+                    ? std::format(", dropped: {} echoes, {} OS UDP receive errors", dropped,
+                                  os_in_errors)
+                    : std::string();
+
+            // Name the busiest shard of the last second whenever there is more than one.
+            auto shards = shard_received(workers);
+            auto interval = shards;
+            for (size_t i = 0; i < interval.size() && i < prev_shards.size(); ++i) {
+                interval[i].second -= prev_shards[i].second;
+            }
+            prev_shards = std::move(shards);
+            const shard_balance balance = compute_shard_balance(std::move(interval));
+            if (balance.received.size() > 1 && balance.mean > 0.0) {
+                std::osyncstream(std::cout)
+                    << std::format("[RPS] {} req/s (busiest CPU {} at {:.2f}x mean){}\n", rps,
+                                   balance.max_cpu, balance.max_ratio, drop_note);
+            } else {
+                std::osyncstream(std::cout) << std::format("[RPS] {} req/s{}\n", rps, drop_note);
+            }
+
+            if (!g_stats_stream) continue;
+            const auto sample_time = std::chrono::steady_clock::now();
+            const double interval_s =
+                std::chrono::duration<double>(sample_time - prev_sample_time).count();
+            prev_sample_time = sample_time;
+            const uint64_t timestamp_ms = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count());
+            for (size_t i = 0; i < workers.size(); ++i) {
+                const auto& ctx = workers[i];
+                const snapshot now{ctx->packets_received.load(), ctx->packets_sent.load(),
+                                   ctx->bytes_received.load(),   ctx->bytes_sent.load(),
+                                   ctx->send_calls.load(),       ctx->echoes_dropped.load(),
+                                   ctx->send_errors.load(),      ctx->recv_errors.load(),
+                                   ctx->repost_failures.load()};
+                const snapshot& prev = previous[i];
+                auto rate = [interval_s](uint64_t cur, uint64_t old) {
+                    return static_cast<double>(cur - old) / interval_s;
+                };
+
+                stats_row row;
+                row.add("timestamp_ms", timestamp_ms)
+                    .add("elapsed_s",
+                         std::chrono::duration<double>(sample_time - start_time).count())
+                    .add("role", "server")
+                    .add("worker", static_cast<uint64_t>(ctx->processor_id))
+                    .add("recv_pps", rate(now.received, prev.received))
+                    .add("sent_pps", rate(now.sent, prev.sent))
+                    .add("recv_bps", 8.0 * rate(now.bytes_received, prev.bytes_received))
+                    .add("sent_bps", 8.0 * rate(now.bytes_sent, prev.bytes_sent))
+                    .add("send_calls_per_s", rate(now.send_calls, prev.send_calls))
+                    .add("dropped", now.dropped - prev.dropped)
+                    .add("send_errors", now.send_errors - prev.send_errors)
+                    .add("recv_errors", now.recv_errors - prev.recv_errors)
+                    .add("repost_failures", now.repost_failures - prev.repost_failures)
+                    .add("depth", ctx->depth.load());
+                g_stats_stream->write(row);
+                previous[i] = now;
+            }
+            g_stats_stream->flush();
         }
     });
 }
@@ -267,13 +303,19 @@ std::thread create_rps_thread(const std::vector<std::unique_ptr<WorkerType>>& wo
  * @tparam WorkerType IOCP worker context type
  */
 template <typename WorkerType>
-void print_final_stats(const std::vector<std::unique_ptr<WorkerType>>& workers) {
+void print_final_stats(const std::vector<std::unique_ptr<WorkerType>>& workers,
+                       const drop_accounting& drops) {
     uint64_t total_recv = 0, total_sent = 0, total_bytes_recv = 0, total_bytes_sent = 0;
+    uint64_t total_send_calls = 0;
+    uint64_t total_spin_ns = 0, total_run_ns = 0;
     for (const auto& ctx : workers) {
+        total_spin_ns += ctx->spin_ns.load();
+        total_run_ns += ctx->run_ns.load();
         total_recv += ctx->packets_received.load();
         total_sent += ctx->packets_sent.load();
         total_bytes_recv += ctx->bytes_received.load();
         total_bytes_sent += ctx->bytes_sent.load();
+        total_send_calls += ctx->send_calls.load();
     }
 
     std::osyncstream(std::cout) << std::format("\nFinal Statistics:\n");
@@ -281,6 +323,146 @@ void print_final_stats(const std::vector<std::unique_ptr<WorkerType>>& workers)
     std::osyncstream(std::cout) << std::format("  Total packets sent: {}\n", total_sent);
     std::osyncstream(std::cout) << std::format("  Total bytes received: {}\n", total_bytes_recv);
     std::osyncstream(std::cout) << std::format("  Total bytes sent: {}\n", total_bytes_sent);
+    std::osyncstream(std::cout) << std::format(
+        "  Segments per send: {:.2f} ({} sends)\n",
+        total_send_calls > 0 ? static_cast<double>(total_sent) / total_send_calls : 0.0,
+        total_send_calls);
+    if (g_config.spin_ns > 0) {
+        std::osyncstream(std::cout) << std::format(
+            "  Spin time: {:.1f}% of worker time (budget {} us)\n",
+            total_run_ns > 0 ? 100.0 * static_cast<double>(total_spin_ns) / total_run_ns : 0.0,
+            g_config.spin_ns / 1000);
+    }
+
+    // Where packets were lost: in the workers, and (host-wide) in the stack.
+    const uint64_t total_dropped = worker_total(workers, &WorkerType::echoes_dropped);
+    std::osyncstream(std::cout) << std::format(
+        "  Echoes dropped: {} (send pool empty {}, send errors {})\n"
+        "  Receive errors: {}, receive repost failures: {}\n",
+        total_dropped, worker_total(workers, &WorkerType::send_pool_empty),
+        worker_total(workers, &WorkerType::send_errors),
+        worker_total(workers, &WorkerType::recv_errors),
+        worker_total(workers, &WorkerType::repost_failures));
+    uint64_t max_drain_ns = 0;
+    for (const auto& ctx : workers) max_drain_ns = (std::max)(max_drain_ns, ctx->drain_ns.load());
+    std::osyncstream(std::cout) << std::format(
+        "  Shutdown drain: {} echoes completed, {} abandoned, {:.1f} ms (limit {} ms)\n",
+        worker_total(workers, &WorkerType::drained_sends),
+        worker_total(workers, &WorkerType::abandoned_sends),
+        static_cast<double>(max_drain_ns) / 1e6, g_config.drain_ns / 1'000'000ULL);
+    if (drops.os_available()) {
+        const udp_counters os = drops.os_totals();
+        std::osyncstream(std::cout) << std::format(
+            "  OS UDP (host-wide): {} received, {} receive errors (buffer overflow), "
+            "{} to closed ports\n",
+            os.in_datagrams, os.in_errors, os.no_ports);
+    }
+    if (total_dropped > 0) {
+        std::string per_shard;
+        for (const auto& [cpu, dropped] : shard_totals(workers, &WorkerType::echoes_dropped)) {
+            per_shard += std::format(" {}={}", cpu, dropped);
+        }
+        std::osyncstream(std::cout)
+            << std::format("  Echoes dropped per shard (CPU=packets):{}\n", per_shard);
+    }
+
+    // How evenly RSS spread the load; the busiest shard caps global throughput.
+    const shard_balance balance = compute_shard_balance(shard_received(workers));
+    if (balance.received.size() > 1 && balance.mean > 0.0) {
+        std::string per_shard;
+        for (const auto& [cpu, received] : balance.received) {
+            per_shard += std::format(" {}={}", cpu, received);
+        }
+        std::osyncstream(std::cout) << std::format(
+            "  Shard balance: max {:.2f}x mean (CPU {}), min {:.2f}x mean (CPU {}), CoV {:.3f}\n"
+            "  Received per shard (CPU=packets):{}\n",
+            balance.max_ratio, balance.max_cpu, balance.min_ratio, balance.min_cpu, balance.cov,
+            per_shard);
+    }
+}
+
+/**
+ * @brief Write the final statistics as JSON, in the layout of the client's `--stats-file`.
+ *
+ * @tparam WorkerType IOCP worker context type
+ */
+template <typename WorkerType>
+void write_stats_file(const std::string& path,
+                      const std::vector<std::unique_ptr<WorkerType>>& workers,
+                      const drop_accounting& drops, double duration_s) {
+    std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+    if (!ofs) {
+        std::cerr << std::format("Failed to open stats file '{}' for writing\n", path);
+        return;
+    }
+    auto total = [&](single_writer_counter WorkerType::* counter) {
+        return worker_total(workers, counter);
+    };
+    auto per_second = [duration_s](uint64_t count) {
+        return duration_s > 0.0 ? static_cast<double>(count) / duration_s : 0.0;
+    };
+    auto write_array = [&](const char* name, const std::vector<uint64_t>& values) {
+        ofs << std::format("  \"{}\": [", name);
+        for (size_t w = 0; w < values.size(); ++w) {
+            ofs << std::format("{}{}", w == 0 ? "" : ", ", values[w]);
+        }
+        ofs << "],\n";
+    };
+
+    const uint64_t received = total(&WorkerType::packets_received);
+    const uint64_t sent = total(&WorkerType::packets_sent);
+    const udp_counters os = drops.os_totals();
+    ofs << "{\n";
+    ofs << std::format("  \"duration_s\": {:.2f},\n", duration_s);
+    ofs << std::format("  \"packets_received\": {},\n", received);
+    ofs << std::format("  \"packets_sent\": {},\n", sent);
+    ofs << std::format("  \"bytes_received\": {},\n", total(&WorkerType::bytes_received));
+    ofs << std::format("  \"bytes_sent\": {},\n", total(&WorkerType::bytes_sent));
+    ofs << std::format("  \"pps_recv\": {:.2f},\n", per_second(received));
+    ofs << std::format("  \"pps_sent\": {:.2f},\n", per_second(sent));
+    ofs << std::format("  \"send_calls\": {},\n", total(&WorkerType::send_calls));
+    ofs << std::format("  \"echoes_dropped\": {},\n", total(&WorkerType::echoes_dropped));
+    ofs << std::format("  \"send_pool_empty\": {},\n", total(&WorkerType::send_pool_empty));
+    ofs << std::format("  \"send_errors\": {},\n", total(&WorkerType::send_errors));
+    ofs << std::format("  \"recv_errors\": {},\n", total(&WorkerType::recv_errors));
+    ofs << std::format("  \"repost_failures\": {},\n", total(&WorkerType::repost_failures));
+    ofs << std::format("  \"drained_sends\": {},\n", total(&WorkerType::drained_sends));
+    ofs << std::format("  \"abandoned_sends\": {},\n", total(&WorkerType::abandoned_sends));
+    ofs << std::format("  \"os_udp_available\": {},\n", drops.os_available());
+    ofs << std::format("  \"os_udp_in_datagrams\": {},\n", os.in_datagrams);
+    ofs << std::format("  \"os_udp_in_errors\": {},\n", os.in_errors);
+    ofs << std::format("  \"os_udp_no_ports\": {},\n", os.no_ports);
+    ofs << std::format("  \"os_udp_out_datagrams\": {},\n", os.out_datagrams);
+    write_array("os_udp_in_errors_per_window", drops.os_in_errors_per_window);
+    write_array("echoes_dropped_per_window", drops.echoes_dropped_per_window);
+    const shard_balance balance = compute_shard_balance(shard_received(workers));
+    ofs << std::format(
+        "  \"shard_balance\": {{\"max_ratio\": {:.3f}, \"max_cpu\": {}, \"min_ratio\": {:.3f}, "
+        "\"min_cpu\": {}, \"cov\": {:.3f}}},\n",
+        balance.max_ratio, balance.max_cpu, balance.min_ratio, balance.min_cpu, balance.cov);
+
+    // Per-shard counters, last so the top-level fields come first.
+    const auto shard_sent = shard_totals(workers, &WorkerType::packets_sent);
+    const auto shard_dropped = shard_totals(workers, &WorkerType::echoes_dropped);
+    const auto shard_pool_empty = shard_totals(workers, &WorkerType::send_pool_empty);
+    const auto shard_send_errors = shard_totals(workers, &WorkerType::send_errors);
+    const auto shard_recv_errors = shard_totals(workers, &WorkerType::recv_errors);
+    const auto shard_repost_failures = shard_totals(workers, &WorkerType::repost_failures);
+    ofs << "  \"shards\": [\n";
+    for (size_t i = 0; i < balance.received.size(); ++i) {
+        ofs << std::format(
+            "    {{\"cpu\": {}, \"packets_received\": {}, \"packets_sent\": {}, "
+            "\"echoes_dropped\": {}, \"send_pool_empty\": {}, \"send_errors\": {}, "
+            "\"recv_errors\": {}, \"repost_failures\": {}}}{}\n",
+            balance.received[i].first, balance.received[i].second, shard_sent[i].second,
+            shard_dropped[i].second, shard_pool_empty[i].second, shard_send_errors[i].second,
+            shard_recv_errors[i].second, shard_repost_failures[i].second,
+            i + 1 < balance.received.size() ? "," : "");
+    }
+    ofs << "  ]\n";
+    ofs << "}\n";
+    ofs.close();
+    if (g_config.verbose) std::cout << std::format("Wrote JSON stats to {}\n", path);
 }
 
 /**
@@ -296,16 +478,13 @@ void cleanup_workers(std::vector<std::unique_ptr<WorkerType>>& workers) {
 }
 
 /**
- * @brief Close all IOCPs to wake up worker threads.
- * Works for IOCP-based worker contexts only.
+ * @brief Wake worker threads blocked on their IOCP so they notice shutdown.
+ *
+ * See `wake_server_worker`: workers can still collect the completions of
+ * in-flight sends while they drain.
  */
-template <typename WorkerType>
-void close_iocps(std::vector<std::unique_ptr<WorkerType>>& workers) {
-    for (const auto& ctx : workers) {
-        if constexpr (requires { ctx->iocp; }) {
-            ctx->iocp.reset();
-        }
-    }
+void wake_workers(std::vector<std::unique_ptr<server_worker_context>>& workers) {
+    for (const auto& ctx : workers) wake_server_worker(*ctx);
 }
 
 /**
@@ -320,10 +499,52 @@ int main(int argc, char* argv[]) try {
     parser.add_option("port", 'p', "7", true, " UDP port to listen on (default: 7)");
     parser.add_option("duration", 'd', "0", true, "Run for N seconds then exit (0 = unlimited)");
     parser.add_option("cores", 'c', "0", true, "Number of cores to use (default: all available)");
+    parser.add_option("placement", '\0', "compact", true,
+                      "Worker placement: compact|spread|nic-local (default: compact)");
+    parser.add_option("cpus", '\0', "", true,
+                      "Explicit worker CPUs, e.g. 0-3,8 (overrides --cores and --placement)");
+    parser.add_option("nic-address", '\0', "", true,
+                      "Local address of the NIC whose RSS processors --placement nic-local uses");
     parser.add_option("recvbuf", 'b', "4194304", true,
                       "Socket receive buffer size in bytes (default: 4194304 = 4MB)");
     parser.add_option("sync-reply", 's', "0", false,
                       "Reply synchronously using sendto (default: async IO)");
+    parser.add_option("zero-copy", 'z', "0", false,
+                      "Echo from the receive buffer without copying into a send context");
+    parser.add_option("uro", 'u', "0", false,
+                      "Enable UDP receive coalescing (URO) and echo each coalesced segment");
+    parser.add_option("uso", 'g', "0", false,
+                      "Batch same-peer echoes with UDP send segmentation offload (USO)");
+    parser.add_option("engine", 'e', "iocp", true,
+                      "I/O engine: iocp|rio (default: iocp, rio = Registered I/O)");
+    parser.add_option("handler", 'H', "echo", true,
+                      "Per-datagram handler: echo|discard|timestamp (default: echo)");
+    parser.add_option("rx-timestamps", 'T', "0", false,
+                      "Use stack receive timestamps for --handler timestamp (IOCP engine)");
+    parser.add_option("clock", '\0', "qpc", true,
+                      "Timestamp counter: qpc|tsc (tsc needs an invariant TSC; default: qpc)");
+    parser.add_option("rio-poll", 'P', "0", false,
+                      "RIO engine: busy-poll completion queues instead of IOCP notification");
+    parser.add_option("dual-stack", 'D', "0", false,
+                      "One dual-stack IPv6 socket per core instead of separate IPv4/IPv6 workers");
+    parser.add_option("spin-us", 'S', "0", true,
+                      "Busy-poll N us after the last completion before blocking (IOCP engine)");
+    parser.add_option("depth", 'q', std::to_string(DEFAULT_OUTSTANDING_OPS), true,
+                      "Receives kept posted per socket (default: 16)");
+    parser.add_option("adaptive-depth", 'a', "0", false,
+                      "Grow/shrink the depth per worker from observed load (IOCP engine)");
+    parser.add_option("min-depth", '\0', "4", true,
+                      "Lower bound for --adaptive-depth (default: 4)");
+    parser.add_option("max-depth", '\0', "1024", true,
+                      "Upper bound for --adaptive-depth (default: 1024)");
+    parser.add_option("max-datagram", 'm', std::to_string(MAX_PACKET_SIZE), true,
+                      "Largest datagram in bytes; sizes per-I/O buffers (default: 65507)");
+    parser.add_option("stats-stream", '\0', "", true,
+                      "Per-second per-worker samples to "
+                      "csv:FILE|ndjson:FILE|udp:HOST:PORT|pipe:NAME");
+    parser.add_option("stats-file", 'o', "", true, "Output final statistics to FILE as JSON");
+    parser.add_option("drain-ms", '\0', "1000", true,
+                      "At shutdown, complete in-flight echoes for up to N ms (default: 1000)");
     parser.add_option("help", 'h', "0", false, "Show this help");
     parser.parse(argc, argv);
 
@@ -338,15 +559,78 @@ int main(int argc, char* argv[]) try {
     const std::string duration_str = parser.get("duration");
     const std::string verbose_str = parser.get("verbose");
     const std::string sync_reply_str = parser.get("sync-reply");
+    const std::string engine_str = parser.get("engine");
+    const std::string handler_str = parser.get("handler");
+    const std::string depth_str = parser.get("depth");
+    const std::string max_datagram_str = parser.get("max-datagram");
+    const std::string min_depth_str = parser.get("min-depth");
+    const std::string spin_us_str = parser.get("spin-us");
+    const std::string drain_ms_str = parser.get("drain-ms");
+    const std::string max_depth_str = parser.get("max-depth");
+    const std::string stats_stream_spec = parser.get("stats-stream");
+    const std::string stats_file = parser.get("stats-file");
     if (!verbose_str.empty() && verbose_str != "0") {
-        g_verbose.store(true);
+        g_config.verbose = true;
     }
     if (!sync_reply_str.empty() && sync_reply_str != "0") {
-        g_sync_reply.store(true);
+        g_config.sync_reply = true;
+    }
+    if (parser.is_set("zero-copy")) {
+        g_config.zero_copy = true;
+    }
+    if (parser.is_set("uro")) {
+        g_config.uro = true;
+    }
+    if (parser.is_set("uso")) {
+        g_config.uso = true;
     }
     if (port_str.empty()) {
         throw std::invalid_argument("Port number is required");
     }
+    if (engine_str == "rio") {
+        g_config.engine = server_engine::rio;
+    } else if (engine_str != "iocp") {
+        throw std::invalid_argument(
+            std::format("Unknown engine: {} (valid: iocp|rio)", engine_str));
+    }
+    if (handler_str == "discard") {
+        g_config.handler = server_handler::discard;
+    } else if (handler_str == "timestamp") {
+        g_config.handler = server_handler::timestamp;
+    } else if (handler_str != "echo") {
+        throw std::invalid_argument(
+            std::format("Unknown handler: {} (valid: echo|discard|timestamp)", handler_str));
+    }
+    if (parser.is_set("rx-timestamps")) {
+        g_config.rx_timestamps = true;
+    }
+    timestamp_source requested_clock = parse_timestamp_source(parser.get("clock"));
+    // Stack receive timestamps are QPC readings; a TSC clock would drift against them.
+    if (requested_clock == timestamp_source::tsc && g_config.rx_timestamps) {
+        std::cerr << "--clock tsc is ignored with --rx-timestamps (stack timestamps are QPC)\n";
+        requested_clock = timestamp_source::qpc;
+    }
+    if (parser.is_set("rio-poll")) {
+        g_config.rio_poll = true;
+    }
+    if (parser.is_set("dual-stack")) {
+        g_config.dual_stack = true;
+    }
+    if (g_config.engine == server_engine::rio && g_config.sync_reply) {
+        std::cerr << "--sync-reply is ignored by the RIO engine\n";
+    }
+    if (g_config.engine == server_engine::rio && (g_config.uro || g_config.uso)) {
+        std::cerr << "--uro and --uso are ignored by the RIO engine\n";
+    }
+    if (g_config.engine == server_engine::rio && g_config.handler != server_handler::echo) {
+        std::cerr << "--handler is ignored by the RIO engine (it always echoes)\n";
+    }
+    if (g_config.uso && g_config.sync_reply) {
+        std::cerr << "--uso is ignored with --sync-reply\n";
+    }
+    if (g_config.uso && g_config.zero_copy) {
+        std::cerr << "--zero-copy is ignored with --uso (echoes are copied into USO batches)\n";
+    }
 
     char* endptr = nullptr;
     long port_l = std::strtol(port_str.c_str(), &endptr, 10);
@@ -355,7 +639,8 @@ int main(int argc, char* argv[]) try {
     }
     int port = static_cast<int>(port_l);
 
-    uint32_t num_processors = get_processor_count();
+    const processor_topology topology = processor_topology::discover();
+    uint32_t num_processors = static_cast<uint32_t>(topology.processors.size());
     uint32_t num_workers = num_processors;
     if (!cores_str.empty()) {
         int requested = static_cast<int>(std::strtol(cores_str.c_str(), nullptr, 10));
@@ -363,14 +648,69 @@ int main(int argc, char* argv[]) try {
             num_workers = static_cast<uint32_t>(requested);
         }
     }
+    const placement_policy placement = parse_placement_policy(parser.get("placement"));
+    const std::vector<uint32_t> cpu_list =
+        parser.is_set("cpus") ? parse_cpu_list(parser.get("cpus")) : std::vector<uint32_t>{};
+    if (!cpu_list.empty()) num_workers = static_cast<uint32_t>(cpu_list.size());
+    const std::string nic_address_str = parser.get("nic-address");
 
-    // Parse receive buffer size
-    int recvbuf = 4194304;  // default 4MB
+    // Parse receive buffer size (default 4MB)
     if (!recvbuf_str.empty()) {
         long v = std::strtol(recvbuf_str.c_str(), nullptr, 10);
-        if (v > 0) recvbuf = static_cast<int>(v);
+        if (v > 0) g_config.recvbuf = static_cast<int>(v);
     }
 
+    // Parse outstanding depth and maximum datagram size
+    long depth_l = std::strtol(depth_str.c_str(), &endptr, 10);
+    if (endptr == depth_str.c_str() || depth_l <= 0 ||
+        static_cast<size_t>(depth_l) > MAX_OUTSTANDING_OPS) {
+        throw std::invalid_argument(
+            std::format("Invalid depth (valid: 1-{})", MAX_OUTSTANDING_OPS));
+    }
+    g_config.depth = static_cast<size_t>(depth_l);
+    if (parser.is_set("adaptive-depth")) {
+        g_config.adaptive_depth = true;
+        long min_l = std::strtol(min_depth_str.c_str(), &endptr, 10);
+        const bool min_ok = endptr != min_depth_str.c_str() && min_l > 0;
+        long max_l = std::strtol(max_depth_str.c_str(), &endptr, 10);
+        const bool max_ok = endptr != max_depth_str.c_str() && max_l >= min_l &&
+                            static_cast<size_t>(max_l) <= MAX_OUTSTANDING_OPS;
+        if (!min_ok || !max_ok) {
+            throw std::invalid_argument(std::format(
+                "Invalid adaptive depth bounds (valid: 1 <= min-depth <= max-depth <= {})",
+                MAX_OUTSTANDING_OPS));
+        }
+        g_config.min_depth = static_cast<size_t>(min_l);
+        g_config.max_depth = static_cast<size_t>(max_l);
+        if (g_config.engine == server_engine::rio) {
+            std::cerr << "--adaptive-depth is ignored by the RIO engine\n";
+        }
+    }
+    long max_datagram_l = std::strtol(max_datagram_str.c_str(), &endptr, 10);
+    if (endptr == max_datagram_str.c_str() || max_datagram_l <= 0 ||
+        static_cast<size_t>(max_datagram_l) > MAX_PACKET_SIZE) {
+        throw std::invalid_argument(
+            std::format("Invalid max datagram size (valid: 1-{})", MAX_PACKET_SIZE));
+    }
+    g_config.max_datagram = static_cast<size_t>(max_datagram_l);
+
+    // Parse busy-poll budget (microseconds)
+    long long spin_us = std::strtoll(spin_us_str.c_str(), &endptr, 10);
+    if (endptr == spin_us_str.c_str() || spin_us < 0) {
+        throw std::invalid_argument("Invalid spin budget");
+    }
+    g_config.spin_ns = static_cast<uint64_t>(spin_us) * 1000;
+    if (g_config.spin_ns > 0 && g_config.engine == server_engine::rio) {
+        std::cerr << "--spin-us is ignored by the RIO engine (use --rio-poll)\n";
+    }
+
+    // Parse the shutdown drain timeout (milliseconds, 0 = stop at once)
+    long long drain_ms = std::strtoll(drain_ms_str.c_str(), &endptr, 10);
+    if (endptr == drain_ms_str.c_str() || *endptr != '\0' || drain_ms < 0) {
+        throw std::invalid_argument("Invalid drain timeout");
+    }
+    g_config.drain_ns = static_cast<uint64_t>(drain_ms) * 1'000'000ULL;
+
     // Parse optional duration (seconds)
     int duration_sec = 0;
     if (!duration_str.empty()) {
@@ -381,60 +721,142 @@ int main(int argc, char* argv[]) try {
     std::cout << std::format("Scalable UDP Echo Server\n");
     std::cout << std::format("Port: {}\n", port);
     std::cout << std::format("Available processors: {}\n", num_processors);
-    std::cout << std::format("Using {} worker(s)\n", num_workers);
+    std::cout << std::format("Using {} worker(s){}\n", num_workers,
+                             g_config.dual_stack ? ", one dual-stack socket each"
+                                                 : ", one IPv4 and one IPv6 socket each");
+    std::cout << std::format(
+        "Engine: {}{}, handler: {}\n", engine_str,
+        g_config.engine == server_engine::rio && g_config.rio_poll ? " (polled)" : "",
+        g_config.engine == server_engine::rio ? "echo" : handler_str);
+    std::cout << std::format("Depth: {}{}, max datagram: {} bytes\n", g_config.depth,
+                             g_config.adaptive_depth && g_config.engine == server_engine::iocp
+                                 ? std::format(" (adaptive {}-{})", g_config.min_depth,
+                                               g_config.max_depth)
+                                 : "",
+                             g_config.max_datagram);
+    // Select the clock before any worker takes a timestamp.
+    const timestamp_source clock = set_timestamp_source(requested_clock);
+    std::cout << std::format("Clock: {} ({:.3f} MHz){}\n", timestamp_source_name(clock),
+                             static_cast<double>(timestamp_frequency_hz()) / 1e6,
+                             clock != requested_clock ? ", no invariant TSC" : "");
 
     // Initialize Winsock
     initialize_winsock();
 
+    // Place the workers. nic-local needs the NIC's RSS processors, found
+    // through a probe socket bound to one of its addresses.
+    std::vector<uint32_t> rss_processors;
+    if (placement == placement_policy::nic_local && cpu_list.empty()) {
+        sockaddr_storage nic_addr = {};
+        int nic_addr_len = 0;
+        auto* nic_v4 = reinterpret_cast<sockaddr_in*>(&nic_addr);
+        auto* nic_v6 = reinterpret_cast<sockaddr_in6*>(&nic_addr);
+        if (inet_pton(AF_INET, nic_address_str.c_str(), &nic_v4->sin_addr) == 1) {
+            nic_v4->sin_family = AF_INET;
+            nic_addr_len = sizeof(sockaddr_in);
+        } else if (inet_pton(AF_INET6, nic_address_str.c_str(), &nic_v6->sin6_addr) == 1) {
+            nic_v6->sin6_family = AF_INET6;
+            nic_addr_len = sizeof(sockaddr_in6);
+        }
+        if (nic_addr_len != 0) {
+            rss_processors = query_interface_rss_processors(reinterpret_cast<sockaddr*>(&nic_addr),
+                                                            nic_addr_len, true, topology);
+        }
+        if (rss_processors.empty()) {
+            std::cerr << (nic_address_str.empty()
+                              ? "--placement nic-local needs --nic-address; using compact\n"
+                              : std::format("No RSS processors reported for {}; using compact\n",
+                                            nic_address_str));
+        }
+    }
+    const std::vector<logical_processor> worker_cpus =
+        select_worker_processors(topology, placement, num_workers, rss_processors, cpu_list);
+    std::cout << std::format("Placement: {} over {} NUMA node(s) in {} processor group(s)\n",
+                             cpu_list.empty() ? placement_policy_name(placement) : "cpu list",
+                             topology.numa_node_count, topology.group_count);
+    if (g_config.verbose) {
+        for (const auto& cpu : worker_cpus) {
+            std::cout << std::format("  CPU {} (group {}, number {}, node {}){}\n", cpu.index,
+                                     cpu.group, cpu.number, cpu.numa_node,
+                                     std::find(rss_processors.begin(), rss_processors.end(),
+                                               cpu.index) != rss_processors.end()
+                                         ? " RSS"
+                                         : "");
+        }
+    }
+
+    // Make the ETW provider visible to trace sessions for the rest of the run.
+    trace_provider_registration trace_registration;
+
+    // Open the time-series destination before the RPS thread samples into it.
+    if (!stats_stream_spec.empty()) {
+        g_stats_stream = std::make_unique<stats_stream>(stats_stream_spec);
+    }
+
     // Set up signal handler
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
 
     std::vector<std::unique_ptr<server_worker_context>> workers;
 
-    // Helper to create and initialize a single worker context for a given CPU id.
-    auto create_worker = [&](uint32_t cpu_id,
-                             int address_family) -> std::unique_ptr<server_worker_context> {
-        auto ctx = std::make_unique<server_worker_context>();
-        ctx->processor_id = cpu_id;
-
-        ctx->socket = create_udp_socket(address_family);
-
-        set_socket_cpu_affinity(ctx->socket, static_cast<uint16_t>(cpu_id));
-
-        // Increase socket buffers.
-        set_socket_option(ctx->socket, SOL_SOCKET, SO_RCVBUF,
-                          reinterpret_cast<const char*>(&recvbuf), sizeof(recvbuf));
-        set_socket_option(ctx->socket, SOL_SOCKET, SO_SNDBUF,
-                          reinterpret_cast<const char*>(&recvbuf), sizeof(recvbuf));
-
-        // Bind socket to the requested port
-        bind_socket(ctx->socket, static_cast<uint16_t>(port), address_family);
-
-        // Create IOCP and associate socket
-        ctx->iocp = create_iocp_and_associate(ctx->socket);
-
-        if (g_verbose.load())
-            std::osyncstream(std::cout)
-                << std::format("Created socket and IOCP for CPU {}\n", cpu_id);
-        return ctx;
-    };
-
-    for (uint32_t i = 0; i < num_workers; ++i) {
-        // Start one worker per address family per CPU
-        workers.push_back(create_worker(i, AF_INET));
-        workers.push_back(create_worker(i, AF_INET6));
+    // Set up every CPU's shard in parallel, each on a thread pinned to that
+    // CPU: serial setup takes noticeable time on large machines, and the
+    // contexts, sockets and IOCPs are then allocated (first touched) from the
+    // shard's own NUMA node.
+    const auto init_start = std::chrono::steady_clock::now();
+    std::vector<std::vector<std::unique_ptr<server_worker_context>>> shard_workers(
+        worker_cpus.size());
+    std::vector<std::exception_ptr> init_errors(worker_cpus.size());
+    {
+        std::vector<std::jthread> init_threads;
+        init_threads.reserve(worker_cpus.size());
+        for (size_t i = 0; i < worker_cpus.size(); ++i) {
+            init_threads.emplace_back([&, i]() {
+                try {
+                    const logical_processor& cpu = worker_cpus[i];
+                    set_thread_affinity(cpu.index);
+                    // One worker per address family per CPU, or a single dual-stack
+                    // worker so each CPU is serviced by exactly one thread.
+                    const auto worker_port = static_cast<uint16_t>(port);
+                    if (!g_config.dual_stack) {
+                        shard_workers[i].push_back(
+                            create_server_worker(g_config, cpu, AF_INET, worker_port));
+                    }
+                    shard_workers[i].push_back(
+                        create_server_worker(g_config, cpu, AF_INET6, worker_port));
+                } catch (...) {
+                    init_errors[i] = std::current_exception();
+                }
+            });
+        }
+    }
+    for (const auto& error : init_errors) {
+        if (error) std::rethrow_exception(error);
+    }
+    for (auto& shard : shard_workers) {
+        for (auto& ctx : shard) workers.push_back(std::move(ctx));
     }
 
     if (workers.empty()) {
         throw std::runtime_error("No worker contexts created");
     }
 
-    // Start worker threads
+    // Start worker threads.
     for (auto& ctx : workers) {
-        ctx->worker_thread = std::jthread(worker_thread_func, ctx.get());
+        ctx->worker_thread = std::jthread(server_worker_thread_func, ctx.get());
     }
 
+    // Ready once every worker has its receives posted (or shutdown began early).
+    while (g_config.workers_ready.load() < workers.size() && !g_config.shutdown.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!g_config.shutdown.load()) {
+        std::osyncstream(std::cout) << std::format(
+            "Server ready: {} worker(s) in {:.1f} ms\n", workers.size(),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                      init_start)
+                .count());
+    }
     std::osyncstream(std::cout) << std::format(
         "\nServer running on port {}. Press Ctrl+C to stop.\n\n", port);
 
@@ -443,17 +865,29 @@ int main(int argc, char* argv[]) try {
     if (duration_sec > 0) {
         duration_thread = std::thread([duration_sec]() {
             std::this_thread::sleep_for(std::chrono::seconds(duration_sec));
-            g_shutdown.store(true);
+            g_config.shutdown.store(true);
         });
     }
 
+    // Sample the host's UDP counters for each address family in use.
+    drop_accounting drops;
+    for (int family : {AF_INET, AF_INET6}) {
+        if (std::any_of(workers.begin(), workers.end(),
+                        [family](const auto& ctx) { return ctx->address_family == family; })) {
+            drops.os_udp.emplace_back(family);
+        }
+    }
+    const auto run_start = std::chrono::steady_clock::now();
+
     // RPS printer thread
-    std::thread rps_thread = create_rps_thread(workers);
+    std::thread rps_thread = create_rps_thread(workers, drops);
 
     // Wait for shutdown signal (main thread sleeps while RPS thread runs)
-    while (!g_shutdown.load()) {
+    while (!g_config.shutdown.load()) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
+    const double duration_s =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
 
     // Join the RPS thread so it exits cleanly before we teardown workers
     if (rps_thread.joinable()) rps_thread.join();
@@ -463,10 +897,16 @@ int main(int argc, char* argv[]) try {
 
     std::osyncstream(std::cout) << "\nShutting down...\n";
 
-    // Close IOCPs to wake up worker threads, then cleanup and print stats
-    close_iocps(workers);
+    // Wake the workers; each drains its in-flight echoes (--drain-ms) and exits.
+    wake_workers(workers);
     cleanup_workers(workers);
-    print_final_stats(workers);
+    // Take in the drops since the RPS thread's last sample.
+    drops.sample();
+    print_final_stats(workers, drops);
+    if (g_stats_stream && g_stats_stream->dropped() > 0) {
+        std::cerr << std::format("Stats stream dropped {} samples\n", g_stats_stream->dropped());
+    }
+    if (!stats_file.empty()) write_stats_file(stats_file, workers, drops, duration_s);
 
     cleanup_winsock();
     return 0;
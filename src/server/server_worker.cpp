@@ -0,0 +1,976 @@
+/**
+ * @file server_worker.cpp
+ * @brief Server worker completion loops: the IOCP engine (per handler) and the RIO engine.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "server_worker.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <syncstream>
+#include <vector>
+
+#include "common/adaptive_depth.hpp"
+#include "common/io_context_pool.hpp"
+#include "common/packet_handler.hpp"
+#include "common/rio_utils.hpp"
+#include "common/tracing.hpp"
+
+/**
+ * @brief Shutdown drain of one worker (`--drain-ms`).
+ *
+ * Once shutdown is requested the worker stops reposting receives but keeps
+ * completing the echoes already in flight, until none are left or the drain
+ * timeout passes, so that clients still get the replies to what they sent.
+ */
+struct shutdown_drain {
+    const server_config& config;
+    /// Echo sends posted and not yet completed.
+    size_t sends_in_flight{0};
+    /// Whether shutdown has been requested and the worker is draining.
+    bool active{false};
+    uint64_t start_ns{0};
+    uint64_t drained_sends{0};
+
+    /**
+     * @brief Start draining once shutdown is requested.
+     *
+     * @return true when the worker should stop: no sends are left in flight
+     *         or the drain timed out.
+     */
+    bool done(uint64_t now_ns) {
+        if (!active) {
+            if (!config.shutdown.load()) return false;
+            active = true;
+            start_ns = now_ns;
+        }
+        return sends_in_flight == 0 || now_ns - start_ns >= config.drain_ns;
+    }
+
+    void on_send_posted() { ++sends_in_flight; }
+
+    void on_send_completed() {
+        --sends_in_flight;
+        if (active) ++drained_sends;
+    }
+
+    /// Publish the drain counters to the worker context.
+    void publish(server_worker_context* ctx, uint64_t now_ns) const {
+        ctx->drained_sends.store(drained_sends);
+        ctx->abandoned_sends.store(sends_in_flight);
+        ctx->drain_ns.store(active ? now_ns - start_ns : 0);
+    }
+};
+
+/// GetQueuedCompletionStatus(Ex) timeout while draining, so the drain timeout is honoured.
+constexpr DWORD DRAIN_POLL_MS = 10;
+
+/**
+ * @brief Contexts of one kind, in NUMA-local pools added one per depth growth step.
+ *
+ * `idle` holds the contexts that are neither posted nor in flight. When the
+ * capacity needed drops to the base of the newest pool, that pool retires:
+ * its idle contexts leave `idle`, the rest are held back as they come home,
+ * and the pool is freed once all of them are back. The first pool is kept.
+ */
+class context_pool_stack {
+   public:
+    context_pool_stack(size_t buffer_size, uint32_t numa_node)
+        : buffer_size_(buffer_size), numa_node_(numa_node) {}
+
+    /// Contexts not currently posted or in flight.
+    std::vector<io_context*> idle;
+
+    /// Grow to `needed` contexts, or start retiring pools no longer needed.
+    void resize(size_t needed) {
+        needed_ = needed;
+        if (retiring_ && needed_ > capacity_ - pools_.back()->size()) {
+            idle.insert(idle.end(), retired_.begin(), retired_.end());
+            retired_.clear();
+            retiring_ = false;
+        }
+        if (capacity_ < needed_) {
+            auto pool =
+                std::make_unique<io_context_pool>(needed_ - capacity_, buffer_size_, numa_node_);
+            for (auto& io_ctx : *pool) idle.push_back(&io_ctx);
+            pools_.push_back(std::move(pool));
+            capacity_ = needed_;
+        }
+        retire();
+    }
+
+    /// Return a context that is no longer posted or in flight.
+    void put(io_context* io_ctx) {
+        if (retiring(io_ctx)) {
+            retired_.push_back(io_ctx);
+            retire();
+        } else {
+            idle.push_back(io_ctx);
+        }
+    }
+
+    /// True if `io_ctx` belongs to a pool being retired and should not be posted again.
+    bool retiring(const io_context* io_ctx) const {
+        return retiring_ && pools_.back()->contains(io_ctx);
+    }
+
+    /// True if `io_ctx` is one of these contexts.
+    bool contains(const io_context* io_ctx) const {
+        return std::any_of(pools_.begin(), pools_.end(),
+                           [io_ctx](const auto& pool) { return pool->contains(io_ctx); });
+    }
+
+    /// The first pool, allocated by the initial `resize`.
+    const io_context_pool& front() const { return *pools_.front(); }
+
+    /// Give up ownership of every pool, for when the kernel may still write into them.
+    void leak() {
+        for (auto& pool : pools_) static_cast<void>(pool.release());
+    }
+
+   private:
+    void retire() {
+        while (pools_.size() > 1) {
+            const io_context_pool& newest = *pools_.back();
+            if (!retiring_) {
+                if (needed_ > capacity_ - newest.size()) return;
+                retiring_ = true;
+                auto held = std::stable_partition(idle.begin(), idle.end(), [&](io_context* c) {
+                    return !newest.contains(c);
+                });
+                retired_.insert(retired_.end(), held, idle.end());
+                idle.erase(held, idle.end());
+            }
+            if (retired_.size() < newest.size()) return;
+            capacity_ -= newest.size();
+            retired_.clear();
+            retiring_ = false;
+            pools_.pop_back();
+        }
+    }
+
+    size_t buffer_size_;
+    uint32_t numa_node_;
+    std::vector<std::unique_ptr<io_context_pool>> pools_;
+    size_t capacity_{0};
+    size_t needed_{0};
+    /// Contexts of the retiring pool that have come home.
+    std::vector<io_context*> retired_;
+    bool retiring_{false};
+};
+
+/**
+ * @brief Worker thread entrypoint for the server.
+ *
+ * Pins the thread, posts initial receives, and loops processing IOCP
+ * completions for receives and sends. Each received datagram is passed to
+ * `Handler`, whose verdict decides whether it is echoed back, forwarded or
+ * dropped (`--handler`).
+ *
+ * @tparam Handler Per-datagram handler, inlined into the completion loop.
+ */
+template <PacketHandlerConcept Handler>
+void worker_thread_func(server_worker_context* ctx) try {
+    server_config& config = *ctx->config;
+    // Set thread affinity to match socket affinity
+    set_thread_affinity(ctx->processor_id);
+
+    // In zero-copy mode each receive context doubles as the echo send, so
+    // allocate a spare set of receive contexts. The send pool is still needed
+    // with URO, where a multi-segment completion cannot be echoed in place.
+    const bool uro = config.uro;
+    // USO batching copies echoes into a shared send buffer, so it supersedes zero-copy.
+    bool uso = config.uso && !config.sync_reply;
+    if (uso && !is_udp_send_segmentation_supported(ctx->socket)) {
+        std::osyncstream(std::cerr) << std::format(
+            "[CPU {}] UDP send segmentation not supported, sending one datagram per send\n",
+            ctx->processor_id);
+        uso = false;
+    }
+    const bool zero_copy = config.zero_copy && !uso;
+    bool rx_timestamps = config.rx_timestamps;
+    if (rx_timestamps && !enable_rx_timestamps(ctx->socket)) {
+        std::osyncstream(std::cerr) << std::format(
+            "[CPU {}] Receive timestamps not supported, using dequeue time\n", ctx->processor_id);
+        rx_timestamps = false;
+    }
+    adaptive_depth depth_ctl(config.depth, config.min_depth, config.max_depth,
+                             config.adaptive_depth);
+    ctx->depth.store(depth_ctl.depth());
+    Handler handler;
+
+    // Receive and send contexts come from slabs on this worker's NUMA node.
+    // Buffers are sized to --max-datagram, except where one operation carries
+    // several datagrams: coalesced (URO) receives and segmented (USO) sends
+    // use full-size buffers. Each pool is
+    // contiguous so send completions of in-place echoes can be routed back to
+    // the receive pools. An adaptive depth adds a pool per growth step and
+    // frees it again once the depth has dropped back and its contexts are idle.
+    const size_t recv_buffer_size = uro ? MAX_PACKET_SIZE : config.max_datagram;
+    const size_t send_buffer_size = uso ? MAX_PACKET_SIZE : config.max_datagram;
+    const bool use_send_pool = !zero_copy || uro;
+    context_pool_stack recv_contexts(recv_buffer_size, ctx->numa_node);
+    context_pool_stack send_contexts(send_buffer_size, ctx->numa_node);
+    std::vector<io_context*>& available_send_contexts = send_contexts.idle;
+    // Receive contexts not currently posted.
+    std::vector<io_context*>& spare_recv_contexts = recv_contexts.idle;
+
+    // Size the pools to back the current depth.
+    auto ensure_capacity = [&]() {
+        const size_t depth = depth_ctl.depth();
+        recv_contexts.resize(zero_copy ? depth * 2 : depth);
+        if (use_send_pool) send_contexts.resize(depth);
+    };
+    ensure_capacity();
+
+    size_t posted_recvs = 0;
+    shutdown_drain drain{config};
+    // A receive that fails to post stays spare, and a later top-up retries it.
+    auto repost_recv = [&](io_context* recv_ctx) {
+        if (const int error = post_recv(ctx->socket, recv_ctx); error != 0) {
+            trace_repost_failed(ctx->processor_id, error);
+            ctx->repost_failures.add();
+            recv_contexts.put(recv_ctx);
+            return false;
+        }
+        ++posted_recvs;
+        return true;
+    };
+    // Repost a completed receive, or park it when the depth has shrunk, its
+    // pool is retiring or the worker is draining.
+    auto recycle_recv = [&](io_context* recv_ctx) {
+        if (!drain.active && posted_recvs < depth_ctl.depth() &&
+            !recv_contexts.retiring(recv_ctx)) {
+            repost_recv(recv_ctx);
+        } else {
+            recv_contexts.put(recv_ctx);
+        }
+    };
+    // Keep `depth` receives posted while spare receive contexts are available.
+    auto top_up_recvs = [&]() {
+        while (!drain.active && posted_recvs < depth_ctl.depth() &&
+               !spare_recv_contexts.empty()) {
+            io_context* recv_ctx = spare_recv_contexts.back();
+            spare_recv_contexts.pop_back();
+            if (!repost_recv(recv_ctx)) break;
+        }
+    };
+
+    // Post initial receive operations
+    top_up_recvs();
+    config.workers_ready.fetch_add(1);
+
+    if (config.verbose)
+        std::osyncstream(std::cout) << std::format(
+            "[CPU {}] Worker started, {} outstanding receives{}, context slab on node {}{}\n",
+            ctx->processor_id, depth_ctl.depth(),
+            depth_ctl.enabled()
+                ? std::format(" (adaptive {}-{})", config.min_depth, depth_ctl.max_depth())
+                : "",
+            recv_contexts.front().numa_node(),
+            recv_contexts.front().large_pages() ? " (large pages)" : "");
+
+    // Short helper lambdas to make the completion-processing loop clearer.
+    auto handle_recv_completion = [&](const io_context* io_ctx, DWORD bytes_transferred,
+                                      DWORD segments) {
+        // Update basic receive counters (each coalesced segment is one datagram)
+        ctx->packets_received.add(segments);
+        ctx->bytes_received.add(bytes_transferred);
+
+        // If we received data, hand it to the handler. The handler is the
+        // packet-processing area: it parses or rewrites the buffer and decides
+        // whether to reply, forward, or drop the packet. It runs inline on the
+        // IOCP worker, so it must stay extremely quick.
+        return bytes_transferred > 0;  // indicate that further handling is required
+    };
+
+    auto handle_send_completion = [&](const io_context* io_ctx) {
+        // Send completed — update counters and make context available again.
+        // The caller is responsible for returning the context to the pool.
+        return;
+    };
+
+    // Drops and send errors are counted; only the first of each is logged so
+    // that at high load they do not turn into a flood of stderr lines.
+    bool pool_empty_logged = false;
+    bool send_error_logged = false;
+    auto on_pool_empty = [&]() {
+        if (!pool_empty_logged) {
+            pool_empty_logged = true;
+            std::osyncstream(std::cerr) << std::format(
+                "[CPU {}] No available send context (further drops are only counted)\n",
+                ctx->processor_id);
+        }
+        depth_ctl.on_pool_empty();
+        ctx->send_pool_empty.add();
+        ctx->echoes_dropped.add();
+        trace_send_pool_empty(ctx->processor_id, depth_ctl.depth());
+    };
+    auto on_send_error = [&](const std::exception& ex, uint64_t echoes) {
+        if (!send_error_logged) {
+            send_error_logged = true;
+            std::osyncstream(std::cerr)
+                << std::format("[CPU {}] send failed: {} (further errors are only counted)\n",
+                               ctx->processor_id, ex.what());
+        }
+        ctx->send_errors.add();
+        ctx->echoes_dropped.add(echoes);
+    };
+
+    // Send `len` bytes at `data` to `dest`, either synchronously or by copying
+    // into a context from the send pool.
+    auto echo_copy = [&](const sockaddr* dest, int dest_len, const char* data, size_t len) {
+        if (config.sync_reply) {
+            try {
+                int sent = send_sync(ctx->socket, data, len, dest, dest_len);
+                ctx->packets_sent.add(1);
+                ctx->bytes_sent.add(sent);
+                ctx->send_calls.add(1);
+            } catch (const std::exception& ex) {
+                on_send_error(ex, 1);
+            }
+            return;
+        }
+
+        // Acquire a send context from the pool
+        if (available_send_contexts.empty()) {
+            // Drop the echo — do not block here
+            on_pool_empty();
+            return;
+        }
+        io_context* send_ctx = available_send_contexts.back();
+        available_send_contexts.pop_back();
+
+        // Echo the packet back — in a real server you would transform or
+        // generate an appropriate response instead of simply echoing.
+        try {
+            post_send(ctx->socket, send_ctx, data, len, dest, dest_len);
+        } catch (const socket_exception& ex) {
+            send_contexts.put(send_ctx);
+            on_send_error(ex, 1);
+            return;
+        }
+        drain.on_send_posted();
+        ctx->packets_sent.add(1);
+        ctx->bytes_sent.add(len);
+        ctx->send_calls.add(1);
+    };
+
+    // USO batch assembled from consecutive same-peer, same-size echoes within
+    // one GetQueuedCompletionStatusEx batch.
+    struct uso_batch {
+        io_context* send_ctx{nullptr};
+        int dest_len{0};
+        DWORD segment_size{0};
+        DWORD segments{0};
+        size_t length{0};
+    };
+    uso_batch batch;
+
+    auto flush_batch = [&]() {
+        if (batch.send_ctx == nullptr) return;
+        const auto* dest = reinterpret_cast<const sockaddr*>(&batch.send_ctx->remote_addr);
+        try {
+            if (batch.segments == 1) {
+                post_send_in_place(ctx->socket, batch.send_ctx, batch.length, dest,
+                                   batch.dest_len);
+            } else {
+                post_send_segmented(ctx->socket, batch.send_ctx, batch.length, batch.segment_size,
+                                    dest, batch.dest_len);
+            }
+        } catch (const socket_exception& ex) {
+            send_contexts.put(batch.send_ctx);
+            on_send_error(ex, batch.segments);
+            batch = {};
+            return;
+        }
+        drain.on_send_posted();
+        ctx->packets_sent.add(batch.segments);
+        ctx->bytes_sent.add(batch.length);
+        ctx->send_calls.add(1);
+        batch = {};
+    };
+
+    // Append one echo to the open batch, flushing first if the peer, size or
+    // capacity does not allow it.
+    auto echo_batched = [&](const io_context* io_ctx, const char* data, DWORD len) {
+        const int dest_len = io_ctx->remote_addr_len();
+        const bool same_peer = batch.send_ctx != nullptr && batch.dest_len == dest_len &&
+                               std::memcmp(&batch.send_ctx->remote_addr, &io_ctx->remote_addr,
+                                           static_cast<size_t>(dest_len)) == 0;
+        if (!same_peer || len > batch.segment_size || batch.segments >= MAX_USO_SEGMENTS ||
+            batch.length + len > batch.send_ctx->buffer.size()) {
+            flush_batch();
+        }
+
+        if (batch.send_ctx == nullptr) {
+            if (available_send_contexts.empty()) {
+                on_pool_empty();
+                return;
+            }
+            batch.send_ctx = available_send_contexts.back();
+            available_send_contexts.pop_back();
+            std::memcpy(&batch.send_ctx->remote_addr, &io_ctx->remote_addr,
+                        static_cast<size_t>(dest_len));
+            batch.dest_len = dest_len;
+            batch.segment_size = len;
+        }
+
+        std::memcpy(batch.send_ctx->buffer.data() + batch.length, data, len);
+        batch.length += len;
+        ++batch.segments;
+
+        // A shorter datagram can only be the last segment of a USO send.
+        if (len < batch.segment_size) flush_batch();
+    };
+
+    // Completion batch sized for the largest depth the worker may reach, so
+    // the dequeue size does not cap a grown depth.
+    const ULONG max_entries = static_cast<ULONG>(depth_ctl.max_depth() * 2);
+    std::vector<OVERLAPPED_ENTRY> entries(max_entries);
+
+    // With --spin-us, keep polling with zero-timeout dequeues for the spin
+    // budget after the last completion and only then block in the kernel;
+    // this avoids a wake-up and context switch each time the queue drains.
+    const uint64_t spin_budget_ns = config.spin_ns;
+    const uint64_t loop_start_ns = get_timestamp_ns();
+    uint64_t last_completion_ns = 0;
+    uint64_t spin_ns = 0;
+
+    while (true) {
+        const uint64_t now_ns = get_timestamp_ns();
+        // After shutdown the loop only runs to complete the echoes still in flight.
+        if (drain.done(now_ns)) break;
+
+        // Retry receives that failed to post earlier.
+        if (posted_recvs < depth_ctl.depth()) top_up_recvs();
+
+        if (depth_ctl.update(now_ns)) {
+            ctx->depth.store(depth_ctl.depth());
+            ensure_capacity();
+            top_up_recvs();
+            if (config.verbose)
+                std::osyncstream(std::cout) << std::format("[CPU {}] Depth now {}\n",
+                                                           ctx->processor_id, depth_ctl.depth());
+        }
+
+        const bool spinning = spin_budget_ns > 0 && last_completion_ns != 0 &&
+                              now_ns - last_completion_ns < spin_budget_ns;
+
+        // Use GetQueuedCompletionStatusEx to batch completions
+        ULONG num_removed = 0;
+
+        const DWORD block_ms = drain.active ? DRAIN_POLL_MS : IOCP_SHUTDOWN_TIMEOUT_MS;
+        BOOL ex_result = GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
+                                                     &num_removed, spinning ? 0 : block_ms, FALSE);
+
+        if (spin_budget_ns > 0) {
+            if (ex_result && num_removed > 0) {
+                last_completion_ns = get_timestamp_ns();
+            } else if (spinning) {
+                spin_ns += get_timestamp_ns() - now_ns;
+                YieldProcessor();
+            }
+        }
+
+        if (!ex_result) {
+            DWORD error = GetLastError();
+            if (error == WAIT_TIMEOUT) {
+                continue;
+            }
+            if (error == ERROR_ABANDONED_WAIT_0) {
+                // IOCP was closed, nothing more can complete
+                break;
+            }
+            std::osyncstream(std::cerr)
+                << std::format("[CPU {}] GetQueuedCompletionStatusEx failed with error: {}\n",
+                               ctx->processor_id, error);
+            continue;
+        }
+
+        if (num_removed == 0) continue;
+
+        // Receive time handed to the handler when the stack did not timestamp the datagram.
+        const uint64_t dequeue_ns = get_timestamp_ns();
+        size_t recv_completions = 0;
+        for (ULONG ei = 0; ei < num_removed; ++ei) {
+            const OVERLAPPED_ENTRY& entry = entries[ei];
+            DWORD bytes_transferred = entry.dwNumberOfBytesTransferred;
+            ULONG_PTR completion_key = entry.lpCompletionKey;
+            LPOVERLAPPED overlapped = entry.lpOverlapped;
+            if (overlapped == nullptr) continue;
+
+            auto* io_ctx = static_cast<io_context*>(overlapped);
+            // `Internal` holds the completion status (0 on success).
+            const bool failed = overlapped->Internal != 0;
+
+            if (io_ctx->operation == io_operation_type::recv) {
+                --posted_recvs;
+                ++recv_completions;
+                if (failed) {
+                    ctx->recv_errors.add();
+                    recycle_recv(io_ctx);
+                    continue;
+                }
+
+                // With URO one completion may carry several coalesced datagrams of
+                // `segment_size` bytes each; only the last one may be shorter.
+                DWORD segment_size = uro ? get_coalesced_segment_size(io_ctx) : 0;
+                if (segment_size == 0 || segment_size > bytes_transferred) {
+                    segment_size = bytes_transferred;
+                }
+                const DWORD segments =
+                    segment_size == 0 ? 1 : (bytes_transferred + segment_size - 1) / segment_size;
+
+                bool needs_send = handle_recv_completion(io_ctx, bytes_transferred, segments);
+                const auto* from = reinterpret_cast<const sockaddr*>(&io_ctx->remote_addr);
+                const int from_len = io_ctx->remote_addr_len();
+                const uint64_t stack_rx_ns = rx_timestamps ? get_rx_timestamp_ns(io_ctx) : 0;
+                datagram dgram{};
+                dgram.from = from;
+                dgram.from_len = from_len;
+                dgram.rx_timestamp_ns = stack_rx_ns != 0 ? stack_rx_ns : dequeue_ns;
+                dgram.stack_rx_timestamp = stack_rx_ns != 0;
+
+                if (needs_send && zero_copy && segments == 1 && !config.sync_reply) {
+                    dgram.data = io_ctx->buffer.data();
+                    dgram.length = bytes_transferred;
+                    dgram.capacity = io_ctx->buffer.size();
+                    const handler_action action = handler.handle(dgram);
+                    if (action.kind != handler_action::verdict::drop) {
+                        // The receive context itself becomes the in-flight send; it is
+                        // reposted as a receive once the send completes. Keep the
+                        // receive depth up from the spare contexts meanwhile.
+                        const bool forward = action.kind == handler_action::verdict::forward;
+                        try {
+                            post_send_in_place(ctx->socket, io_ctx, action.length,
+                                               forward ? action.forward_addr : from,
+                                               forward ? action.forward_addr_len : from_len);
+                        } catch (const socket_exception& ex) {
+                            on_send_error(ex, 1);
+                            recycle_recv(io_ctx);
+                            continue;
+                        }
+                        drain.on_send_posted();
+                        ctx->packets_sent.add(1);
+                        ctx->bytes_sent.add(action.length);
+                        ctx->send_calls.add(1);
+                        top_up_recvs();
+                        continue;
+                    }
+                } else if (needs_send) {
+                    for (DWORD offset = 0; offset < bytes_transferred; offset += segment_size) {
+                        const DWORD len = (std::min)(segment_size, bytes_transferred - offset);
+                        char* data = io_ctx->buffer.data() + offset;
+                        dgram.data = data;
+                        dgram.length = len;
+                        // Only the last segment may grow into the rest of the buffer.
+                        dgram.capacity = offset + len == bytes_transferred
+                                             ? io_ctx->buffer.size() - offset
+                                             : len;
+                        const handler_action action = handler.handle(dgram);
+                        switch (action.kind) {
+                            case handler_action::verdict::reply:
+                                if (uso) {
+                                    echo_batched(io_ctx, data, static_cast<DWORD>(action.length));
+                                } else {
+                                    echo_copy(from, from_len, data, action.length);
+                                }
+                                break;
+                            case handler_action::verdict::forward:
+                                echo_copy(action.forward_addr, action.forward_addr_len, data,
+                                          action.length);
+                                break;
+                            case handler_action::verdict::drop:
+                                break;
+                        }
+                    }
+                }
+
+                // Re-post receive for continuous processing
+                recycle_recv(io_ctx);
+            } else {
+                // Send completed — return context to pool
+                if (failed) ctx->send_errors.add();
+                drain.on_send_completed();
+                handle_send_completion(io_ctx);
+                if (recv_contexts.contains(io_ctx)) {
+                    recv_contexts.put(io_ctx);
+                    top_up_recvs();
+                } else {
+                    send_contexts.put(io_ctx);
+                }
+            }
+        }
+
+        // Send whatever the completion batch left in the USO buffer.
+        flush_batch();
+        depth_ctl.on_dequeue(recv_completions);
+        trace_completion_batch(ctx->processor_id, num_removed,
+                               static_cast<uint32_t>(recv_completions));
+    }
+
+    const uint64_t stop_ns = get_timestamp_ns();
+    drain.publish(ctx, stop_ns);
+    ctx->spin_ns.store(spin_ns);
+    ctx->run_ns.store(stop_ns - loop_start_ns);
+
+    // Cancel the receives still posted (and any sends the drain gave up on) and
+    // collect their completions, so the kernel is done with the contexts before
+    // the pools are freed.
+    size_t pending = posted_recvs + drain.sends_in_flight;
+    if (pending > 0) {
+        CancelIoEx(reinterpret_cast<HANDLE>(ctx->socket.get()), nullptr);
+        const uint64_t cancel_deadline_ns =
+            stop_ns + static_cast<uint64_t>(IOCP_SHUTDOWN_TIMEOUT_MS) * 1'000'000ULL;
+        while (pending > 0 && get_timestamp_ns() < cancel_deadline_ns) {
+            ULONG num_removed = 0;
+            if (!GetQueuedCompletionStatusEx(ctx->iocp.get(), entries.data(), max_entries,
+                                             &num_removed, DRAIN_POLL_MS, FALSE)) {
+                if (GetLastError() != WAIT_TIMEOUT) break;
+                continue;
+            }
+            for (ULONG ei = 0; ei < num_removed; ++ei) {
+                if (entries[ei].lpOverlapped != nullptr) --pending;
+            }
+        }
+        if (pending > 0) {
+            // The kernel may still write into these contexts: leak the pools instead.
+            std::osyncstream(std::cerr) << std::format(
+                "[CPU {}] {} I/O operation(s) did not complete after cancellation\n",
+                ctx->processor_id, pending);
+            recv_contexts.leak();
+            send_contexts.leak();
+        }
+    }
+
+    if (config.verbose)
+        std::osyncstream(std::cout) << std::format(
+            "[CPU {}] Worker shutting down. Stats: recv={}, sent={}, "
+            "bytes_recv={}, bytes_sent={}\n",
+            ctx->processor_id, ctx->packets_received.load(), ctx->packets_sent.load(),
+            ctx->bytes_received.load(), ctx->bytes_sent.load());
+} catch (const std::exception& ex) {
+    std::osyncstream(std::cerr) << std::format("[CPU {}] Worker thread exception: {}\n",
+                                               ctx->processor_id, ex.what());
+    // Shutdown on unhandled exception
+    ctx->config->shutdown.store(true);
+} catch (...) {
+    std::osyncstream(std::cerr) << std::format("[CPU {}] Worker thread unknown exception\n",
+                                               ctx->processor_id);
+    // Shutdown on unhandled exception
+    ctx->config->shutdown.store(true);
+}
+
+/**
+ * @brief Per-request slot used by the RIO engine.
+ *
+ * Each slot owns a fixed region of the worker's registered data slab and a
+ * `SOCKADDR_INET` region of the registered address slab. A slot alternates
+ * between a posted receive and an in-flight echo send of the same bytes, so
+ * the RIO path never copies payloads.
+ */
+struct rio_slot {
+    /// Operation currently in flight on this slot.
+    io_operation_type operation{io_operation_type::recv};
+    /// Registered data region (header + payload).
+    RIO_BUF data{};
+    /// Registered remote address region filled by RIOReceiveEx.
+    RIO_BUF remote_addr{};
+};
+
+/**
+ * @brief Worker thread entrypoint for the RIO engine.
+ *
+ * Keeps the same one-socket-per-CPU sharding as `worker_thread_func` but
+ * replaces WSARecvFrom/WSASendTo with a RIO request queue over registered
+ * buffer slabs. Completions are either signalled through the worker's IOCP
+ * (`RIONotify`) or busy-polled when `--rio-poll` is set. Receives and sends
+ * issued while draining a completion batch are deferred and committed once
+ * per batch.
+ */
+void rio_worker_thread_func(server_worker_context* ctx) try {
+    server_config& config = *ctx->config;
+    // Set thread affinity to match socket affinity
+    set_thread_affinity(ctx->processor_id);
+
+    const RIO_EXTENSION_FUNCTION_TABLE rio = load_rio_function_table(ctx->socket);
+
+    // Twice as many slots as posted receives so a spare slot can be posted as
+    // a receive while another slot's echo send is still in flight.
+    const size_t depth = config.depth;
+    ctx->depth.store(depth);
+    const size_t slot_count = depth * 2;
+    const size_t slot_stride = (config.max_datagram + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+    rio_buffer_slab data_slab(rio, slot_count * slot_stride, ctx->numa_node);
+    rio_buffer_slab addr_slab(rio, slot_count * sizeof(SOCKADDR_INET), ctx->numa_node);
+
+    std::vector<rio_slot> slots(slot_count);
+    std::vector<rio_slot*> spare_slots;
+    for (size_t i = 0; i < slot_count; ++i) {
+        slots[i].data = data_slab.slice(i * slot_stride, config.max_datagram);
+        slots[i].remote_addr = addr_slab.slice(i * sizeof(SOCKADDR_INET), sizeof(SOCKADDR_INET));
+        spare_slots.push_back(&slots[i]);
+    }
+
+    const bool poll = config.rio_poll;
+    OVERLAPPED notify_overlapped = {};
+    RIO_NOTIFICATION_COMPLETION notification = {};
+    notification.Type = RIO_IOCP_COMPLETION;
+    notification.Iocp.IocpHandle = ctx->iocp.get();
+    notification.Iocp.CompletionKey = ctx;
+    notification.Iocp.Overlapped = &notify_overlapped;
+
+    rio_completion_queue cq(rio, static_cast<DWORD>(slot_count * 2),
+                            poll ? nullptr : &notification);
+
+    RIO_RQ rq = rio.RIOCreateRequestQueue(ctx->socket.get(), static_cast<ULONG>(slot_count), 1,
+                                          static_cast<ULONG>(slot_count), 1, cq.get(), cq.get(),
+                                          ctx);
+    if (rq == RIO_INVALID_RQ) {
+        throw socket_exception(
+            std::format("RIOCreateRequestQueue failed: {}", get_last_error_message()));
+    }
+    // The request queue lives as long as the socket; close the socket before
+    // the completion queue and registered slabs are torn down.
+    auto close_socket = wil::scope_exit([&]() { ctx->socket.reset(); });
+
+    size_t posted_recvs = 0;
+    shutdown_drain drain{config};
+    // While draining, completed slots are parked instead of reposted.
+    auto post_rio_recv = [&](rio_slot* slot, DWORD flags) {
+        if (drain.active) {
+            spare_slots.push_back(slot);
+            return;
+        }
+        slot->operation = io_operation_type::recv;
+        slot->data.Length = static_cast<ULONG>(config.max_datagram);
+        if (!rio.RIOReceiveEx(rq, &slot->data, 1, nullptr, &slot->remote_addr, nullptr, nullptr,
+                              flags, slot)) {
+            const int error = WSAGetLastError();
+            std::osyncstream(std::cerr) << std::format(
+                "[CPU {}] RIOReceiveEx failed: {}\n", ctx->processor_id, get_last_error_message());
+            trace_repost_failed(ctx->processor_id, error);
+            ctx->repost_failures.add();
+            spare_slots.push_back(slot);
+            return;
+        }
+        ++posted_recvs;
+    };
+    // Keep `depth` receives posted while spare slots are available.
+    auto top_up_recvs = [&](DWORD flags) {
+        while (!drain.active && posted_recvs < depth && !spare_slots.empty()) {
+            rio_slot* slot = spare_slots.back();
+            spare_slots.pop_back();
+            post_rio_recv(slot, flags);
+        }
+    };
+
+    // Post initial receive operations
+    top_up_recvs(0);
+    config.workers_ready.fetch_add(1);
+
+    if (config.verbose)
+        std::osyncstream(std::cout) << std::format(
+            "[CPU {}] RIO worker started, {} outstanding receives, {} notification\n",
+            ctx->processor_id, posted_recvs, poll ? "polled" : "IOCP");
+
+    std::vector<RIORESULT> results(slot_count * 2);
+    if (!poll) rio.RIONotify(cq.get());
+
+    while (true) {
+        // After shutdown the loop only runs to complete the echoes still in flight.
+        if (drain.done(get_timestamp_ns())) break;
+
+        if (!poll) {
+            DWORD bytes = 0;
+            ULONG_PTR key = 0;
+            LPOVERLAPPED overlapped = nullptr;
+            const DWORD block_ms = drain.active ? DRAIN_POLL_MS : IOCP_SHUTDOWN_TIMEOUT_MS;
+            if (!GetQueuedCompletionStatus(ctx->iocp.get(), &bytes, &key, &overlapped, block_ms)) {
+                DWORD error = GetLastError();
+                if (error == WAIT_TIMEOUT) {
+                    continue;
+                }
+                if (error == ERROR_ABANDONED_WAIT_0) {
+                    // IOCP was closed, no more notifications can arrive
+                    break;
+                }
+                std::osyncstream(std::cerr)
+                    << std::format("[CPU {}] GetQueuedCompletionStatus failed with error: {}\n",
+                                   ctx->processor_id, error);
+                continue;
+            }
+        }
+
+        ULONG num_results =
+            rio.RIODequeueCompletion(cq.get(), results.data(), static_cast<ULONG>(results.size()));
+        if (num_results == RIO_CORRUPT_CQ) {
+            throw socket_exception("RIODequeueCompletion reported a corrupt completion queue");
+        }
+
+        uint32_t recv_results = 0;
+
+        for (ULONG ri = 0; ri < num_results; ++ri) {
+            const RIORESULT& result = results[ri];
+            auto* slot = reinterpret_cast<rio_slot*>(static_cast<ULONG_PTR>(result.RequestContext));
+
+            if (slot->operation == io_operation_type::recv) {
+                --posted_recvs;
+                ++recv_results;
+                if (result.Status != 0) {
+                    ctx->recv_errors.add();
+                    // Ignore WSAECONNRESET which can happen with UDP when no one is listening
+                    if (result.Status != WSAECONNRESET) {
+                        std::osyncstream(std::cerr) << std::format(
+                            "[CPU {}] RIO receive failed: {}\n", ctx->processor_id, result.Status);
+                    }
+                    post_rio_recv(slot, RIO_MSG_DEFER);
+                    continue;
+                }
+
+                ctx->packets_received.add(1);
+                ctx->bytes_received.add(result.BytesTransferred);
+
+                if (result.BytesTransferred == 0) {
+                    post_rio_recv(slot, RIO_MSG_DEFER);
+                    continue;
+                }
+
+                // Echo straight out of the registered receive buffer to the
+                // address RIO captured for this receive.
+                slot->operation = io_operation_type::send;
+                slot->data.Length = result.BytesTransferred;
+                if (!rio.RIOSendEx(rq, &slot->data, 1, nullptr, &slot->remote_addr, nullptr,
+                                   nullptr, RIO_MSG_DEFER, slot)) {
+                    std::osyncstream(std::cerr)
+                        << std::format("[CPU {}] RIOSendEx failed: {}\n", ctx->processor_id,
+                                       get_last_error_message());
+                    ctx->send_errors.add();
+                    ctx->echoes_dropped.add();
+                    post_rio_recv(slot, RIO_MSG_DEFER);
+                    continue;
+                }
+                drain.on_send_posted();
+                ctx->packets_sent.add(1);
+                ctx->bytes_sent.add(result.BytesTransferred);
+                ctx->send_calls.add(1);
+            } else {
+                // Send completed — the slot becomes a spare for the next receive
+                drain.on_send_completed();
+                if (result.Status != 0) {
+                    ctx->send_errors.add();
+                    std::osyncstream(std::cerr) << std::format("[CPU {}] RIO send failed: {}\n",
+                                                               ctx->processor_id, result.Status);
+                }
+                spare_slots.push_back(slot);
+            }
+        }
+
+        if (num_results > 0) {
+            trace_completion_batch(ctx->processor_id, num_results, recv_results);
+            top_up_recvs(RIO_MSG_DEFER);
+            // Commit everything deferred while draining this batch.
+            rio.RIOSendEx(rq, nullptr, 0, nullptr, nullptr, nullptr, nullptr, RIO_MSG_COMMIT_ONLY,
+                          nullptr);
+            rio.RIOReceiveEx(rq, nullptr, 0, nullptr, nullptr, nullptr, nullptr,
+                             RIO_MSG_COMMIT_ONLY, nullptr);
+        } else if (poll) {
+            std::this_thread::yield();
+        }
+
+        if (!poll) rio.RIONotify(cq.get());
+    }
+    drain.publish(ctx, get_timestamp_ns());
+
+    if (config.verbose)
+        std::osyncstream(std::cout) << std::format(
+            "[CPU {}] RIO worker shutting down. Stats: recv={}, sent={}, "
+            "bytes_recv={}, bytes_sent={}\n",
+            ctx->processor_id, ctx->packets_received.load(), ctx->packets_sent.load(),
+            ctx->bytes_received.load(), ctx->bytes_sent.load());
+} catch (const std::exception& ex) {
+    std::osyncstream(std::cerr) << std::format("[CPU {}] RIO worker thread exception: {}\n",
+                                               ctx->processor_id, ex.what());
+    // Shutdown on unhandled exception
+    ctx->config->shutdown.store(true);
+} catch (...) {
+    std::osyncstream(std::cerr) << std::format("[CPU {}] RIO worker thread unknown exception\n",
+                                               ctx->processor_id);
+    // Shutdown on unhandled exception
+    ctx->config->shutdown.store(true);
+}
+
+std::unique_ptr<server_worker_context> create_server_worker(server_config& config,
+                                                            const logical_processor& cpu,
+                                                            int address_family, uint16_t port) {
+    const uint32_t cpu_id = cpu.index;
+    auto ctx = std::make_unique<server_worker_context>();
+    ctx->config = &config;
+    ctx->processor_id = cpu_id;
+    ctx->numa_node = cpu.numa_node;
+    ctx->address_family = address_family;
+
+    ctx->socket = create_udp_socket(
+        address_family, config.engine == server_engine::rio ? WSA_FLAG_REGISTERED_IO : 0);
+
+    set_socket_cpu_affinity(ctx->socket, static_cast<uint16_t>(cpu_id));
+
+    // Accept IPv4 (as v4-mapped addresses) on the IPv6 socket as well.
+    if (config.dual_stack && address_family == AF_INET6) {
+        DWORD v6_only = 0;
+        set_socket_option(ctx->socket, IPPROTO_IPV6, IPV6_V6ONLY,
+                          reinterpret_cast<const char*>(&v6_only), sizeof(v6_only));
+    }
+
+    // Increase socket buffers.
+    set_socket_option(ctx->socket, SOL_SOCKET, SO_RCVBUF,
+                      reinterpret_cast<const char*>(&config.recvbuf), sizeof(config.recvbuf));
+    set_socket_option(ctx->socket, SOL_SOCKET, SO_SNDBUF,
+                      reinterpret_cast<const char*>(&config.recvbuf), sizeof(config.recvbuf));
+
+    // Optionally let the stack coalesce same-sender datagrams into one receive.
+    if (config.uro && config.engine == server_engine::iocp &&
+        !enable_udp_recv_coalescing(ctx->socket, static_cast<DWORD>(MAX_PACKET_SIZE))) {
+        std::osyncstream(std::cerr) << std::format(
+            "[CPU {}] UDP receive coalescing not supported: {}\n", cpu_id,
+            get_last_error_message());
+    }
+
+    // Bind socket to the requested port
+    bind_socket(ctx->socket, port, address_family);
+
+    // Create IOCP and associate socket. RIO sockets are not associated;
+    // the IOCP only carries RIONotify completion-queue notifications.
+    if (config.engine == server_engine::rio) {
+        ctx->iocp = create_iocp();
+    } else {
+        ctx->iocp = create_iocp_and_associate(ctx->socket);
+    }
+
+    if (config.verbose)
+        std::osyncstream(std::cout) << std::format("Created socket and IOCP for CPU {}\n", cpu_id);
+    return ctx;
+}
+
+void server_worker_thread_func(server_worker_context* ctx) {
+    // The IOCP worker is instantiated per handler.
+    if (ctx->config->engine == server_engine::rio) {
+        rio_worker_thread_func(ctx);
+    } else if (ctx->config->handler == server_handler::discard) {
+        worker_thread_func<discard_handler>(ctx);
+    } else if (ctx->config->handler == server_handler::timestamp) {
+        worker_thread_func<timestamp_handler>(ctx);
+    } else {
+        worker_thread_func<echo_handler>(ctx);
+    }
+}
+
+void wake_server_worker(server_worker_context& ctx) {
+    PostQueuedCompletionStatus(ctx.iocp.get(), 0, 0, nullptr);
+}
@@ -0,0 +1,153 @@
+/**
+ * @file server_worker.hpp
+ * @brief Server worker contexts and their IOCP and RIO completion loops.
+ *
+ * The workers read their settings and stop flag from a `server_config`
+ * shared by every worker of a run, so the server executable and the
+ * in-process loopback benchmark drive the same loops.
+ *
+ * @copyright Copyright (c) 2025 WinUDPShardedEcho Contributors
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "common/counters.hpp"
+#include "common/socket_utils.hpp"
+#include "common/topology.hpp"
+
+/**
+ * @brief I/O engine used by the server workers (`--engine`).
+ */
+enum class server_engine { iocp, rio };
+
+/**
+ * @brief Per-datagram handler used by the IOCP engine (`--handler`).
+ */
+enum class server_handler { echo, discard, timestamp };
+
+/**
+ * @brief Settings shared by the workers of one run, and the run's stop flag.
+ *
+ * Set up before the workers start and read-only afterwards, except for the
+ * atomics.
+ */
+struct server_config {
+    /// If true, enable more verbose runtime output.
+    bool verbose{false};
+    /// If true, reply synchronously via `sendto` instead of posting overlapped sends.
+    bool sync_reply{false};
+    /// If true, enable UDP receive coalescing (URO) and echo each coalesced segment.
+    bool uro{false};
+    /// If true, batch same-peer echoes into UDP send segmentation offload (USO) sends.
+    bool uso{false};
+    /// If true, echo overlapped sends straight from the receive context's buffer (no copy).
+    bool zero_copy{false};
+    /// If true, the RIO engine busy-polls its completion queue instead of waiting on IOCP.
+    bool rio_poll{false};
+    /// If true, ask the stack to timestamp receives for handlers that stamp packets.
+    bool rx_timestamps{false};
+    /// If true, serve both families from one dual-stack IPv6 socket (and worker) per CPU.
+    bool dual_stack{false};
+    server_engine engine{server_engine::iocp};
+    server_handler handler{server_handler::echo};
+    /// Receives kept posted per socket (`--depth`).
+    size_t depth{DEFAULT_OUTSTANDING_OPS};
+    /// If true, IOCP workers adapt their depth within [min_depth, max_depth].
+    bool adaptive_depth{false};
+    size_t min_depth{4};
+    size_t max_depth{1024};
+    /// Busy-poll budget in nanoseconds after the last completion before blocking (`--spin-us`).
+    uint64_t spin_ns{0};
+    /// Largest datagram the server expects; sizes per-context buffers (`--max-datagram`).
+    size_t max_datagram{MAX_PACKET_SIZE};
+    /// How long workers keep completing in-flight echoes after shutdown (`--drain-ms`).
+    uint64_t drain_ns{1'000'000'000ULL};
+    /// Socket send and receive buffer size in bytes (`--recvbuf`).
+    int recvbuf{4194304};
+    /// Set to true to request orderly termination of the workers.
+    std::atomic<bool> shutdown{false};
+    /// Workers that have posted their initial receives; the server is ready when all have.
+    std::atomic<size_t> workers_ready{0};
+};
+
+/**
+ * @brief Per-worker context for server-side processing.
+ *
+ * Holds the listening socket, IOCP handle, a worker thread and basic
+ * counters for received/sent packets and bytes.
+ */
+struct server_worker_context {
+    /// Settings and stop flag of the run this worker belongs to.
+    server_config* config{nullptr};
+    /// Logical processor id this worker is affinitized to (global index).
+    uint32_t processor_id;
+    /// NUMA node of that processor; the worker's pools are allocated there.
+    uint32_t numa_node{0};
+    /// Address family of the socket (`AF_INET6` for a dual-stack socket).
+    int address_family{AF_INET};
+    /// The UDP socket owned by the worker.
+    unique_socket socket;
+    /// IO Completion Port associated with the socket.
+    unique_iocp iocp;
+    /// Worker thread (jthread for cooperative cancellation support).
+    std::jthread worker_thread;
+    /// Counters and statistics, written only by the worker thread and kept on
+    /// their own cache line so snapshots do not contend with the fields above.
+    alignas(CACHE_LINE_SIZE) single_writer_counter packets_received{0};
+    single_writer_counter packets_sent{0};
+    single_writer_counter bytes_received{0};
+    single_writer_counter bytes_sent{0};
+    /// Number of send calls issued (less than `packets_sent` when USO batches datagrams).
+    single_writer_counter send_calls{0};
+    /// Time spent in empty busy-poll dequeues and total time in the completion loop
+    /// (published when the worker exits).
+    single_writer_counter spin_ns{0};
+    single_writer_counter run_ns{0};
+    /// Echoes not sent: the send pool was empty or the send failed to post.
+    single_writer_counter echoes_dropped{0};
+    /// Of those, echoes dropped because the send pool was empty.
+    single_writer_counter send_pool_empty{0};
+    /// Sends that failed to post or completed with an error.
+    single_writer_counter send_errors{0};
+    /// Receives that could not be (re)posted.
+    single_writer_counter repost_failures{0};
+    /// Receive completions that carried an error (e.g. ICMP port unreachable, truncation).
+    single_writer_counter recv_errors{0};
+    /// Receives the worker currently keeps posted (follows `--adaptive-depth`).
+    single_writer_counter depth{0};
+    /// Shutdown drain (published when the worker exits): echo sends that completed
+    /// while draining, sends still in flight when the drain timed out, and its length.
+    single_writer_counter drained_sends{0};
+    single_writer_counter abandoned_sends{0};
+    single_writer_counter drain_ns{0};
+};
+
+/**
+ * @brief Create a worker's socket, bound to `port`, and its IOCP for the processor `cpu`.
+ *
+ * @throws socket_exception if the socket cannot be created, configured or bound.
+ */
+std::unique_ptr<server_worker_context> create_server_worker(server_config& config,
+                                                            const logical_processor& cpu,
+                                                            int address_family, uint16_t port);
+
+/**
+ * @brief Worker thread entrypoint: runs the engine and handler selected by the worker's config.
+ *
+ * Returns once `config->shutdown` is set and the worker has drained (after
+ * `wake_server_worker` if it may be blocked on its IOCP).
+ */
+void server_worker_thread_func(server_worker_context* ctx);
+
+/**
+ * @brief Wake a worker blocked on its IOCP so it notices shutdown.
+ *
+ * Posts an empty completion instead of closing the IOCP, so the worker can
+ * still collect the completions of in-flight sends while it drains.
+ */
+void wake_server_worker(server_worker_context& ctx);